@@ -0,0 +1,368 @@
+/**
+ * A synthetic wayland client for benchmarking Wayfire.
+ *
+ * It maps a single xdg toplevel and commits a new shm buffer at a fixed rate, damaging a configurable part
+ * of the surface each time, without waiting for frame callbacks. This mimics clients like video players or
+ * games which render independently of the compositor.
+ *
+ * Usage: wf-bench-client [--rate HZ] [--damage FRACTION] [--title TITLE]
+ */
+#include <wayland-client.h>
+#include "xdg-shell-client-protocol.h"
+
+#include <getopt.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace
+{
+constexpr int DEFAULT_WIDTH  = 400;
+constexpr int DEFAULT_HEIGHT = 300;
+constexpr int NUM_BUFFERS    = 3;
+
+struct buffer_t
+{
+    wl_buffer *buffer = nullptr;
+    uint32_t *data    = nullptr;
+    int width = 0, height = 0;
+    bool busy = false;
+};
+
+struct client_t
+{
+    wl_display *display = nullptr;
+    wl_compositor *compositor = nullptr;
+    wl_shm *shm = nullptr;
+    xdg_wm_base *wm_base = nullptr;
+
+    wl_surface *surface = nullptr;
+    xdg_surface *xdg_surf = nullptr;
+    xdg_toplevel *toplevel = nullptr;
+
+    buffer_t buffers[NUM_BUFFERS];
+    int width  = DEFAULT_WIDTH;
+    int height = DEFAULT_HEIGHT;
+    bool configured = false;
+    bool running    = true;
+
+    double rate   = 60.0;
+    double damage = 1.0;
+    uint32_t frame_counter = 0;
+};
+
+int64_t get_time_usec()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1'000'000ll + ts.tv_nsec / 1000;
+}
+
+void handle_buffer_release(void *data, wl_buffer*)
+{
+    static_cast<buffer_t*>(data)->busy = false;
+}
+
+const wl_buffer_listener buffer_listener = {
+    .release = handle_buffer_release,
+};
+
+void destroy_buffer(buffer_t& buf)
+{
+    if (buf.buffer)
+    {
+        wl_buffer_destroy(buf.buffer);
+        munmap(buf.data, buf.width * buf.height * 4);
+    }
+
+    buf = buffer_t{};
+}
+
+bool create_buffer(client_t& client, buffer_t& buf)
+{
+    const int stride = client.width * 4;
+    const int size   = stride * client.height;
+
+    int fd = memfd_create("wf-bench-client", MFD_CLOEXEC);
+    if ((fd < 0) || (ftruncate(fd, size) < 0))
+    {
+        perror("Failed to create shm file");
+        return false;
+    }
+
+    void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED)
+    {
+        perror("Failed to map shm file");
+        close(fd);
+        return false;
+    }
+
+    wl_shm_pool *pool = wl_shm_create_pool(client.shm, fd, size);
+    buf.buffer = wl_shm_pool_create_buffer(pool, 0, client.width, client.height, stride,
+        WL_SHM_FORMAT_XRGB8888);
+    wl_shm_pool_destroy(pool);
+    close(fd);
+
+    buf.data   = static_cast<uint32_t*>(data);
+    buf.width  = client.width;
+    buf.height = client.height;
+    buf.busy   = false;
+    wl_buffer_add_listener(buf.buffer, &buffer_listener, &buf);
+    return true;
+}
+
+buffer_t *get_free_buffer(client_t& client)
+{
+    for (auto& buf : client.buffers)
+    {
+        if (buf.busy)
+        {
+            continue;
+        }
+
+        if (buf.buffer && ((buf.width != client.width) || (buf.height != client.height)))
+        {
+            destroy_buffer(buf);
+        }
+
+        if (!buf.buffer && !create_buffer(client, buf))
+        {
+            return nullptr;
+        }
+
+        return &buf;
+    }
+
+    // The compositor holds all buffers, skip this frame like a real client would.
+    return nullptr;
+}
+
+void draw_frame(client_t& client)
+{
+    buffer_t *buf = get_free_buffer(client);
+    if (!buf)
+    {
+        return;
+    }
+
+    // Repaint a horizontal band of the requested size, moving down each frame.
+    const int band   = std::max(1, (int)(buf->height * client.damage));
+    const int band_y = (client.frame_counter * 7) % std::max(1, buf->height - band + 1);
+    const uint32_t color = 0xff000000 | ((client.frame_counter * 0x010305) & 0xffffff);
+
+    for (int y = band_y; y < band_y + band; y++)
+    {
+        uint32_t *row = buf->data + y * buf->width;
+        for (int x = 0; x < buf->width; x++)
+        {
+            row[x] = color ^ (x & 0xff);
+        }
+    }
+
+    wl_surface_attach(client.surface, buf->buffer, 0, 0);
+    wl_surface_damage_buffer(client.surface, 0, band_y, buf->width, band);
+    wl_surface_commit(client.surface);
+    buf->busy = true;
+    client.frame_counter++;
+}
+
+void handle_wm_base_ping(void*, xdg_wm_base *wm_base, uint32_t serial)
+{
+    xdg_wm_base_pong(wm_base, serial);
+}
+
+const xdg_wm_base_listener wm_base_listener = {
+    .ping = handle_wm_base_ping,
+};
+
+void handle_xdg_surface_configure(void *data, xdg_surface *surface, uint32_t serial)
+{
+    auto client = static_cast<client_t*>(data);
+    xdg_surface_ack_configure(surface, serial);
+    client->configured = true;
+    // Respond to the configure right away, so that the compositor does not have to wait for the next tick.
+    draw_frame(*client);
+}
+
+const xdg_surface_listener xdg_surface_listener = {
+    .configure = handle_xdg_surface_configure,
+};
+
+void handle_toplevel_configure(void *data, xdg_toplevel*, int32_t width, int32_t height, wl_array*)
+{
+    auto client = static_cast<client_t*>(data);
+    if ((width > 0) && (height > 0))
+    {
+        client->width  = width;
+        client->height = height;
+    }
+}
+
+void handle_toplevel_close(void *data, xdg_toplevel*)
+{
+    static_cast<client_t*>(data)->running = false;
+}
+
+const xdg_toplevel_listener toplevel_listener = {
+    .configure = handle_toplevel_configure,
+    .close     = handle_toplevel_close,
+};
+
+void handle_global(void *data, wl_registry *registry, uint32_t name, const char *interface, uint32_t)
+{
+    auto client = static_cast<client_t*>(data);
+    if (!strcmp(interface, wl_compositor_interface.name))
+    {
+        client->compositor = (wl_compositor*)wl_registry_bind(registry, name, &wl_compositor_interface, 4);
+    } else if (!strcmp(interface, wl_shm_interface.name))
+    {
+        client->shm = (wl_shm*)wl_registry_bind(registry, name, &wl_shm_interface, 1);
+    } else if (!strcmp(interface, xdg_wm_base_interface.name))
+    {
+        client->wm_base = (xdg_wm_base*)wl_registry_bind(registry, name, &xdg_wm_base_interface, 1);
+        xdg_wm_base_add_listener(client->wm_base, &wm_base_listener, client);
+    }
+}
+
+void handle_global_remove(void*, wl_registry*, uint32_t)
+{}
+
+const wl_registry_listener registry_listener = {
+    .global = handle_global,
+    .global_remove = handle_global_remove,
+};
+}
+
+int main(int argc, char **argv)
+{
+    client_t client;
+    std::string title = "wf-bench-client";
+
+    static const option opts[] = {
+        {"rate", required_argument, NULL, 'r'},
+        {"damage", required_argument, NULL, 'd'},
+        {"title", required_argument, NULL, 't'},
+        {0, 0, NULL, 0}
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "r:d:t:", opts, NULL)) != -1)
+    {
+        switch (c)
+        {
+          case 'r':
+            client.rate = std::max(0.1, atof(optarg));
+            break;
+
+          case 'd':
+            client.damage = std::min(1.0, std::max(0.0, atof(optarg)));
+            break;
+
+          case 't':
+            title = optarg;
+            break;
+
+          default:
+            fprintf(stderr, "Usage: %s [--rate HZ] [--damage FRACTION] [--title TITLE]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    client.display = wl_display_connect(NULL);
+    if (!client.display)
+    {
+        fprintf(stderr, "Failed to connect to the wayland display\n");
+        return EXIT_FAILURE;
+    }
+
+    wl_registry *registry = wl_display_get_registry(client.display);
+    wl_registry_add_listener(registry, &registry_listener, &client);
+    wl_display_roundtrip(client.display);
+    if (!client.compositor || !client.shm || !client.wm_base)
+    {
+        fprintf(stderr, "The compositor does not support wl_compositor, wl_shm or xdg_wm_base\n");
+        return EXIT_FAILURE;
+    }
+
+    client.surface  = wl_compositor_create_surface(client.compositor);
+    client.xdg_surf = xdg_wm_base_get_xdg_surface(client.wm_base, client.surface);
+    xdg_surface_add_listener(client.xdg_surf, &xdg_surface_listener, &client);
+    client.toplevel = xdg_surface_get_toplevel(client.xdg_surf);
+    xdg_toplevel_add_listener(client.toplevel, &toplevel_listener, &client);
+    xdg_toplevel_set_title(client.toplevel, title.c_str());
+    xdg_toplevel_set_app_id(client.toplevel, "wf-bench-client");
+    wl_surface_commit(client.surface);
+
+    const int64_t period = 1'000'000 / client.rate;
+    int64_t next_frame   = get_time_usec();
+    while (client.running)
+    {
+        while (wl_display_prepare_read(client.display) != 0)
+        {
+            wl_display_dispatch_pending(client.display);
+        }
+
+        wl_display_flush(client.display);
+
+        const int64_t now = get_time_usec();
+        pollfd pfd = {wl_display_get_fd(client.display), POLLIN, 0};
+        int timeout_ms = std::max<int64_t>(0, (next_frame - now + 999) / 1000);
+        if (poll(&pfd, 1, timeout_ms) < 0)
+        {
+            wl_display_cancel_read(client.display);
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            break;
+        }
+
+        if (pfd.revents & POLLIN)
+        {
+            if (wl_display_read_events(client.display) < 0)
+            {
+                break;
+            }
+        } else
+        {
+            wl_display_cancel_read(client.display);
+        }
+
+        if (pfd.revents & (POLLERR | POLLHUP))
+        {
+            break;
+        }
+
+        wl_display_dispatch_pending(client.display);
+
+        if (get_time_usec() >= next_frame)
+        {
+            if (client.configured)
+            {
+                draw_frame(client);
+            }
+
+            // Do not try to catch up with missed ticks, keep a steady rate instead.
+            next_frame = std::max(next_frame + period, get_time_usec());
+        }
+    }
+
+    for (auto& buf : client.buffers)
+    {
+        destroy_buffer(buf);
+    }
+
+    wl_display_disconnect(client.display);
+    return EXIT_SUCCESS;
+}
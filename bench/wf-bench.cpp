@@ -0,0 +1,787 @@
+/**
+ * A headless benchmark for Wayfire.
+ *
+ * wf-bench starts Wayfire on the wlroots headless backend with software rendering, creates outputs and
+ * synthetic clients (see bench-client.cpp), and drives the compositor through the stipc plugin: the views are
+ * periodically re-laid out, the cursor is moved and keys are pressed. Meanwhile, the frame timings of all
+ * outputs are collected, and at the end the frame rate, the frame time percentiles, the CPU time of the
+ * compositor per frame and its memory usage per view are reported.
+ *
+ * The IPC requests and frame timing queries also cost some CPU time in the compositor, but the amount is
+ * the same between runs, so the numbers are still comparable.
+ *
+ * To run it with the default parameters, configure with -Dbenchmarks=enabled and run
+ * `meson test --benchmark -v`. For CI, --min-fps and --max-p99 turn regressions into failures.
+ */
+#include <nlohmann/json.hpp>
+
+#include <getopt.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+struct options_t
+{
+    std::string wayfire = "wayfire";
+    std::string client  = "wf-bench-client";
+    std::string config;
+    std::string config_backend;
+
+    int views   = 20;
+    int outputs = 1;
+    int output_width  = 1920;
+    int output_height = 1080;
+
+    double rate   = 60.0;
+    double damage = 0.25;
+    double warmup = 2.0;
+    double duration = 10.0;
+
+    bool json = false;
+    // Thresholds for CI, negative values are ignored
+    double min_fps = -1;
+    double max_p99 = -1;
+
+    // IPC methods whose results are included in the report. They are called with {"reset": true} when the
+    // measurement starts, so that they can reset their counters.
+    std::vector<std::string> stats_methods;
+};
+
+/* ------------------------------ IPC client ------------------------------- */
+class ipc_client_t
+{
+  public:
+    explicit ipc_client_t(const std::string& path)
+    {
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+        {
+            throw std::runtime_error("Failed to create socket");
+        }
+
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0)
+        {
+            close(fd);
+            throw std::runtime_error("Failed to connect to " + path);
+        }
+    }
+
+    ~ipc_client_t()
+    {
+        close(fd);
+    }
+
+    ipc_client_t(const ipc_client_t&) = delete;
+    ipc_client_t& operator =(const ipc_client_t&) = delete;
+
+    nlohmann::json call(const std::string& method, nlohmann::json data = nlohmann::json::object())
+    {
+        nlohmann::json request;
+        request["method"] = method;
+        request["data"]   = std::move(data);
+
+        const std::string msg = request.dump();
+        const uint32_t len    = msg.size();
+        write_exact((const char*)&len, sizeof(len));
+        write_exact(msg.data(), msg.size());
+
+        uint32_t response_len;
+        read_exact((char*)&response_len, sizeof(response_len));
+        std::string response(response_len, '\0');
+        read_exact(response.data(), response_len);
+
+        auto result = nlohmann::json::parse(response);
+        if (result.is_object() && result.contains("error"))
+        {
+            throw std::runtime_error(method + " failed: " + result["error"].dump());
+        }
+
+        return result;
+    }
+
+  private:
+    int fd;
+
+    void write_exact(const char *buf, size_t len)
+    {
+        while (len > 0)
+        {
+            ssize_t ret = write(fd, buf, len);
+            if (ret <= 0)
+            {
+                throw std::runtime_error("Lost connection to Wayfire");
+            }
+
+            buf += ret;
+            len -= ret;
+        }
+    }
+
+    void read_exact(char *buf, size_t len)
+    {
+        while (len > 0)
+        {
+            ssize_t ret = read(fd, buf, len);
+            if (ret <= 0)
+            {
+                throw std::runtime_error("Lost connection to Wayfire");
+            }
+
+            buf += ret;
+            len -= ret;
+        }
+    }
+};
+
+/* ------------------------- Process helpers ------------------------------- */
+pid_t spawn(const std::vector<std::string>& args, const std::map<std::string, std::string>& env)
+{
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        throw std::runtime_error("fork() failed");
+    }
+
+    if (pid == 0)
+    {
+        for (auto& [name, value] : env)
+        {
+            setenv(name.c_str(), value.c_str(), 1);
+        }
+
+        std::vector<char*> argv;
+        for (auto& arg : args)
+        {
+            argv.push_back(const_cast<char*>(arg.c_str()));
+        }
+
+        argv.push_back(nullptr);
+        execvp(argv[0], argv.data());
+        perror(("Failed to execute " + args[0]).c_str());
+        _exit(127);
+    }
+
+    return pid;
+}
+
+bool is_running(pid_t pid)
+{
+    return waitpid(pid, nullptr, WNOHANG) == 0;
+}
+
+void terminate(pid_t pid)
+{
+    if (is_running(pid))
+    {
+        kill(pid, SIGTERM);
+        waitpid(pid, nullptr, 0);
+    }
+}
+
+/** User + system CPU time of the process, in milliseconds */
+double get_cpu_time(pid_t pid)
+{
+    std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+    std::string content((std::istreambuf_iterator<char>(stat)), std::istreambuf_iterator<char>());
+
+    // The command name may contain spaces, so start parsing after its closing parenthesis.
+    std::istringstream fields(content.substr(content.rfind(')') + 2));
+    std::string field;
+    unsigned long utime = 0, stime = 0;
+    for (int i = 3; i <= 15 && fields >> field; i++)
+    {
+        if (i == 14)
+        {
+            utime = std::stoul(field);
+        } else if (i == 15)
+        {
+            stime = std::stoul(field);
+        }
+    }
+
+    return 1000.0 * (utime + stime) / sysconf(_SC_CLK_TCK);
+}
+
+/** Resident set size of the process, in KiB */
+double get_rss(pid_t pid)
+{
+    std::ifstream statm("/proc/" + std::to_string(pid) + "/statm");
+    unsigned long size = 0, resident = 0;
+    statm >> size >> resident;
+    return resident * (sysconf(_SC_PAGESIZE) / 1024.0);
+}
+
+using steady_clock = std::chrono::steady_clock;
+
+double seconds_since(steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(steady_clock::now() - start).count();
+}
+
+/** The @p-th percentile of the values, using the nearest-rank method */
+double percentile(std::vector<int64_t> values, double p)
+{
+    if (values.empty())
+    {
+        return 0;
+    }
+
+    std::sort(values.begin(), values.end());
+    const long rank = std::ceil(p / 100.0 * values.size());
+    return values[std::clamp<long>(rank - 1, 0, values.size() - 1)];
+}
+
+/* ------------------------------ Benchmark -------------------------------- */
+class benchmark_t
+{
+  public:
+    explicit benchmark_t(const options_t& opts) : opts(opts)
+    {}
+
+    ~benchmark_t()
+    {
+        for (auto pid : clients)
+        {
+            terminate(pid);
+        }
+
+        ipc.reset();
+        if (wayfire_pid > 0)
+        {
+            terminate(wayfire_pid);
+        }
+
+        if (!runtime_dir.empty())
+        {
+            unlink(socket_path.c_str());
+            if (owns_runtime_dir)
+            {
+                rmdir(runtime_dir.c_str());
+            }
+        }
+    }
+
+    int run()
+    {
+        start_wayfire();
+        create_outputs();
+
+        rss_before_views = get_rss(wayfire_pid);
+        spawn_clients();
+        wait_for_views();
+        layout(0);
+        rss_after_views = get_rss(wayfire_pid);
+
+        drive(opts.warmup, false);
+        for (auto& method : opts.stats_methods)
+        {
+            ipc->call(method, {{"reset", true}});
+        }
+
+        drive(opts.duration, true);
+        return report();
+    }
+
+  private:
+    const options_t& opts;
+    std::string runtime_dir;
+    bool owns_runtime_dir = false;
+    std::string socket_path;
+    pid_t wayfire_pid = -1;
+    std::vector<pid_t> clients;
+    std::unique_ptr<ipc_client_t> ipc;
+
+    std::vector<std::string> output_names;
+    std::vector<int> view_ids;
+    double rss_before_views = 0, rss_after_views = 0;
+
+    // Collected frame timings
+    std::map<std::string, int64_t> last_frame_start;
+    std::map<std::string, int> rendered_frames;
+    std::vector<int64_t> frame_times;
+    double cpu_time = 0;
+    double measured_time = 0;
+
+    void start_wayfire()
+    {
+        const char *xdg_runtime = getenv("XDG_RUNTIME_DIR");
+        if (xdg_runtime)
+        {
+            runtime_dir = xdg_runtime;
+        } else
+        {
+            char tmpl[] = "/tmp/wf-bench-XXXXXX";
+            if (!mkdtemp(tmpl))
+            {
+                throw std::runtime_error("Failed to create a runtime directory");
+            }
+
+            runtime_dir = tmpl;
+            owns_runtime_dir = true;
+        }
+
+        socket_path = runtime_dir + "/wf-bench-" + std::to_string(getpid()) + ".socket";
+
+        std::map<std::string, std::string> env = {
+            {"XDG_RUNTIME_DIR", runtime_dir},
+            {"_WAYFIRE_SOCKET", socket_path},
+            {"WLR_BACKENDS", "headless"},
+            {"WLR_HEADLESS_OUTPUTS", "0"},
+            {"WLR_LIBINPUT_NO_DEVICES", "1"},
+            {"WLR_RENDERER", "gles2"},
+            {"WLR_RENDERER_ALLOW_SOFTWARE", "1"},
+            {"LIBGL_ALWAYS_SOFTWARE", "1"},
+        };
+
+        std::vector<std::string> args = {opts.wayfire};
+        if (!opts.config.empty())
+        {
+            args.insert(args.end(), {"-c", opts.config});
+        }
+
+        if (!opts.config_backend.empty())
+        {
+            args.insert(args.end(), {"-B", opts.config_backend});
+        }
+
+        wayfire_pid = spawn(args, env);
+
+        // Wait until the IPC socket accepts connections.
+        auto start = steady_clock::now();
+        while (!ipc)
+        {
+            if (!is_running(wayfire_pid))
+            {
+                wayfire_pid = -1;
+                throw std::runtime_error("Wayfire exited during startup");
+            }
+
+            if (seconds_since(start) > 20)
+            {
+                throw std::runtime_error("Timed out waiting for the IPC socket " + socket_path);
+            }
+
+            try {
+                ipc = std::make_unique<ipc_client_t>(socket_path);
+            } catch (const std::runtime_error&)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            }
+        }
+    }
+
+    void create_outputs()
+    {
+        for (int i = 0; i < opts.outputs; i++)
+        {
+            auto response = ipc->call("stipc/create_wayland_output", {
+                {"width", opts.output_width},
+                {"height", opts.output_height},
+            });
+
+            output_names.push_back(response["output"]);
+        }
+    }
+
+    void spawn_clients()
+    {
+        const std::string display = ipc->call("stipc/get_display")["wayland"];
+        for (int i = 0; i < opts.views; i++)
+        {
+            clients.push_back(spawn({opts.client,
+                "--rate", std::to_string(opts.rate),
+                "--damage", std::to_string(opts.damage),
+                "--title", "wf-bench-" + std::to_string(i),
+            }, {
+                {"XDG_RUNTIME_DIR", runtime_dir},
+                {"WAYLAND_DISPLAY", display},
+            }));
+        }
+    }
+
+    void wait_for_views()
+    {
+        auto start = steady_clock::now();
+        while ((int)view_ids.size() < opts.views)
+        {
+            if (seconds_since(start) > 20)
+            {
+                throw std::runtime_error("Timed out waiting for the clients to map, " +
+                    std::to_string(view_ids.size()) + "/" + std::to_string(opts.views) + " mapped");
+            }
+
+            view_ids.clear();
+            for (auto& view : ipc->call("stipc/list_views"))
+            {
+                if (view["app-id"] == "wf-bench-client")
+                {
+                    view_ids.push_back(view["id"]);
+                }
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+    }
+
+    /**
+     * Arrange the views in a grid on each output. With a non-zero @shift, the views are rotated through the
+     * slots of the grid, so that every view is resized and moved.
+     */
+    void layout(int shift)
+    {
+        const int per_output = (view_ids.size() + output_names.size() - 1) / output_names.size();
+        const int cols = std::ceil(std::sqrt(per_output));
+        const int rows = (per_output + cols - 1) / cols;
+        const int cell_width  = opts.output_width / cols;
+        const int cell_height = opts.output_height / rows;
+
+        nlohmann::json views = nlohmann::json::array();
+        for (size_t i = 0; i < view_ids.size(); i++)
+        {
+            const int slot = (i + shift) % view_ids.size();
+            const int idx  = slot % per_output;
+            // Vary the sizes a bit, so that clients need to reallocate their buffers.
+            const int shrink = (shift % 2) * 16;
+
+            nlohmann::json view;
+            view["id"]     = view_ids[i];
+            view["output"] = output_names[slot / per_output];
+            view["x"]     = (idx % cols) * cell_width;
+            view["y"]     = (idx / cols) * cell_height;
+            view["width"] = std::max(64, cell_width - shrink);
+            view["height"] = std::max(64, cell_height - shrink);
+            views.push_back(view);
+        }
+
+        ipc->call("stipc/layout_views", {{"views", views}});
+    }
+
+    void collect_frames(bool record)
+    {
+        auto response = ipc->call("stipc/frame_timings");
+        for (auto& output : response["outputs"])
+        {
+            const std::string name = output["name"];
+            int64_t& last = last_frame_start[name];
+            for (auto& frame : output["frames"])
+            {
+                const int64_t start = frame["start"];
+                if (start <= last)
+                {
+                    continue;
+                }
+
+                last = start;
+                if (record && (frame["result"] == "rendered"))
+                {
+                    rendered_frames[name]++;
+                    frame_times.push_back(frame["total"]);
+                }
+            }
+        }
+    }
+
+    /**
+     * Drive the compositor for the given amount of seconds: move the cursor continuously, press a key every
+     * half a second, and change the layout every second.
+     */
+    void drive(double seconds, bool record)
+    {
+        // Skip frames from before this phase
+        collect_frames(false);
+
+        const double cpu_start = get_cpu_time(wayfire_pid);
+        auto start = steady_clock::now();
+        auto next_frames = start;
+        int ticks = 0;
+
+        while (seconds_since(start) < seconds)
+        {
+            if (!is_running(wayfire_pid))
+            {
+                wayfire_pid = -1;
+                throw std::runtime_error("Wayfire exited during the benchmark");
+            }
+
+            const double t = seconds_since(start);
+            ipc->call("stipc/move_cursor", {
+                {"x", opts.output_width * (0.5 + 0.45 * std::sin(t * 2.1))},
+                {"y", opts.output_height * (0.5 + 0.45 * std::sin(t * 3.7))},
+            });
+
+            if (ticks % 30 == 0)
+            {
+                ipc->call("stipc/feed_key", {{"key", "KEY_A"}, {"state", true}});
+                ipc->call("stipc/feed_key", {{"key", "KEY_A"}, {"state", false}});
+            }
+
+            if ((ticks % 60 == 0) && (ticks > 0))
+            {
+                layout(ticks / 60);
+            }
+
+            // The frame timings history is limited, so query it often enough.
+            if (steady_clock::now() >= next_frames)
+            {
+                collect_frames(record);
+                next_frames += std::chrono::milliseconds(250);
+            }
+
+            ++ticks;
+            std::this_thread::sleep_until(start + ticks * std::chrono::microseconds(16'667));
+        }
+
+        collect_frames(record);
+        if (record)
+        {
+            cpu_time += get_cpu_time(wayfire_pid) - cpu_start;
+            measured_time += seconds_since(start);
+        }
+    }
+
+    int report()
+    {
+        int total_frames = 0;
+        nlohmann::json fps = nlohmann::json::object();
+        for (auto& name : output_names)
+        {
+            total_frames += rendered_frames[name];
+            fps[name] = rendered_frames[name] / measured_time;
+        }
+
+        nlohmann::json result;
+        result["views"] = opts.views;
+        result["outputs"] = opts.outputs;
+        result["client-rate"] = opts.rate;
+        result["duration"] = measured_time;
+        result["frames"] = total_frames;
+        result["fps"] = fps;
+        result["frame-time-us"] = {
+            {"p50", percentile(frame_times, 50)},
+            {"p90", percentile(frame_times, 90)},
+            {"p99", percentile(frame_times, 99)},
+            {"max", percentile(frame_times, 100)},
+        };
+        result["cpu-ms-per-frame"] = total_frames ? cpu_time / total_frames : 0.0;
+        result["cpu-usage"] = cpu_time / (measured_time * 1000.0);
+        result["rss-kib"] = rss_after_views;
+        result["rss-kib-per-view"] = (rss_after_views - rss_before_views) / std::max(1, opts.views);
+        for (auto& method : opts.stats_methods)
+        {
+            result["stats"][method] = ipc->call(method);
+        }
+
+        if (opts.json)
+        {
+            std::cout << result.dump(4) << std::endl;
+        } else
+        {
+            printf("%d views on %d outputs, clients at %.1f Hz, measured for %.1f s\n",
+                opts.views, opts.outputs, opts.rate, measured_time);
+            for (auto& name : output_names)
+            {
+                printf("  %-16s %7.2f fps\n", name.c_str(), (double)fps[name]);
+            }
+
+            printf("  frame time       p50 %.0f us, p90 %.0f us, p99 %.0f us, max %.0f us\n",
+                (double)result["frame-time-us"]["p50"], (double)result["frame-time-us"]["p90"],
+                (double)result["frame-time-us"]["p99"], (double)result["frame-time-us"]["max"]);
+            printf("  cpu time         %.3f ms per frame, %.1f%% of a core\n",
+                (double)result["cpu-ms-per-frame"], 100.0 * (double)result["cpu-usage"]);
+            printf("  memory           %.0f KiB total, %.0f KiB per view\n",
+                rss_after_views, (double)result["rss-kib-per-view"]);
+            for (auto& method : opts.stats_methods)
+            {
+                printf("  %-16s %s\n", method.c_str(), result["stats"][method].dump().c_str());
+            }
+        }
+
+        fflush(stdout);
+
+        int status = EXIT_SUCCESS;
+        for (auto& name : output_names)
+        {
+            if ((opts.min_fps >= 0) && ((double)fps[name] < opts.min_fps))
+            {
+                fprintf(stderr, "FAIL: %s rendered %.2f fps, expected at least %.2f\n",
+                    name.c_str(), (double)fps[name], opts.min_fps);
+                status = EXIT_FAILURE;
+            }
+        }
+
+        const double p99_ms = (double)result["frame-time-us"]["p99"] / 1000.0;
+        if ((opts.max_p99 >= 0) && (p99_ms > opts.max_p99))
+        {
+            fprintf(stderr, "FAIL: p99 frame time %.2f ms, expected at most %.2f ms\n", p99_ms, opts.max_p99);
+            status = EXIT_FAILURE;
+        }
+
+        return status;
+    }
+};
+
+void print_help(const char *name)
+{
+    printf("Usage: %s [OPTION]...\n\n", name);
+    printf(" -w, --wayfire PATH          Wayfire executable\n");
+    printf(" -C, --client PATH           synthetic client executable\n");
+    printf(" -c, --config PATH           Wayfire config file, must enable the ipc and stipc plugins\n");
+    printf(" -B, --config-backend PATH   Wayfire config backend\n");
+    printf(" -n, --views N               number of synthetic clients (default 20)\n");
+    printf(" -o, --outputs N             number of headless outputs (default 1)\n");
+    printf(" -s, --output-size WxH       size of the outputs (default 1920x1080)\n");
+    printf(" -r, --rate HZ               commit rate of the clients (default 60)\n");
+    printf(" -D, --damage FRACTION       part of each client surface damaged per commit (default 0.25)\n");
+    printf(" -W, --warmup SECONDS        time before measuring (default 2)\n");
+    printf(" -t, --duration SECONDS      measurement time (default 10)\n");
+    printf(" -j, --json                  print the results as JSON\n");
+    printf("     --min-fps FPS           fail if an output renders fewer frames per second\n");
+    printf("     --max-p99 MS            fail if the 99th percentile frame time is longer\n");
+    printf("     --stats METHOD          include the result of an IPC method in the report, can be repeated\n");
+}
+}
+
+int main(int argc, char **argv)
+{
+    options_t opts;
+
+    enum
+    {
+        OPT_MIN_FPS = 256,
+        OPT_MAX_P99,
+        OPT_STATS,
+    };
+
+    static const option long_opts[] = {
+        {"wayfire", required_argument, NULL, 'w'},
+        {"client", required_argument, NULL, 'C'},
+        {"config", required_argument, NULL, 'c'},
+        {"config-backend", required_argument, NULL, 'B'},
+        {"views", required_argument, NULL, 'n'},
+        {"outputs", required_argument, NULL, 'o'},
+        {"output-size", required_argument, NULL, 's'},
+        {"rate", required_argument, NULL, 'r'},
+        {"damage", required_argument, NULL, 'D'},
+        {"warmup", required_argument, NULL, 'W'},
+        {"duration", required_argument, NULL, 't'},
+        {"json", no_argument, NULL, 'j'},
+        {"min-fps", required_argument, NULL, OPT_MIN_FPS},
+        {"max-p99", required_argument, NULL, OPT_MAX_P99},
+        {"stats", required_argument, NULL, OPT_STATS},
+        {"help", no_argument, NULL, 'h'},
+        {0, 0, NULL, 0}
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "w:C:c:B:n:o:s:r:D:W:t:jh", long_opts, NULL)) != -1)
+    {
+        switch (c)
+        {
+          case 'w':
+            opts.wayfire = optarg;
+            break;
+
+          case 'C':
+            opts.client = optarg;
+            break;
+
+          case 'c':
+            opts.config = optarg;
+            break;
+
+          case 'B':
+            opts.config_backend = optarg;
+            break;
+
+          case 'n':
+            opts.views = std::max(1, atoi(optarg));
+            break;
+
+          case 'o':
+            opts.outputs = std::max(1, atoi(optarg));
+            break;
+
+          case 's':
+            if (sscanf(optarg, "%dx%d", &opts.output_width, &opts.output_height) != 2)
+            {
+                fprintf(stderr, "Invalid output size \"%s\"\n", optarg);
+                return EXIT_FAILURE;
+            }
+
+            break;
+
+          case 'r':
+            opts.rate = atof(optarg);
+            break;
+
+          case 'D':
+            opts.damage = atof(optarg);
+            break;
+
+          case 'W':
+            opts.warmup = atof(optarg);
+            break;
+
+          case 't':
+            opts.duration = std::max(0.1, atof(optarg));
+            break;
+
+          case 'j':
+            opts.json = true;
+            break;
+
+          case OPT_MIN_FPS:
+            opts.min_fps = atof(optarg);
+            break;
+
+          case OPT_MAX_P99:
+            opts.max_p99 = atof(optarg);
+            break;
+
+          case OPT_STATS:
+            opts.stats_methods.push_back(optarg);
+            break;
+
+          case 'h':
+            print_help(argv[0]);
+            return EXIT_SUCCESS;
+
+          default:
+            print_help(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Children are cleaned up by the benchmark, but make sure we do not die when one disappears.
+    signal(SIGPIPE, SIG_IGN);
+
+    try {
+        benchmark_t bench{opts};
+        return bench.run();
+    } catch (const std::exception& e)
+    {
+        fprintf(stderr, "wf-bench: %s\n", e.what());
+        return EXIT_FAILURE;
+    }
+}
@@ -210,9 +210,12 @@ class fire_render_instance_t : public wf::scene::render_instance_t
 
     void compute_visibility(wf::output_t *output, wf::region_t& visible) override
     {
+        // The view is only partially rendered, so it does not occlude anything
+        // below it.
+        wf::region_t copy = visible;
         for (auto& ch : this->children)
         {
-            ch->compute_visibility(output, visible);
+            ch->compute_visibility(output, copy);
         }
     }
 
@@ -182,8 +182,7 @@ void ParticleSystem::create_program()
 {
     /* Just load the proper context, viewport doesn't matter */
     OpenGL::render_begin();
-    program.set_simple(OpenGL::compile_program(particle_vert_source,
-        particle_frag_source));
+    program.set_simple(particle_vert_source, particle_frag_source);
     OpenGL::render_end();
 }
 
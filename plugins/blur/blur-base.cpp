@@ -74,6 +74,19 @@ wf_blur_base::wf_blur_base(std::string name)
     OpenGL::render_begin();
     blend_program.compile(blur_blend_vertex_shader, blur_blend_fragment_shader);
     OpenGL::render_end();
+
+    for (int i = 0; i < 2; i++)
+    {
+        position_attrib[i] = program[i].get_attrib("position");
+        offset_uniform[i]  = program[i].get_uniform("offset");
+    }
+
+    blend_position = blend_program.get_attrib("position");
+    blend_uv = blend_program.get_attrib("uv_in");
+    blend_background_inverse = blend_program.get_uniform("background_inverse");
+    blend_mvp = blend_program.get_uniform("mvp");
+    blend_bg_texture = blend_program.get_uniform("bg_texture");
+    blend_sat = blend_program.get_uniform("sat");
 }
 
 wf_blur_base::~wf_blur_base()
@@ -105,8 +118,11 @@ void wf_blur_base::render_iteration(wf::region_t blur_region,
     out.bind();
 
     GL_CALL(glBindTexture(GL_TEXTURE_2D, in.tex));
+    pass_stats.passes++;
     for (auto& b : blur_region)
     {
+        auto box = wf::geometry_intersection(wlr_box_from_pixman_box(b), {0, 0, width, height});
+        pass_stats.pixels += (uint64_t)box.width * box.height;
         out.scissor(wlr_box_from_pixman_box(b));
         GL_CALL(glDrawArrays(GL_TRIANGLE_FAN, 0, 4));
     }
@@ -176,10 +192,16 @@ wlr_box wf_blur_base::copy_region(wf::framebuffer_t& result,
 
 void wf_blur_base::pre_render(wlr_box src_box,
     const wf::region_t& damage, const wf::render_target_t& target_fb)
+{
+    pre_render(src_box, damage, target_fb, fb[1]);
+}
+
+wlr_box wf_blur_base::pre_render(wlr_box src_box, const wf::region_t& damage,
+    const wf::render_target_t& target_fb, wf::framebuffer_t& result)
 {
     if (damage.empty())
     {
-        return;
+        return {0, 0, 0, 0};
     }
 
     int degrade     = degrade_opt;
@@ -201,8 +223,8 @@ void wf_blur_base::pre_render(wlr_box src_box,
 
     int r = blur_fb0(blur_damage, fb[0].viewport_width, fb[0].viewport_height);
 
-    /* Make sure the result is always fb[1], because that's what is used in render()
-     * */
+    /* Make sure the blurred pixels are always in fb[0], so that we can blit
+     * them to @result, which may be fb[1] */
     if (r != 0)
     {
         std::swap(fb[0], fb[1]);
@@ -213,8 +235,8 @@ void wf_blur_base::pre_render(wlr_box src_box,
     auto view_box = target_fb.framebuffer_box_from_geometry_box(src_box);
 
     OpenGL::render_begin();
-    fb[1].allocate(view_box.width, view_box.height);
-    fb[1].bind();
+    result.allocate(view_box.width, view_box.height);
+    result.bind();
     GL_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, fb[0].fb));
 
     /* Blit the blurred texture into an fb which has the size of the view,
@@ -231,10 +253,18 @@ void wf_blur_base::pre_render(wlr_box src_box,
         GL_COLOR_BUFFER_BIT, GL_LINEAR));
     GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
     OpenGL::render_end();
+
+    return damage_box;
 }
 
 void wf_blur_base::render(wf::texture_t src_tex, wlr_box src_box,
     wlr_box scissor_box, const wf::render_target_t& target_fb)
+{
+    render(src_tex, src_box, scissor_box, target_fb, fb[1]);
+}
+
+void wf_blur_base::render(wf::texture_t src_tex, wlr_box src_box, wlr_box scissor_box,
+    const wf::render_target_t& target_fb, const wf::framebuffer_t& background)
 {
     OpenGL::render_begin(target_fb);
     blend_program.use(src_tex.type);
@@ -254,19 +284,19 @@ void wf_blur_base::render(wf::texture_t src_tex, wlr_box src_box,
         1.0f * src_box.x, 1.0f * src_box.y,
     };
 
-    blend_program.attrib_pointer("position", 2, 0, vertex_data_pos);
-    blend_program.attrib_pointer("uv_in", 2, 0, vertex_data_uv);
+    blend_program.attrib_pointer(blend_position, 2, 0, vertex_data_pos);
+    blend_program.attrib_pointer(blend_uv, 2, 0, vertex_data_uv);
 
     /* Blend blurred background with window texture src_tex */
-    blend_program.uniformMatrix4f("background_inverse", glm::inverse(target_fb.transform));
-    blend_program.uniformMatrix4f("mvp", target_fb.get_orthographic_projection());
+    blend_program.uniformMatrix4f(blend_background_inverse, glm::inverse(target_fb.transform));
+    blend_program.uniformMatrix4f(blend_mvp, target_fb.get_orthographic_projection());
     /* XXX: core should give us the number of texture units used */
-    blend_program.uniform1i("bg_texture", 1);
-    blend_program.uniform1f("sat", saturation_opt);
+    blend_program.uniform1i(blend_bg_texture, 1);
+    blend_program.uniform1f(blend_sat, saturation_opt);
 
     blend_program.set_active_texture(src_tex);
     GL_CALL(glActiveTexture(GL_TEXTURE0 + 1));
-    GL_CALL(glBindTexture(GL_TEXTURE_2D, fb[1].tex));
+    GL_CALL(glBindTexture(GL_TEXTURE_2D, background.tex));
     /* Render it to target_fb */
     target_fb.bind();
 
@@ -306,6 +336,11 @@ std::unique_ptr<wf_blur_base> create_blur_from_name(std::string algorithm_name)
         return create_gaussian_blur();
     }
 
+    if (algorithm_name == "dual")
+    {
+        return create_dual_blur();
+    }
+
     LOGE("Unrecognized blur algorithm %s. Using default kawase blur.", algorithm_name.c_str());
     return create_kawase_blur();
 }
@@ -1,11 +1,15 @@
 #include <wayfire/per-output-plugin.hpp>
+#include <algorithm>
 #include <cstdlib>
+#include <map>
 #include <memory>
 #include <wayfire/config/types.hpp>
 #include <wayfire/plugin.hpp>
 #include <wayfire/view.hpp>
 #include <wayfire/matcher.hpp>
 #include <wayfire/output.hpp>
+#include <wayfire/output-layout.hpp>
+#include <wayfire/render-manager.hpp>
 #include <wayfire/view-transform.hpp>
 #include <wayfire/workspace-stream.hpp>
 #include <wayfire/workspace-set.hpp>
@@ -13,6 +17,7 @@
 #include <wayfire/bindings-repository.hpp>
 
 #include "blur.hpp"
+#include "scratch-pool.hpp"
 #include "wayfire/core.hpp"
 #include "wayfire/debug.hpp"
 #include "wayfire/geometry.hpp"
@@ -24,9 +29,110 @@
 #include "wayfire/scene.hpp"
 #include "wayfire/signal-provider.hpp"
 
+#if __has_include(<ipc-method-repository.hpp>)
+    #include <ipc-method-repository.hpp>
+    #include <wayfire/plugins/common/shared-core-data.hpp>
+#endif
+
 using blur_algorithm_provider =
     std::function<nonstd::observer_ptr<wf_blur_base>()>;
 
+namespace wf
+{
+namespace scene
+{
+class blur_render_instance_t;
+}
+}
+
+/**
+ * Keeps track of the damage on an output which changes the background of the
+ * blurred views on it, so that their blurred backgrounds can be kept between
+ * frames.
+ *
+ * The damage of a blurred view's own contents does not change what is behind
+ * the view, but it arrives at the output mixed with all other damage. Because
+ * of this, the blur render instances hold their own damage back until the
+ * output starts repainting. At that point, everything else scheduled on the
+ * output is damage to the background, and the held back damage is pushed so
+ * that it is repainted in the same frame.
+ */
+class blur_damage_tracker_t
+{
+  public:
+    blur_damage_tracker_t(wf::output_t *output)
+    {
+        this->output = output;
+        output->render->add_effect(&on_frame, wf::OUTPUT_EFFECT_DAMAGE);
+    }
+
+    ~blur_damage_tracker_t()
+    {
+        detach();
+    }
+
+    /**
+     * Stop tracking the output, for ex. because it is about to be destroyed.
+     * Render instances which still use the tracker do not cache anything after
+     * this.
+     */
+    void detach();
+
+    /**
+     * @return Whether render instances on the output should cache their blurred
+     *   background.
+     */
+    bool is_enabled() const
+    {
+        return output && cache_background;
+    }
+
+    wf::output_t *get_output() const
+    {
+        return output;
+    }
+
+    void add_instance(wf::scene::blur_render_instance_t *instance)
+    {
+        instances.push_back(instance);
+    }
+
+    void remove_instance(wf::scene::blur_render_instance_t *instance)
+    {
+        instances.erase(std::remove(instances.begin(), instances.end(), instance), instances.end());
+    }
+
+    /**
+     * @return The memory used by the cached backgrounds of the render
+     *   instances on the output, in bytes.
+     */
+    uint64_t get_cached_bytes() const;
+
+    /* how often the cached background of a view on the output was used, or
+     * had to be (partially) blurred again */
+    uint64_t cache_hits   = 0;
+    uint64_t cache_misses = 0;
+
+  private:
+    wf::output_t *output;
+    std::vector<wf::scene::blur_render_instance_t*> instances;
+    wf::option_wrapper_t<bool> cache_background{"blur/cache_background"};
+
+    /**
+     * Invalidate the cached backgrounds and push the held back damage of all
+     * instances.
+     */
+    void flush_damage();
+
+    wf::effect_hook_t on_frame = [=] ()
+    {
+        flush_damage();
+    };
+};
+
+using blur_tracker_provider =
+    std::function<std::shared_ptr<blur_damage_tracker_t>(wf::output_t*)>;
+
 static int calculate_damage_padding(const wf::render_target_t& target, int blur_radius)
 {
     float scale = target.scale;
@@ -48,9 +154,14 @@ class blur_node_t : public floating_inner_node_t
 {
   public:
     blur_algorithm_provider provider;
-    blur_node_t(blur_algorithm_provider provider) : floating_inner_node_t(false)
+    blur_tracker_provider tracker_provider;
+    std::shared_ptr<blur_scratch_pool_t> scratch_pool;
+    blur_node_t(blur_algorithm_provider provider, blur_tracker_provider tracker_provider,
+        std::shared_ptr<blur_scratch_pool_t> scratch_pool) : floating_inner_node_t(false)
     {
         this->provider = provider;
+        this->tracker_provider = tracker_provider;
+        this->scratch_pool     = scratch_pool;
     }
 
     std::string stringify() const override
@@ -64,18 +175,184 @@ class blur_node_t : public floating_inner_node_t
 
 class blur_render_instance_t : public transformer_render_instance_t<blur_node_t>
 {
-    wf::framebuffer_t saved_pixels;
+    // The pixels in @saved_pixels_region, offset by the origin of its extents.
+    // Taken from the node's scratch pool for the duration of a frame.
+    wf::framebuffer_t *saved_pixels = nullptr;
     wf::region_t saved_pixels_region;
 
+    damage_callback push_damage;
+    std::shared_ptr<blur_damage_tracker_t> tracker;
+    // Damage from the children, which is pushed once the output starts
+    // repainting, see blur_damage_tracker_t.
+    wf::region_t pending_damage;
+
+    // The blurred background of the view, kept between frames when rendering
+    // directly to the output. It has the same layout as the buffer filled by
+    // wf_blur_base::pre_render().
+    wf::framebuffer_t cached_background;
+    // The target and the view box (in framebuffer coordinates) for which
+    // @cached_background was rendered.
+    wf::render_target_t cached_target;
+    wlr_box cached_box = {0, 0, 0, 0};
+    // The part of @cached_background which is up to date, in framebuffer
+    // coordinates of @cached_target.
+    wf::region_t cached_valid;
+
+    // The region where the background is blurred in the current frame, or an
+    // empty region if the cached background is used.
+    wf::region_t blurred_region;
+    bool render_from_cache = false;
+
   public:
-    using transformer_render_instance_t::transformer_render_instance_t;
+    blur_render_instance_t(blur_node_t *self, damage_callback push_damage, wf::output_t *shown_on) :
+        transformer_render_instance_t(self, push_damage, shown_on)
+    {
+        this->push_damage = push_damage;
+        if (shown_on && self->tracker_provider)
+        {
+            this->tracker = self->tracker_provider(shown_on);
+        }
+
+        if (tracker)
+        {
+            tracker->add_instance(this);
+        }
+    }
+
     ~blur_render_instance_t()
     {
+        if (tracker)
+        {
+            tracker->remove_instance(this);
+        }
+
         OpenGL::render_begin();
-        saved_pixels.release();
+        release_saved_pixels();
+        cached_background.release();
         OpenGL::render_end();
     }
 
+    /**
+     * Return the buffer with the saved pixels to the scratch pool. Needs to be
+     * called between OpenGL::render_begin() and OpenGL::render_end().
+     */
+    void release_saved_pixels()
+    {
+        if (saved_pixels)
+        {
+            self->scratch_pool->release(saved_pixels);
+            saved_pixels = nullptr;
+        }
+    }
+
+    void transform_damage_region(wf::region_t& damage) override
+    {
+        if (tracker && tracker->is_enabled() && !damage.empty())
+        {
+            pending_damage |= damage;
+            damage.clear();
+            tracker->get_output()->render->schedule_redraw();
+        }
+    }
+
+    /**
+     * Push the damage held back by transform_damage_region().
+     */
+    void flush_pending_damage()
+    {
+        if (!pending_damage.empty())
+        {
+            auto damage = std::move(pending_damage);
+            pending_damage.clear();
+            push_damage(damage);
+        }
+    }
+
+    const wf::region_t& get_pending_damage() const
+    {
+        return pending_damage;
+    }
+
+    uint64_t get_cached_bytes() const
+    {
+        return 4ull * cached_background.viewport_width * cached_background.viewport_height;
+    }
+
+    /**
+     * Mark the cached background as outdated in the given region.
+     *
+     * @param damage The region whose contents changed, in the coordinate
+     *   system of the output's render target.
+     */
+    void invalidate_cache(const wf::region_t& damage)
+    {
+        if (cached_valid.empty() || damage.empty())
+        {
+            return;
+        }
+
+        // The blurred value of a pixel depends on all pixels within the blur
+        // radius.
+        auto fb_damage = cached_target.framebuffer_region_from_geometry_region(damage);
+        fb_damage.expand_edges(self->provider()->calculate_blur_radius());
+        cached_valid ^= fb_damage;
+    }
+
+    /**
+     * Check whether the blurred background can be cached when rendering to
+     * @target. This is the case only for the output's own render target,
+     * because the damage tracker knows only about its damage.
+     *
+     * Blurred views are below the output node, so @target is in output-local
+     * coordinates, like the output's render target.
+     */
+    bool can_cache(const wf::render_target_t& target)
+    {
+        if (!tracker || !tracker->is_enabled() || target.subbuffer)
+        {
+            return false;
+        }
+
+        auto output_target = tracker->get_output()->render->get_target_framebuffer();
+        return (target.fb == output_target.fb) && (target.geometry == output_target.geometry);
+    }
+
+    /**
+     * Prepare the cached background for rendering to @target, dropping it if
+     * the target or the view geometry changed.
+     *
+     * @return Whether the cache can be used for @target at all.
+     */
+    bool update_cache_target(const wf::render_target_t& target)
+    {
+        if (!can_cache(target))
+        {
+            if (cached_background.fb != (uint) - 1)
+            {
+                OpenGL::render_begin();
+                cached_background.release();
+                OpenGL::render_end();
+            }
+
+            cached_valid.clear();
+            return false;
+        }
+
+        auto view_box = target.framebuffer_box_from_geometry_box(self->get_bounding_box());
+        if ((view_box != cached_box) || (target.scale != cached_target.scale) ||
+            (target.wl_transform != cached_target.wl_transform) ||
+            (target.geometry != cached_target.geometry) ||
+            (target.viewport_width != cached_target.viewport_width) ||
+            (target.viewport_height != cached_target.viewport_height))
+        {
+            cached_valid.clear();
+        }
+
+        cached_target = target;
+        cached_box    = view_box;
+        return true;
+    }
+
     bool is_fully_opaque(wf::region_t damage)
     {
         if (self->get_children().size() == 1)
@@ -111,6 +388,15 @@ class blur_render_instance_t : public transformer_render_instance_t<blur_node_t>
     void schedule_instructions(std::vector<render_instruction_t>& instructions,
         const wf::render_target_t& target, wf::region_t& damage) override
     {
+        if (saved_pixels)
+        {
+            // The last scheduled instruction was never rendered
+            OpenGL::render_begin();
+            release_saved_pixels();
+            OpenGL::render_end();
+        }
+
+        saved_pixels_region.clear();
         const int padding = calculate_damage_padding(target, self->provider()->calculate_blur_radius());
         auto bbox = self->get_bounding_box();
 
@@ -135,6 +421,33 @@ class blur_render_instance_t : public transformer_render_instance_t<blur_node_t>
             return;
         }
 
+        const bool use_cache = update_cache_target(target);
+        blurred_region = target.framebuffer_region_from_geometry_region(
+            calculate_translucent_damage(target, padded_region & target.geometry));
+        render_from_cache = use_cache && (blurred_region ^ cached_valid).empty();
+        if (use_cache)
+        {
+            ++(render_from_cache ? tracker->cache_hits : tracker->cache_misses);
+        }
+
+        if (render_from_cache)
+        {
+            // The blurred background behind the damaged area did not change,
+            // so it does not need to be sampled again.
+            blurred_region.clear();
+            instructions.push_back(render_instruction_t{
+                        .instance = this,
+                        .target   = target,
+                        .damage   = padded_region & target.geometry,
+                    });
+            return;
+        }
+
+        if (!use_cache)
+        {
+            blurred_region.clear();
+        }
+
         padded_region.expand_edges(padding);
         padded_region &= bbox;
 
@@ -154,18 +467,23 @@ class blur_render_instance_t : public transformer_render_instance_t<blur_node_t>
         damage |= padded_region;
 
         OpenGL::render_begin();
-        saved_pixels.allocate(target.viewport_width, target.viewport_height);
-        saved_pixels.bind();
-        GL_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, target.fb));
-
-        /* Copy pixels in padded_region from target_fb to saved_pixels. */
-        for (const auto& box : saved_pixels_region)
-        {
-            GL_CALL(glBlitFramebuffer(
-                box.x1, target.viewport_height - box.y2,
-                box.x2, target.viewport_height - box.y1,
-                box.x1, box.y1, box.x2, box.y2,
-                GL_COLOR_BUFFER_BIT, GL_LINEAR));
+        if (!saved_pixels_region.empty())
+        {
+            auto extents = saved_pixels_region.get_extents();
+            saved_pixels = self->scratch_pool->acquire(extents.x2 - extents.x1, extents.y2 - extents.y1);
+            saved_pixels->bind();
+            GL_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, target.fb));
+
+            /* Copy pixels in padded_region from target_fb to saved_pixels. */
+            for (const auto& box : saved_pixels_region)
+            {
+                GL_CALL(glBlitFramebuffer(
+                    box.x1, target.viewport_height - box.y2,
+                    box.x2, target.viewport_height - box.y1,
+                    box.x1 - extents.x1, box.y1 - extents.y1,
+                    box.x2 - extents.x1, box.y2 - extents.y1,
+                    GL_COLOR_BUFFER_BIT, GL_LINEAR));
+            }
         }
 
         OpenGL::render_end();
@@ -182,36 +500,66 @@ class blur_render_instance_t : public transformer_render_instance_t<blur_node_t>
         auto bounding_box = self->get_bounding_box();
         if (!damage.empty())
         {
-            auto translucent_damage = calculate_translucent_damage(target, damage);
-            self->provider()->pre_render(bounding_box, translucent_damage, target);
-            auto reg = target.framebuffer_region_from_geometry_region(damage);
+            const bool use_cache = render_from_cache || !blurred_region.empty();
+            if (!render_from_cache)
+            {
+                auto translucent_damage = calculate_translucent_damage(target, damage);
+                if (use_cache)
+                {
+                    // Pixels close to the edges of the overwritten box are not
+                    // blurred correctly, but those in the originally damaged
+                    // region are.
+                    auto written = self->provider()->pre_render(bounding_box,
+                        translucent_damage, target, cached_background);
+                    cached_valid ^= written;
+                    cached_valid |= blurred_region;
+                } else
+                {
+                    self->provider()->pre_render(bounding_box, translucent_damage, target);
+                }
+            }
 
+            auto reg = target.framebuffer_region_from_geometry_region(damage);
             for (const auto& rect : reg)
             {
                 auto damage_box = wlr_box_from_pixman_box(rect);
-                self->provider()->render(tex, bounding_box, damage_box, target);
+                if (use_cache)
+                {
+                    self->provider()->render(tex, bounding_box, damage_box, target, cached_background);
+                } else
+                {
+                    self->provider()->render(tex, bounding_box, damage_box, target);
+                }
             }
         }
 
         OpenGL::render_begin(target);
-        // Setup framebuffer I/O. target_fb contains the frame
-        // rendered with expanded damage and artifacts on the edges.
-        // saved_pixels has the the padded region of pixels to overwrite the
-        // artifacts that blurring has left behind.
-        GL_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, saved_pixels.fb));
-
-        /* Copy pixels back from saved_pixels to target_fb. */
-        for (const auto& box : saved_pixels_region)
-        {
-            GL_CALL(glBlitFramebuffer(
-                box.x1, box.y1, box.x2, box.y2,
-                box.x1, target.viewport_height - box.y2,
-                box.x2, target.viewport_height - box.y1,
-                GL_COLOR_BUFFER_BIT, GL_LINEAR));
+        if (saved_pixels)
+        {
+            // Setup framebuffer I/O. target_fb contains the frame
+            // rendered with expanded damage and artifacts on the edges.
+            // saved_pixels has the the padded region of pixels to overwrite the
+            // artifacts that blurring has left behind.
+            auto extents = saved_pixels_region.get_extents();
+            GL_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, saved_pixels->fb));
+
+            /* Copy pixels back from saved_pixels to target_fb. */
+            for (const auto& box : saved_pixels_region)
+            {
+                GL_CALL(glBlitFramebuffer(
+                    box.x1 - extents.x1, box.y1 - extents.y1,
+                    box.x2 - extents.x1, box.y2 - extents.y1,
+                    box.x1, target.viewport_height - box.y2,
+                    box.x2, target.viewport_height - box.y1,
+                    GL_COLOR_BUFFER_BIT, GL_LINEAR));
+            }
         }
 
         /* Reset stuff */
+        release_saved_pixels();
         saved_pixels_region.clear();
+        blurred_region.clear();
+        render_from_cache = false;
         OpenGL::render_end();
     }
 
@@ -235,6 +583,64 @@ void blur_node_t::gen_render_instances(std::vector<render_instance_uptr>& instan
 }
 }
 
+void blur_damage_tracker_t::detach()
+{
+    if (!output)
+    {
+        return;
+    }
+
+    output->render->rem_effect(&on_frame);
+    output = nullptr;
+    for (auto& instance : instances)
+    {
+        instance->flush_pending_damage();
+    }
+}
+
+uint64_t blur_damage_tracker_t::get_cached_bytes() const
+{
+    uint64_t bytes = 0;
+    for (auto& instance : instances)
+    {
+        bytes += instance->get_cached_bytes();
+    }
+
+    return bytes;
+}
+
+void blur_damage_tracker_t::flush_damage()
+{
+    if (instances.empty())
+    {
+        return;
+    }
+
+    // At this point, the damage scheduled on the output does not contain the
+    // damage of the blurred views themselves, which is held back. However,
+    // a blurred view may be below another one, so its damage still changes
+    // the background of the others. Both are in output-local coordinates.
+    const auto& background_damage = output->render->get_scheduled_damage();
+    for (auto& instance : instances)
+    {
+        wf::region_t damage = background_damage;
+        for (auto& other : instances)
+        {
+            if (other != instance)
+            {
+                damage |= other->get_pending_damage();
+            }
+        }
+
+        instance->invalidate_cache(damage);
+    }
+
+    for (auto& instance : instances)
+    {
+        instance->flush_pending_damage();
+    }
+}
+
 class wayfire_blur : public wf::plugin_interface_t
 {
     // Before doing a render pass, expand the damage by the blur radius.
@@ -265,6 +671,74 @@ class wayfire_blur : public wf::plugin_interface_t
         }
     };
 
+    std::map<wf::output_t*, std::shared_ptr<blur_damage_tracker_t>> trackers;
+    wf::signal::connection_t<wf::output_added_signal> on_output_added = [=] (wf::output_added_signal *ev)
+    {
+        trackers[ev->output] = std::make_shared<blur_damage_tracker_t>(ev->output);
+    };
+
+    wf::signal::connection_t<wf::output_pre_remove_signal> on_output_pre_remove =
+        [=] (wf::output_pre_remove_signal *ev)
+    {
+        // Render instances may still hold a reference to the tracker until
+        // they are destroyed together with the output.
+        trackers[ev->output]->detach();
+        trackers.erase(ev->output);
+    };
+
+    std::shared_ptr<blur_scratch_pool_t> scratch_pool = std::make_shared<blur_scratch_pool_t>();
+
+#if __has_include(<ipc-method-repository.hpp>)
+    wf::shared_data::ref_ptr_t<wf::ipc::method_repository_t> method_repository;
+    wf::ipc::method_callback get_memory_usage = [=] (nlohmann::json)
+    {
+        auto stats = scratch_pool->get_stats();
+        auto response = wf::ipc::json_ok();
+        response["scratch"]["buffers"] = stats.buffers;
+        response["scratch"]["allocated-bytes"] = stats.allocated_bytes;
+        response["scratch"]["used-bytes"] = stats.used_bytes;
+        response["scratch"]["peak-bytes"] = stats.peak_bytes;
+
+        uint64_t cached_bytes = 0;
+        for (auto& [output, tracker] : trackers)
+        {
+            cached_bytes += tracker->get_cached_bytes();
+        }
+
+        response["cached-backgrounds-bytes"] = cached_bytes;
+        return response;
+    };
+
+    wf::ipc::method_callback get_pass_stats = [=] (nlohmann::json data)
+    {
+        auto& stats = blur_algorithm->pass_stats;
+        auto response = wf::ipc::json_ok();
+        response["method"] = blur_algorithm->get_algorithm_name();
+        response["passes"] = stats.passes;
+        response["pixels"] = stats.pixels;
+        response["cache"]  = nlohmann::json::object();
+        for (auto& [output, tracker] : trackers)
+        {
+            response["cache"][output->to_string()] = {
+                {"hits", tracker->cache_hits},
+                {"misses", tracker->cache_misses},
+            };
+        }
+
+        if (data.count("reset") && data["reset"].is_boolean() && data["reset"])
+        {
+            stats = {};
+            for (auto& [output, tracker] : trackers)
+            {
+                tracker->cache_hits   = 0;
+                tracker->cache_misses = 0;
+            }
+        }
+
+        return response;
+    };
+#endif
+
     wf::view_matcher_t blur_by_default{"blur/blur_by_default"};
     wf::option_wrapper_t<std::string> method_opt{"blur/method"};
     wf::option_wrapper_t<wf::buttonbinding_t> toggle_button{"blur/toggle"};
@@ -284,7 +758,13 @@ class wayfire_blur : public wf::plugin_interface_t
             return blur_algorithm.get();
         };
 
-        auto node = std::make_shared<wf::scene::blur_node_t>(provider);
+        auto tracker_provider = [=] (wf::output_t *output) -> std::shared_ptr<blur_damage_tracker_t>
+        {
+            auto it = trackers.find(output);
+            return (it == trackers.end()) ? nullptr : it->second;
+        };
+
+        auto node = std::make_shared<wf::scene::blur_node_t>(provider, tracker_provider, scratch_pool);
         tmanager->add_transformer(node, wf::TRANSFORMER_BLUR);
     }
 
@@ -306,6 +786,13 @@ class wayfire_blur : public wf::plugin_interface_t
     void init() override
     {
         wf::get_core().connect(&on_render_pass_begin);
+        wf::get_core().output_layout->connect(&on_output_added);
+        wf::get_core().output_layout->connect(&on_output_pre_remove);
+        for (auto& output : wf::get_core().output_layout->get_outputs())
+        {
+            trackers[output] = std::make_shared<blur_damage_tracker_t>(output);
+        }
+
         blur_method_changed = [=] ()
         {
             blur_algorithm = create_blur_from_name(method_opt);
@@ -337,6 +824,11 @@ class wayfire_blur : public wf::plugin_interface_t
         };
 
         wf::get_core().bindings->add_button(toggle_button, &button_toggle);
+#if __has_include(<ipc-method-repository.hpp>)
+        method_repository->register_method("blur/memory_usage", get_memory_usage);
+        method_repository->register_method("blur/pass_stats", get_pass_stats);
+#endif
+
         provider = [=] () { return this->blur_algorithm.get(); };
         wf::get_core().connect(&on_view_mapped);
 
@@ -353,6 +845,17 @@ class wayfire_blur : public wf::plugin_interface_t
     {
         remove_transformers();
         wf::get_core().bindings->rem_binding(&button_toggle);
+#if __has_include(<ipc-method-repository.hpp>)
+        method_repository->unregister_method("blur/memory_usage");
+        method_repository->unregister_method("blur/pass_stats");
+#endif
+
+        for (auto& [output, tracker] : trackers)
+        {
+            tracker->detach();
+        }
+
+        trackers.clear();
 
         /* Call blur algorithm destructor */
         blur_algorithm = nullptr;
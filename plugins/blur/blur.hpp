@@ -98,6 +98,14 @@ class wf_blur_base
      * view texture */
     OpenGL::program_t blend_program;
 
+    /* handles for the inputs which the programs of all algorithms have */
+    OpenGL::attrib_t position_attrib[2];
+    OpenGL::uniform_t offset_uniform[2];
+
+    /* handles for the inputs of blend_program */
+    OpenGL::attrib_t blend_position, blend_uv;
+    OpenGL::uniform_t blend_background_inverse, blend_mvp, blend_bg_texture, blend_sat;
+
     /* used to get individual algorithm options from config
      * should be set by the constructor */
     std::string algorithm_name;
@@ -127,17 +135,54 @@ class wf_blur_base
     wf_blur_base(std::string name);
     virtual ~wf_blur_base();
 
+    /* statistics about the work done by render_iteration(), used for
+     * comparing the algorithms */
+    struct pass_stats_t
+    {
+        /* number of blur passes */
+        uint64_t passes = 0;
+        /* number of pixels written by the blur passes */
+        uint64_t pixels = 0;
+    };
+
+    pass_stats_t pass_stats;
+
+    const std::string& get_algorithm_name() const
+    {
+        return algorithm_name;
+    }
+
     virtual int calculate_blur_radius();
 
     virtual void pre_render(wlr_box src_box,
         const wf::region_t& damage, const wf::render_target_t& target_fb);
 
+    /**
+     * Same as pre_render(), but the blurred background is stored in @result
+     * instead of the internal buffer. The parts of @result outside of the
+     * returned box are left untouched, so it can be used to keep a blurred
+     * background across frames.
+     *
+     * @return The box of @result which was overwritten, in framebuffer
+     *   coordinates of @target_fb.
+     */
+    wlr_box pre_render(wlr_box src_box, const wf::region_t& damage,
+        const wf::render_target_t& target_fb, wf::framebuffer_t& result);
+
     virtual void render(wf::texture_t src_tex, wlr_box src_box,
         wlr_box scissor_box, const wf::render_target_t& target_fb);
+
+    /**
+     * Same as render(), but blends with the blurred background stored in
+     * @background, as filled by pre_render().
+     */
+    void render(wf::texture_t src_tex, wlr_box src_box, wlr_box scissor_box,
+        const wf::render_target_t& target_fb, const wf::framebuffer_t& background);
 };
 
 std::unique_ptr<wf_blur_base> create_box_blur();
 std::unique_ptr<wf_blur_base> create_bokeh_blur();
 std::unique_ptr<wf_blur_base> create_kawase_blur();
 std::unique_ptr<wf_blur_base> create_gaussian_blur();
+std::unique_ptr<wf_blur_base> create_dual_blur();
 std::unique_ptr<wf_blur_base> create_blur_from_name(std::string algorithm_name);
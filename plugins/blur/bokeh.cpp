@@ -56,13 +56,17 @@ void main()
 
 class wf_bokeh_blur : public wf_blur_base
 {
+    OpenGL::uniform_t halfpixel, iterations_uniform;
+
   public:
     wf_bokeh_blur() : wf_blur_base("bokeh")
     {
         OpenGL::render_begin();
-        program[0].set_simple(OpenGL::compile_program(bokeh_vertex_shader,
-            bokeh_fragment_shader));
+        program[0].set_simple(bokeh_vertex_shader, bokeh_fragment_shader);
         OpenGL::render_end();
+
+        halfpixel = program[0].get_uniform("halfpixel");
+        iterations_uniform = program[0].get_uniform("iterations");
     }
 
     int blur_fb0(const wf::region_t& blur_region, int width, int height) override
@@ -80,11 +84,11 @@ class wf_bokeh_blur : public wf_blur_base
         OpenGL::render_begin();
         /* Upload data to shader */
         program[0].use(wf::TEXTURE_TYPE_RGBA);
-        program[0].uniform2f("halfpixel", 0.5f / width, 0.5f / height);
-        program[0].uniform1f("offset", offset);
-        program[0].uniform1i("iterations", iterations);
+        program[0].uniform2f(halfpixel, 0.5f / width, 0.5f / height);
+        program[0].uniform1f(offset_uniform[0], offset);
+        program[0].uniform1i(iterations_uniform, iterations);
 
-        program[0].attrib_pointer("position", 2, 0, vertexData);
+        program[0].attrib_pointer(position_attrib[0], 2, 0, vertexData);
         GL_CALL(glDisable(GL_BLEND));
         render_iteration(blur_region, fb[0], fb[1], width, height);
 
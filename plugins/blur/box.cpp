@@ -70,18 +70,23 @@ void main()
 
 class wf_box_blur : public wf_blur_base
 {
+    OpenGL::uniform_t size_uniform[2];
+
   public:
     void get_id_locations(int i)
-    {}
+    {
+        size_uniform[i] = program[i].get_uniform("size");
+    }
 
     wf_box_blur() : wf_blur_base("box")
     {
         OpenGL::render_begin();
-        program[0].set_simple(OpenGL::compile_program(
-            box_vertex_shader, box_fragment_shader_horz));
-        program[1].set_simple(OpenGL::compile_program(
-            box_vertex_shader, box_fragment_shader_vert));
+        program[0].set_simple(box_vertex_shader, box_fragment_shader_horz);
+        program[1].set_simple(box_vertex_shader, box_fragment_shader_vert);
         OpenGL::render_end();
+
+        get_id_locations(0);
+        get_id_locations(1);
     }
 
     void upload_data(int i, int width, int height)
@@ -95,9 +100,9 @@ class wf_box_blur : public wf_blur_base
         };
 
         program[i].use(wf::TEXTURE_TYPE_RGBA);
-        program[i].uniform2f("size", width, height);
-        program[i].uniform1f("offset", offset);
-        program[i].attrib_pointer("position", 2, 0, vertexData);
+        program[i].uniform2f(size_uniform[i], width, height);
+        program[i].uniform1f(offset_uniform[i], offset);
+        program[i].attrib_pointer(position_attrib[i], 2, 0, vertexData);
     }
 
     void blur(const wf::region_t& blur_region, int i, int width, int height)
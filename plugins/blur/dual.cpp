@@ -0,0 +1,219 @@
+#include "blur.hpp"
+
+static const char *dual_vertex_shader =
+    R"(
+#version 100
+attribute mediump vec2 position;
+
+varying mediump vec2 uv;
+
+void main() {
+    gl_Position = vec4(position.xy, 0.0, 1.0);
+    uv = (position.xy + vec2(1.0, 1.0)) / 2.0;
+})";
+
+static const char *dual_fragment_shader_down =
+    R"(
+#version 100
+precision mediump float;
+
+uniform float offset;
+uniform vec2 halfpixel;
+uniform sampler2D bg_texture;
+
+varying mediump vec2 uv;
+
+void main()
+{
+    vec4 sum = texture2D(bg_texture, uv) * 4.0;
+    sum += texture2D(bg_texture, uv - halfpixel.xy * offset);
+    sum += texture2D(bg_texture, uv + halfpixel.xy * offset);
+    sum += texture2D(bg_texture, uv + vec2(halfpixel.x, -halfpixel.y) * offset);
+    sum += texture2D(bg_texture, uv - vec2(halfpixel.x, -halfpixel.y) * offset);
+    gl_FragColor = sum / 8.0;
+})";
+
+static const char *dual_fragment_shader_up =
+    R"(
+#version 100
+precision mediump float;
+
+uniform float offset;
+uniform vec2 halfpixel;
+uniform sampler2D bg_texture;
+
+varying mediump vec2 uv;
+
+void main()
+{
+    vec4 sum = texture2D(bg_texture, uv + vec2(-halfpixel.x * 2.0, 0.0) * offset);
+    sum += texture2D(bg_texture, uv + vec2(-halfpixel.x, halfpixel.y) * offset) * 2.0;
+    sum += texture2D(bg_texture, uv + vec2(0.0, halfpixel.y * 2.0) * offset);
+    sum += texture2D(bg_texture, uv + vec2(halfpixel.x, halfpixel.y) * offset) * 2.0;
+    sum += texture2D(bg_texture, uv + vec2(halfpixel.x * 2.0, 0.0) * offset);
+    sum += texture2D(bg_texture, uv + vec2(halfpixel.x, -halfpixel.y) * offset) * 2.0;
+    sum += texture2D(bg_texture, uv + vec2(0.0, -halfpixel.y * 2.0) * offset);
+    sum += texture2D(bg_texture, uv + vec2(-halfpixel.x, -halfpixel.y) * offset) * 2.0;
+    gl_FragColor = sum / 12.0;
+})";
+
+/**
+ * Dual filter blur: the background is repeatedly downsampled to half of its
+ * size and then upsampled back, with a small filter applied in each pass.
+ *
+ * Each level of the downsample pyramid doubles the blur radius, so the number
+ * of passes grows with the logarithm of the configured radius, and the deeper
+ * passes cost only a fraction of the first one. The offset of the filter is
+ * then adjusted, so that the resulting radius matches the configured one.
+ *
+ * Unlike kawase, every level of the pyramid has its own buffer, which is kept
+ * between frames and reallocated only when the size of the blurred region
+ * changes.
+ */
+class wf_dual_blur : public wf_blur_base
+{
+    wf::option_wrapper_t<int> radius_opt;
+
+    /* Levels 1 and deeper of the pyramid, level 0 is fb[0] */
+    std::vector<wf::framebuffer_t> levels;
+
+    OpenGL::uniform_t halfpixel[2];
+
+    /** @return The number of levels of the pyramid for the configured radius. */
+    int get_depth()
+    {
+        const int max_depth = std::max(1, (int)iterations_opt);
+        const double offset = std::max(0.1, (double)offset_opt);
+
+        // Each level doubles the radius of the blur, which is 2 * offset
+        // (in pixels of the degraded buffer) for one level.
+        int depth = 1;
+        while ((depth < max_depth) && ((1 << (depth + 1)) * offset * degrade_opt < radius_opt))
+        {
+            ++depth;
+        }
+
+        return depth;
+    }
+
+    /** @return The offset of the filter which gives the configured radius. */
+    float get_offset(int depth)
+    {
+        const float needed = 1.0 * radius_opt / ((1 << (depth + 1)) * degrade_opt);
+        return std::min(needed, (float)std::max(0.1, (double)offset_opt));
+    }
+
+  public:
+    wf_dual_blur() : wf_blur_base("dual")
+    {
+        radius_opt.load_option("blur/dual_radius");
+        radius_opt.set_callback(options_changed);
+
+        OpenGL::render_begin();
+        program[0].set_simple(dual_vertex_shader, dual_fragment_shader_down);
+        program[1].set_simple(dual_vertex_shader, dual_fragment_shader_up);
+        OpenGL::render_end();
+
+        halfpixel[0] = program[0].get_uniform("halfpixel");
+        halfpixel[1] = program[1].get_uniform("halfpixel");
+    }
+
+    ~wf_dual_blur()
+    {
+        OpenGL::render_begin();
+        for (auto& level : levels)
+        {
+            level.release();
+        }
+
+        OpenGL::render_end();
+    }
+
+    int blur_fb0(const wf::region_t& blur_region, int width, int height) override
+    {
+        const int depth    = get_depth();
+        const float offset = get_offset(depth);
+
+        static const float vertexData[] = {
+            -1.0f, -1.0f,
+            1.0f, -1.0f,
+            1.0f, 1.0f,
+            -1.0f, 1.0f
+        };
+
+        OpenGL::render_begin();
+        if ((int)levels.size() > depth)
+        {
+            // Free the levels which are no longer needed after a config change
+            for (size_t i = depth; i < levels.size(); i++)
+            {
+                levels[i].release();
+            }
+        }
+
+        levels.resize(depth);
+        auto get_level = [&] (int i) -> wf::framebuffer_t&
+        {
+            return (i == 0) ? fb[0] : levels[i - 1];
+        };
+
+        auto level_size = [&] (int i)
+        {
+            return wf::dimensions_t{
+                std::max(1, (width + (1 << i) - 1) >> i),
+                std::max(1, (height + (1 << i) - 1) >> i),
+            };
+        };
+
+        /* Disable blending, because we may have transparent background, which
+         * we want to render on uncleared framebuffer */
+        GL_CALL(glDisable(GL_BLEND));
+
+        /* Downsample */
+        program[0].use(wf::TEXTURE_TYPE_RGBA);
+        program[0].attrib_pointer(position_attrib[0], 2, 0, vertexData);
+        program[0].uniform1f(offset_uniform[0], offset);
+        for (int i = 1; i <= depth; i++)
+        {
+            auto size = level_size(i);
+            program[0].uniform2f(halfpixel[0], 0.5f / size.width, 0.5f / size.height);
+            render_iteration(blur_region * (1.0 / (1 << i)), get_level(i - 1), get_level(i),
+                size.width, size.height);
+        }
+
+        program[0].deactivate();
+
+        /* Upsample, the last pass goes to fb[1] which has the size of fb[0] */
+        program[1].use(wf::TEXTURE_TYPE_RGBA);
+        program[1].attrib_pointer(position_attrib[1], 2, 0, vertexData);
+        program[1].uniform1f(offset_uniform[1], offset);
+        for (int i = depth - 1; i >= 0; i--)
+        {
+            auto size = level_size(i);
+            program[1].uniform2f(halfpixel[1], 0.5f / size.width, 0.5f / size.height);
+            render_iteration(blur_region * (1.0 / (1 << i)), get_level(i + 1),
+                (i == 0) ? fb[1] : get_level(i), size.width, size.height);
+        }
+
+        /* Reset gl state */
+        GL_CALL(glEnable(GL_BLEND));
+        GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
+
+        program[1].deactivate();
+        GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
+        OpenGL::render_end();
+
+        return 1;
+    }
+
+    int calculate_blur_radius() override
+    {
+        const int depth = get_depth();
+        return std::ceil((1 << (depth + 1)) * get_offset(depth) * degrade_opt);
+    }
+};
+
+std::unique_ptr<wf_blur_base> create_dual_blur()
+{
+    return std::make_unique<wf_dual_blur>();
+}
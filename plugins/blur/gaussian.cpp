@@ -69,15 +69,18 @@ void main()
 
 class wf_gaussian_blur : public wf_blur_base
 {
+    OpenGL::uniform_t size_uniform[2];
+
   public:
     wf_gaussian_blur() : wf_blur_base("gaussian")
     {
         OpenGL::render_begin();
-        program[0].set_simple(OpenGL::compile_program(
-            gaussian_vertex_shader, gaussian_fragment_shader_horz));
-        program[1].set_simple(OpenGL::compile_program(
-            gaussian_vertex_shader, gaussian_fragment_shader_vert));
+        program[0].set_simple(gaussian_vertex_shader, gaussian_fragment_shader_horz);
+        program[1].set_simple(gaussian_vertex_shader, gaussian_fragment_shader_vert);
         OpenGL::render_end();
+
+        size_uniform[0] = program[0].get_uniform("size");
+        size_uniform[1] = program[1].get_uniform("size");
     }
 
     void upload_data(int i, int width, int height)
@@ -91,9 +94,9 @@ class wf_gaussian_blur : public wf_blur_base
         };
 
         program[i].use(wf::TEXTURE_TYPE_RGBA);
-        program[i].uniform2f("size", width, height);
-        program[i].uniform1f("offset", offset);
-        program[i].attrib_pointer("position", 2, 0, vertexData);
+        program[i].uniform2f(size_uniform[i], width, height);
+        program[i].uniform1f(offset_uniform[i], offset);
+        program[i].attrib_pointer(position_attrib[i], 2, 0, vertexData);
     }
 
     void blur(const wf::region_t& blur_region, int i, int width, int height)
@@ -59,15 +59,18 @@ void main()
 
 class wf_kawase_blur : public wf_blur_base
 {
+    OpenGL::uniform_t halfpixel[2];
+
   public:
     wf_kawase_blur() : wf_blur_base("kawase")
     {
         OpenGL::render_begin();
-        program[0].set_simple(OpenGL::compile_program(kawase_vertex_shader,
-            kawase_fragment_shader_down));
-        program[1].set_simple(OpenGL::compile_program(kawase_vertex_shader,
-            kawase_fragment_shader_up));
+        program[0].set_simple(kawase_vertex_shader, kawase_fragment_shader_down);
+        program[1].set_simple(kawase_vertex_shader, kawase_fragment_shader_up);
         OpenGL::render_end();
+
+        halfpixel[0] = program[0].get_uniform("halfpixel");
+        halfpixel[1] = program[1].get_uniform("halfpixel");
     }
 
     int blur_fb0(const wf::region_t& blur_region, int width, int height) override
@@ -88,11 +91,11 @@ class wf_kawase_blur : public wf_blur_base
         program[0].use(wf::TEXTURE_TYPE_RGBA);
 
         /* Downsample */
-        program[0].attrib_pointer("position", 2, 0, vertexData);
+        program[0].attrib_pointer(position_attrib[0], 2, 0, vertexData);
         /* Disable blending, because we may have transparent background, which
          * we want to render on uncleared framebuffer */
         GL_CALL(glDisable(GL_BLEND));
-        program[0].uniform1f("offset", offset);
+        program[0].uniform1f(offset_uniform[0], offset);
 
         for (int i = 0; i < iterations; i++)
         {
@@ -101,7 +104,7 @@ class wf_kawase_blur : public wf_blur_base
 
             auto region = blur_region * (1.0 / (1 << i));
 
-            program[0].uniform2f("halfpixel",
+            program[0].uniform2f(halfpixel[0],
                 0.5f / sampleWidth, 0.5f / sampleHeight);
             render_iteration(region, fb[i % 2], fb[1 - i % 2], sampleWidth,
                 sampleHeight);
@@ -111,8 +114,8 @@ class wf_kawase_blur : public wf_blur_base
 
         /* Upsample */
         program[1].use(wf::TEXTURE_TYPE_RGBA);
-        program[1].attrib_pointer("position", 2, 0, vertexData);
-        program[1].uniform1f("offset", offset);
+        program[1].attrib_pointer(position_attrib[1], 2, 0, vertexData);
+        program[1].uniform1f(offset_uniform[1], offset);
         for (int i = iterations - 1; i >= 0; i--)
         {
             sampleWidth  = width / (1 << i);
@@ -120,7 +123,7 @@ class wf_kawase_blur : public wf_blur_base
 
             auto region = blur_region * (1.0 / (1 << i));
 
-            program[1].uniform2f("halfpixel",
+            program[1].uniform2f(halfpixel[1],
                 0.5f / sampleWidth, 0.5f / sampleHeight);
             render_iteration(region, fb[1 - i % 2], fb[i % 2], sampleWidth,
                 sampleHeight);
@@ -0,0 +1,137 @@
+#include "scratch-pool.hpp"
+#include <wayfire/util.hpp>
+#include <wayfire/debug.hpp>
+#include <algorithm>
+
+/**
+ * Buffer sizes are rounded up to a multiple of this, so that a buffer can be
+ * reused when the damage (and with it the size of the copied region) changes
+ * slightly between frames.
+ */
+static constexpr int SIZE_GRANULARITY = 64;
+
+/** Free buffers which have not been used for this many milliseconds. */
+static constexpr int64_t IDLE_TIMEOUT = 2000;
+
+static uint64_t buffer_bytes(const wf::framebuffer_t& buffer)
+{
+    // RGBA8 textures
+    return 4ull * buffer.viewport_width * buffer.viewport_height;
+}
+
+static int round_up(int x)
+{
+    return SIZE_GRANULARITY * ((std::max(x, 1) + SIZE_GRANULARITY - 1) / SIZE_GRANULARITY);
+}
+
+blur_scratch_pool_t::~blur_scratch_pool_t()
+{
+    OpenGL::render_begin();
+    for (auto& entry : entries)
+    {
+        entry->buffer.release();
+    }
+
+    OpenGL::render_end();
+}
+
+wf::framebuffer_t *blur_scratch_pool_t::acquire(int width, int height)
+{
+    // Best fit: the smallest free buffer which is large enough.
+    entry_t *best = nullptr;
+    for (auto& entry : entries)
+    {
+        auto& buffer = entry->buffer;
+        if (entry->in_use || (buffer.viewport_width < width) || (buffer.viewport_height < height))
+        {
+            continue;
+        }
+
+        if (!best || (buffer_bytes(buffer) < buffer_bytes(best->buffer)))
+        {
+            best = entry.get();
+        }
+    }
+
+    if (!best)
+    {
+        entries.push_back(std::make_unique<entry_t>());
+        best = entries.back().get();
+        best->buffer.allocate(round_up(width), round_up(height));
+        peak_bytes = std::max(peak_bytes, get_stats().allocated_bytes);
+    }
+
+    best->in_use    = true;
+    best->last_used = wf::get_current_time();
+    return &best->buffer;
+}
+
+void blur_scratch_pool_t::release(wf::framebuffer_t *buffer)
+{
+    auto it = std::find_if(entries.begin(), entries.end(), [&] (const auto& entry)
+    {
+        return &entry->buffer == buffer;
+    });
+
+    wf::dassert(it != entries.end(), "Releasing a buffer which is not part of the scratch pool!");
+    (*it)->in_use    = false;
+    (*it)->last_used = wf::get_current_time();
+    trim();
+
+    // Blur may not be rendered again for a long time, for ex. when the blurred
+    // views are closed, so free the remaining buffers without waiting for the
+    // next release().
+    if (!trim_timer.is_connected())
+    {
+        trim_timer.set_timeout(IDLE_TIMEOUT, [=] ()
+        {
+            OpenGL::render_begin();
+            trim();
+            OpenGL::render_end();
+            return has_free_buffers();
+        });
+    }
+}
+
+bool blur_scratch_pool_t::has_free_buffers() const
+{
+    return std::any_of(entries.begin(), entries.end(), [] (const auto& entry)
+    {
+        return !entry->in_use;
+    });
+}
+
+void blur_scratch_pool_t::trim()
+{
+    const int64_t now = wf::get_current_time();
+    auto idle = [&] (const std::unique_ptr<entry_t>& entry)
+    {
+        if (entry->in_use || (now - entry->last_used < IDLE_TIMEOUT))
+        {
+            return false;
+        }
+
+        entry->buffer.release();
+        return true;
+    };
+
+    entries.erase(std::remove_if(entries.begin(), entries.end(), idle), entries.end());
+}
+
+blur_scratch_pool_t::stats_t blur_scratch_pool_t::get_stats() const
+{
+    stats_t stats;
+    for (auto& entry : entries)
+    {
+        const uint64_t bytes = buffer_bytes(entry->buffer);
+        stats.buffers++;
+        stats.allocated_bytes += bytes;
+        if (entry->in_use)
+        {
+            stats.used_bytes += bytes;
+        }
+    }
+
+    stats.peak_bytes = std::max(peak_bytes, stats.allocated_bytes);
+    return stats;
+}
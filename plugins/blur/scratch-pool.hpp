@@ -0,0 +1,77 @@
+#pragma once
+
+#include <wayfire/opengl.hpp>
+#include <wayfire/util.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * A pool of framebuffers for short-lived copies of parts of a render target,
+ * for ex. the pixels which a blurred view saves before rendering and restores
+ * afterwards. The pool is shared by all blurred views on all outputs, so that
+ * the memory used depends on the largest copies made in a frame, and not on the
+ * number of blurred views or the size of the outputs.
+ */
+class blur_scratch_pool_t
+{
+  public:
+    blur_scratch_pool_t() = default;
+    ~blur_scratch_pool_t();
+
+    blur_scratch_pool_t(const blur_scratch_pool_t&) = delete;
+    blur_scratch_pool_t& operator =(const blur_scratch_pool_t&) = delete;
+
+    /**
+     * Get a framebuffer which is at least @width x @height pixels large. Its
+     * contents are undefined. The buffer stays reserved until it is passed to
+     * release().
+     *
+     * Needs to be called between OpenGL::render_begin() and
+     * OpenGL::render_end().
+     */
+    wf::framebuffer_t *acquire(int width, int height);
+
+    /**
+     * Return a buffer obtained with acquire() to the pool. Buffers which have
+     * not been used for a while are freed at this point, or later by a timer
+     * if no more buffers are released.
+     *
+     * Needs to be called between OpenGL::render_begin() and
+     * OpenGL::render_end().
+     */
+    void release(wf::framebuffer_t *buffer);
+
+    struct stats_t
+    {
+        // Number of buffers in the pool, including those in use.
+        int buffers = 0;
+        // Memory used by all buffers in the pool, in bytes.
+        uint64_t allocated_bytes = 0;
+        // Memory used by the buffers which are currently acquired, in bytes.
+        uint64_t used_bytes = 0;
+        // The largest value of @allocated_bytes so far.
+        uint64_t peak_bytes = 0;
+    };
+
+    stats_t get_stats() const;
+
+  private:
+    struct entry_t
+    {
+        wf::framebuffer_t buffer;
+        bool in_use = false;
+        int64_t last_used = 0;
+    };
+
+    std::vector<std::unique_ptr<entry_t>> entries;
+    uint64_t peak_bytes = 0;
+    // Runs trim() while there are free buffers
+    wf::wl_timer<true> trim_timer;
+
+    /** Free the buffers which are not in use and have not been used recently. */
+    void trim();
+
+    /** @return Whether any buffer is not in use. */
+    bool has_free_buffers() const;
+};
@@ -226,7 +226,7 @@ class scale_around_grab_t : public wf::scene::floating_inner_node_t
             const wf::region_t& region) override
         {
             auto bbox = self->get_bounding_box();
-            auto tex  = this->get_texture(target.scale);
+            auto tex  = this->get_texture(get_texture_scale(target, 1.0 / self->scale_factor));
 
             OpenGL::render_begin(target);
             for (auto& rect : region)
@@ -190,6 +190,8 @@ class wayfire_cube : public wf::per_output_plugin_instance_t, public wf::pointer
     float identity_z_offset;
 
     OpenGL::program_t program;
+    OpenGL::attrib_t position_attrib, uv_attrib;
+    OpenGL::uniform_t model_uniform, vp_uniform, deform_uniform, light_uniform, ease_uniform;
 
     wf_cube_animation_attribs animation;
     wf::option_wrapper_t<bool> use_light{"cube/light"};
@@ -312,7 +314,7 @@ class wayfire_cube : public wf::per_output_plugin_instance_t, public wf::pointer
 
         if (!tessellation_support)
         {
-            program.set_simple(OpenGL::compile_program(cube_vertex_2_0, cube_fragment_2_0));
+            program.set_simple(cube_vertex_2_0, cube_fragment_2_0);
         } else
         {
 #ifdef USE_GLES32
@@ -343,6 +345,14 @@ class wayfire_cube : public wf::per_output_plugin_instance_t, public wf::pointer
 #endif
         }
 
+        position_attrib = program.get_attrib("position");
+        uv_attrib = program.get_attrib("uvPosition");
+        model_uniform  = program.get_uniform("model");
+        vp_uniform     = program.get_uniform("VP");
+        deform_uniform = program.get_uniform("deform");
+        light_uniform  = program.get_uniform("light");
+        ease_uniform   = program.get_uniform("ease");
+
         animation.projection = glm::perspective(45.0f, 1.f, 0.1f, 100.f);
     }
 
@@ -611,7 +621,7 @@ class wayfire_cube : public wf::per_output_plugin_instance_t, public wf::pointer
             GL_CALL(glBindTexture(GL_TEXTURE_2D, buffers[index].tex));
 
             auto model = calculate_model_matrix(i, fb_transform);
-            program.uniformMatrix4f("model", model);
+            program.uniformMatrix4f(model_uniform, model);
 
             if (tessellation_support)
             {
@@ -661,14 +671,14 @@ class wayfire_cube : public wf::per_output_plugin_instance_t, public wf::pointer
             0.0f, 0.0f
         };
 
-        program.attrib_pointer("position", 2, 0, vertexData);
-        program.attrib_pointer("uvPosition", 2, 0, coordData);
-        program.uniformMatrix4f("VP", vp);
+        program.attrib_pointer(position_attrib, 2, 0, vertexData);
+        program.attrib_pointer(uv_attrib, 2, 0, coordData);
+        program.uniformMatrix4f(vp_uniform, vp);
         if (tessellation_support)
         {
-            program.uniform1i("deform", use_deform);
-            program.uniform1i("light", use_light);
-            program.uniform1f("ease",
+            program.uniform1i(deform_uniform, use_deform);
+            program.uniform1i(light_uniform, use_light);
+            program.uniform1f(ease_uniform,
                 animation.cube_animation.ease_deformation);
         }
 
@@ -26,8 +26,7 @@ wf_cube_background_cubemap::~wf_cube_background_cubemap()
 void wf_cube_background_cubemap::create_program()
 {
     OpenGL::render_begin();
-    program.set_simple(
-        OpenGL::compile_program(cubemap_vertex, cubemap_fragment));
+    program.set_simple(cubemap_vertex, cubemap_fragment);
     OpenGL::render_end();
 }
 
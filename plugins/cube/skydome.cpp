@@ -29,7 +29,7 @@ wf_cube_background_skydome::~wf_cube_background_skydome()
 void wf_cube_background_skydome::load_program()
 {
     OpenGL::render_begin();
-    program.set_simple(OpenGL::compile_program(cube_vertex_2_0, cube_fragment_2_0));
+    program.set_simple(cube_vertex_2_0, cube_fragment_2_0);
     OpenGL::render_end();
 }
 
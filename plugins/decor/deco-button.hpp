@@ -69,10 +69,10 @@ class button_t
      *
      * @param buffer The target framebuffer
      * @param geometry The geometry of the button, in logical coordinates
-     * @param scissor The scissor rectangle to render.
+     * @param damage The region to render.
      */
     void render(const wf::render_target_t& buffer, wf::geometry_t geometry,
-        wf::geometry_t scissor);
+        const wf::region_t& damage);
 
   private:
     const decoration_theme_t& theme;
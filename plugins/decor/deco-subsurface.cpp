@@ -46,7 +46,9 @@ class simple_decoration_node_t : public wf::scene::node_t, public wf::pointer_in
         {
             auto surface = theme.render_text(view->get_title(),
                 target_width, target_height);
+            OpenGL::render_begin();
             cairo_surface_upload_to_texture(surface, title_texture.tex);
+            OpenGL::render_end();
             cairo_surface_destroy(surface);
             title_texture.current_text = view->get_title();
         }
@@ -86,19 +88,19 @@ class simple_decoration_node_t : public wf::scene::node_t, public wf::pointer_in
     }
 
     void render_title(const wf::render_target_t& fb,
-        wf::geometry_t geometry)
+        wf::geometry_t geometry, const wf::region_t& damage)
     {
         update_title(geometry.width, geometry.height, fb.scale);
-        OpenGL::render_texture(title_texture.tex.tex, fb, geometry,
+        OpenGL::batch_texture(wf::texture_t{title_texture.tex.tex}, fb, geometry, damage,
             glm::vec4(1.0f), OpenGL::TEXTURE_TRANSFORM_INVERT_Y);
     }
 
-    void render_scissor_box(const wf::render_target_t& fb, wf::point_t origin,
-        const wlr_box& scissor)
+    void render_region(const wf::render_target_t& fb, wf::point_t origin,
+        const wf::region_t& damage)
     {
         /* Clear background */
         wlr_box geometry{origin.x, origin.y, size.width, size.height};
-        theme.render_background(fb, geometry, scissor, view->activated);
+        theme.render_background(fb, geometry, damage, view->activated);
 
         /* Draw title & buttons */
         auto renderables = layout.get_renderable_areas();
@@ -106,14 +108,11 @@ class simple_decoration_node_t : public wf::scene::node_t, public wf::pointer_in
         {
             if (item->get_type() == wf::decor::DECORATION_AREA_TITLE)
             {
-                OpenGL::render_begin(fb);
-                fb.logic_scissor(scissor);
-                render_title(fb, item->get_geometry() + origin);
-                OpenGL::render_end();
+                render_title(fb, item->get_geometry() + origin, damage);
             } else // button
             {
                 item->as_button().render(fb,
-                    item->get_geometry() + origin, scissor);
+                    item->get_geometry() + origin, damage);
             }
         }
     }
@@ -179,10 +178,17 @@ class simple_decoration_node_t : public wf::scene::node_t, public wf::pointer_in
         void render(const wf::render_target_t& target,
             const wf::region_t& region) override
         {
-            for (const auto& box : region)
-            {
-                self->render_scissor_box(target, self->get_offset(), wlr_box_from_pixman_box(box));
-            }
+            self->render_region(target, self->get_offset(), region);
+        }
+
+        wf::scene::node_t *get_node() const override
+        {
+            return self;
+        }
+
+        bool can_schedule_in_parallel() override
+        {
+            return true;
         }
     };
 
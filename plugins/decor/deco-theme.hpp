@@ -24,13 +24,13 @@ class decoration_theme_t
     /**
      * Fill the given rectangle with the background color(s).
      *
-     * @param fb The target framebuffer, must have been bound already.
+     * @param fb The target framebuffer.
      * @param rectangle The rectangle to redraw.
-     * @param scissor The GL scissor rectangle to use.
+     * @param damage The region of the rectangle to redraw.
      * @param active Whether to use active or inactive colors
      */
     void render_background(const wf::render_target_t& fb, wf::geometry_t rectangle,
-        const wf::geometry_t& scissor, bool active) const;
+        const wf::region_t& damage, bool active) const;
 
     /**
      * Render the given text on a cairo_surface_t with the given size.
@@ -5,8 +5,11 @@
 #include "wayfire/view-helpers.hpp"
 #include <wayfire/view.hpp>
 #include <wayfire/output.hpp>
+#include <wayfire/render-manager.hpp>
+#include <wayfire/scene-render.hpp>
 #include <wayfire/workspace-set.hpp>
 #include <wayfire/output-layout.hpp>
+#include <wayfire/txn/client-latency.hpp>
 #include <getopt.h>
 #include <wayland-server-core.h>
 #include <wayland-server-protocol.h>
@@ -49,6 +52,15 @@ static void locate_wayland_backend(wlr_backend *backend, void *data)
     }
 }
 
+static void locate_headless_backend(wlr_backend *backend, void *data)
+{
+    if (wlr_backend_is_headless(backend))
+    {
+        wlr_backend **result = (wlr_backend**)data;
+        *result = backend;
+    }
+}
+
 namespace wf
 {
 static std::string layer_to_string(std::optional<wf::scene::layer> layer)
@@ -89,6 +101,63 @@ static std::string layer_to_string(std::optional<wf::scene::layer> layer)
     assert(false); // prevent compiler warning
 }
 
+static std::string frame_stage_to_string(wf::frame_stage_t stage)
+{
+    switch (stage)
+    {
+      case wf::FRAME_STAGE_PRE_EFFECTS:
+        return "pre-effects";
+
+      case wf::FRAME_STAGE_DIRECT_SCANOUT:
+        return "direct-scanout";
+
+      case wf::FRAME_STAGE_MAKE_CURRENT:
+        return "make-current";
+
+      case wf::FRAME_STAGE_GATHER_INSTRUCTIONS:
+        return "gather-instructions";
+
+      case wf::FRAME_STAGE_RENDER_INSTANCES:
+        return "render-instances";
+
+      case wf::FRAME_STAGE_OVERLAY_EFFECTS:
+        return "overlay-effects";
+
+      case wf::FRAME_STAGE_POST_EFFECTS:
+        return "post-effects";
+
+      case wf::FRAME_STAGE_SW_CURSORS:
+        return "sw-cursors";
+
+      case wf::FRAME_STAGE_SWAP_BUFFERS:
+        return "swap-buffers";
+
+      default:
+        break;
+    }
+
+    wf::dassert(false, "invalid frame stage!");
+    assert(false); // prevent compiler warning
+}
+
+static std::string frame_result_to_string(wf::frame_result_t result)
+{
+    switch (result)
+    {
+      case wf::frame_result_t::RENDERED:
+        return "rendered";
+
+      case wf::frame_result_t::SCANOUT:
+        return "scanout";
+
+      case wf::frame_result_t::SKIPPED:
+        return "skipped";
+    }
+
+    wf::dassert(false, "invalid frame result!");
+    assert(false); // prevent compiler warning
+}
+
 static const struct wlr_pointer_impl pointer_impl = {
     .name = "stipc-pointer",
 };
@@ -342,6 +411,11 @@ class stipc_plugin_t : public wf::plugin_interface_t
         method_repository->register_method("stipc/tablet/tool_axis", do_tool_axis);
         method_repository->register_method("stipc/tablet/tool_tip", do_tool_tip);
         method_repository->register_method("stipc/tablet/pad_button", do_pad_button);
+        method_repository->register_method("stipc/frame_timings", frame_timings);
+        method_repository->register_method("stipc/repaint_delay", repaint_delay);
+        method_repository->register_method("stipc/client_latency", client_latency);
+        method_repository->register_method("stipc/gpu_profiling", gpu_profiling);
+        method_repository->register_method("stipc/gpu_timings", gpu_timings);
     }
 
     bool is_unloadable() override
@@ -417,7 +491,12 @@ class stipc_plugin_t : public wf::plugin_interface_t
         return wf::ipc::json_ok();
     };
 
-    ipc::method_callback create_wayland_output = [] (nlohmann::json)
+    /**
+     * Create a new output. In nested mode, this is a new wayland window, otherwise (for example, when
+     * benchmarking on the headless backend) a headless output of the size given by the optional `width`
+     * and `height` fields.
+     */
+    ipc::method_callback create_wayland_output = [] (nlohmann::json data)
     {
         auto backend = wf::get_core().backend;
 
@@ -425,13 +504,44 @@ class stipc_plugin_t : public wf::plugin_interface_t
         wlr_multi_for_each_backend(backend, locate_wayland_backend,
             &wayland_backend);
 
-        if (!wayland_backend)
+        wlr_output *output = NULL;
+        if (wayland_backend)
+        {
+            output = wlr_wl_output_create(wayland_backend);
+        } else
+        {
+            wlr_backend *headless_backend = NULL;
+            wlr_multi_for_each_backend(backend, locate_headless_backend, &headless_backend);
+            if (!headless_backend)
+            {
+                return wf::ipc::json_error("Wayfire is not running in nested wayland or headless mode!");
+            }
+
+            int width  = 1280;
+            int height = 720;
+            if (data.contains("width"))
+            {
+                WFJSON_EXPECT_FIELD(data, "width", number_unsigned);
+                width = data["width"];
+            }
+
+            if (data.contains("height"))
+            {
+                WFJSON_EXPECT_FIELD(data, "height", number_unsigned);
+                height = data["height"];
+            }
+
+            output = wlr_headless_add_output(headless_backend, width, height);
+        }
+
+        if (!output)
         {
-            return wf::ipc::json_error("Wayfire is not running in nested wayland mode!");
+            return wf::ipc::json_error("Failed to create output");
         }
 
-        wlr_wl_output_create(wayland_backend);
-        return wf::ipc::json_ok();
+        auto response = wf::ipc::json_ok();
+        response["output"] = output->name;
+        return response;
     };
 
     ipc::method_callback destroy_wayland_output = [] (nlohmann::json data)
@@ -644,6 +754,181 @@ class stipc_plugin_t : public wf::plugin_interface_t
         return wf::ipc::json_ok();
     };
 
+    /**
+     * Dump the timings of the last frames of each output (or only of the output given in the optional
+     * `output` field). The optional `count` field limits the number of returned frames per output.
+     */
+    ipc::method_callback frame_timings = [=] (nlohmann::json data)
+    {
+        std::vector<wf::output_t*> outputs = wf::get_core().output_layout->get_outputs();
+        if (data.contains("output"))
+        {
+            WFJSON_EXPECT_FIELD(data, "output", string);
+            auto wo = wf::get_core().output_layout->find_output(data["output"]);
+            if (!wo)
+            {
+                return wf::ipc::json_error("Unknown output " + (std::string)data["output"]);
+            }
+
+            outputs = {wo};
+        }
+
+        size_t count = wf::FRAME_TIMINGS_HISTORY;
+        if (data.contains("count"))
+        {
+            WFJSON_EXPECT_FIELD(data, "count", number_unsigned);
+            count = data["count"];
+        }
+
+        auto response = wf::ipc::json_ok();
+        response["outputs"] = nlohmann::json::array();
+        for (auto& wo : outputs)
+        {
+            auto timings = wo->render->get_frame_timings();
+            const size_t first = timings.size() - std::min(count, timings.size());
+
+            nlohmann::json frames = nlohmann::json::array();
+            for (size_t i = first; i < timings.size(); i++)
+            {
+                nlohmann::json frame;
+                frame["start"]  = timings[i].start;
+                frame["repaint-delay"] = timings[i].repaint_delay;
+                frame["total"]  = timings[i].total;
+                frame["result"] = frame_result_to_string(timings[i].result);
+                frame["damage-rects"] = timings[i].damage_rects;
+                frame["simplified-damage-rects"] = timings[i].simplified_damage_rects;
+                frame["damage-overdraw"] = timings[i].damage_overdraw;
+                for (int stage = 0; stage < wf::FRAME_STAGE_TOTAL; stage++)
+                {
+                    frame["stages"][frame_stage_to_string((wf::frame_stage_t)stage)] =
+                        timings[i].stage[stage];
+                }
+
+                frames.push_back(frame);
+            }
+
+            nlohmann::json output;
+            output["name"]   = wo->to_string();
+            output["frames"] = frames;
+            response["outputs"].push_back(output);
+        }
+
+        return response;
+    };
+
+    /**
+     * Dump the render time histogram, the chosen repaint delay and the number of missed frames of each
+     * output (or only of the output given in the optional `output` field).
+     */
+    ipc::method_callback repaint_delay = [=] (nlohmann::json data)
+    {
+        std::vector<wf::output_t*> outputs = wf::get_core().output_layout->get_outputs();
+        if (data.contains("output"))
+        {
+            WFJSON_EXPECT_FIELD(data, "output", string);
+            auto wo = wf::get_core().output_layout->find_output(data["output"]);
+            if (!wo)
+            {
+                return wf::ipc::json_error("Unknown output " + (std::string)data["output"]);
+            }
+
+            outputs = {wo};
+        }
+
+        auto response = wf::ipc::json_ok();
+        response["outputs"] = nlohmann::json::array();
+        for (auto& wo : outputs)
+        {
+            auto stats = wo->render->get_repaint_delay_stats();
+
+            nlohmann::json output;
+            output["name"] = wo->to_string();
+            output["predictive"] = stats.predictive;
+            output["delay"]   = stats.delay;
+            output["refresh"] = stats.refresh;
+            output["predicted-render-time"] = stats.predicted_render_time;
+            output["margin"] = stats.margin;
+            output["bucket-size"]   = stats.bucket_size;
+            output["histogram"]     = stats.histogram;
+            output["missed-frames"] = stats.missed_frames;
+            output["total-frames"]  = stats.total_frames;
+            response["outputs"].push_back(output);
+        }
+
+        return response;
+    };
+
+    /**
+     * Dump the configure->commit latency estimates of all clients which responded to a configure so far.
+     */
+    ipc::method_callback client_latency = [=] (nlohmann::json data)
+    {
+        auto response = wf::ipc::json_ok();
+        response["clients"] = nlohmann::json::array();
+        for (auto& stats : wf::txn::get_all_client_latencies())
+        {
+            pid_t pid;
+            wl_client_get_credentials(stats.client, &pid, NULL, NULL);
+
+            nlohmann::json client;
+            client["pid"]       = pid;
+            client["samples"]   = stats.samples;
+            client["average"]   = stats.average;
+            client["deviation"] = stats.deviation;
+            client["max"] = stats.max;
+            auto timeout = wf::txn::get_client_timeout(stats.client);
+            client["timeout"] = timeout ? (int64_t)*timeout : -1;
+            response["clients"].push_back(client);
+        }
+
+        return response;
+    };
+
+    ipc::method_callback gpu_profiling = [=] (nlohmann::json data)
+    {
+        WFJSON_EXPECT_FIELD(data, "enabled", boolean);
+        if (wf::scene::set_gpu_profiling(data["enabled"]) != data["enabled"])
+        {
+            return wf::ipc::json_error("GPU profiling is not supported by the GL driver");
+        }
+
+        return wf::ipc::json_ok();
+    };
+
+    /**
+     * Dump the GPU time statistics of all profiled nodes. If the optional `reset` field is true, the
+     * statistics are cleared afterwards.
+     */
+    ipc::method_callback gpu_timings = [=] (nlohmann::json data)
+    {
+        bool reset = false;
+        if (data.contains("reset"))
+        {
+            WFJSON_EXPECT_FIELD(data, "reset", boolean);
+            reset = data["reset"];
+        }
+
+        auto response = wf::ipc::json_ok();
+        response["nodes"] = nlohmann::json::array();
+        for (auto& entry : wf::scene::get_gpu_timings())
+        {
+            nlohmann::json node;
+            node["name"]     = entry.name;
+            node["samples"]  = entry.samples;
+            node["total-ns"] = entry.total_ns;
+            node["last-ns"]  = entry.last_ns;
+            node["max-ns"]   = entry.max_ns;
+            response["nodes"].push_back(node);
+        }
+
+        if (reset)
+        {
+            wf::scene::reset_gpu_timings();
+        }
+
+        return response;
+    };
+
     std::unique_ptr<headless_input_backend_t> input;
 };
 }
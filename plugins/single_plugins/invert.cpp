@@ -88,8 +88,7 @@ class wayfire_invert_screen : public wf::per_output_plugin_instance_t
         };
 
         OpenGL::render_begin();
-        program.set_simple(
-            OpenGL::compile_program(vertex_shader, fragment_shader));
+        program.set_simple(vertex_shader, fragment_shader);
         OpenGL::render_end();
 
         output->add_activator(toggle_key, &toggle_cb);
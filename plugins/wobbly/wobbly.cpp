@@ -51,11 +51,17 @@ void main()
 }
 
 OpenGL::program_t program;
+OpenGL::attrib_t position_attrib, uv_attrib;
+OpenGL::uniform_t mvp_uniform;
 void load_program()
 {
     OpenGL::render_begin();
     program.compile(vertex_source, frag_source);
     OpenGL::render_end();
+
+    position_attrib = program.get_attrib("position");
+    uv_attrib   = program.get_attrib("uvPosition");
+    mvp_uniform = program.get_uniform("MVP");
 }
 
 void destroy_program()
@@ -126,9 +132,9 @@ void render_triangles(wf::texture_t tex, glm::mat4 mat, float *pos, float *uv,
     program.use(tex.type);
     program.set_active_texture(tex);
 
-    program.attrib_pointer("position", 2, 0, pos);
-    program.attrib_pointer("uvPosition", 2, 0, uv);
-    program.uniformMatrix4f("MVP", mat);
+    program.attrib_pointer(position_attrib, 2, 0, pos);
+    program.attrib_pointer(uv_attrib, 2, 0, uv);
+    program.uniformMatrix4f(mvp_uniform, mat);
 
     GL_CALL(glEnable(GL_BLEND));
     GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
@@ -879,7 +885,7 @@ class wobbly_render_instance_t :
         auto subbox = self->get_children_bounding_box();
 
         wobbly_graphics::prepare_geometry(self->model.get(), subbox, vert, uv);
-        auto tex = get_texture(target_fb.scale);
+        auto tex = get_texture(get_texture_scale(target_fb));
         OpenGL::render_begin(target_fb);
         for (auto& box : damage)
         {
@@ -74,6 +74,8 @@ enum class logging_category : size_t
     WSET    = 6,
     // Keyboard-related events
     KBD     = 7,
+    // Verify cached scenegraph bounding boxes
+    BBOX    = 8,
     TOTAL,
 };
 
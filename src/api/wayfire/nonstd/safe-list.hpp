@@ -1,54 +1,132 @@
 #ifndef WF_SAFE_LIST_HPP
 #define WF_SAFE_LIST_HPP
 
-#include <list>
+#include <vector>
+#include <optional>
 #include <memory>
 #include <algorithm>
 #include <functional>
+#include <stdexcept>
 #include <wayfire/util.hpp>
 
 #include "reverse.hpp"
 
-/* This is a trimmed-down wrapper of std::list<T>.
+/* This is a trimmed-down list backed by a std::vector.
  *
  * It supports safe iteration over all elements in the collection, where any
  * element can be deleted from the list at any given time (i.e even in a
- * for-each-like loop) */
+ * for-each-like loop).
+ *
+ * Erased elements are destroyed immediately, but their slots are kept as
+ * tombstones and removed once no iteration is in progress and enough of them
+ * have accumulated. Elements added during an iteration are kept aside and
+ * inserted when the outermost iteration finishes, so that the storage is never
+ * reallocated while it is being iterated over. */
 namespace wf
 {
 template<class T>
 class safe_list_t
 {
-    wf::wl_idle_call idle_cleanup;
-    std::list<std::unique_ptr<T>> list;
+  public:
+    enum insert_place_t
+    {
+        INSERT_BEFORE,
+        INSERT_AFTER,
+        INSERT_NONE,
+    };
+
+  private:
+    /* An element added while iterating. If check is set, it is inserted with
+     * emplace_at(), otherwise at the end of the list. */
+    struct pending_t
+    {
+        T value;
+        std::function<insert_place_t(T&)> check;
+    };
 
-    /* Remove all invalidated elements in the list */
-    std::function<void()> do_cleanup = [&] ()
+    mutable std::vector<std::optional<T>> list;
+    mutable std::vector<pending_t> pending;
+    mutable int iterating = 0;
+    /* Number of non-erased elements in list */
+    mutable size_t alive = 0;
+
+    /* Insert pending elements and remove tombstones, unless iterating */
+    void do_cleanup() const
     {
-        auto it = list.begin();
-        while (it != list.end())
+        if (iterating > 0)
+        {
+            return;
+        }
+
+        if (!pending.empty())
         {
-            if (*it)
+            auto to_insert = std::move(pending);
+            pending.clear();
+            for (auto& p : to_insert)
+            {
+                insert(std::move(p.value), p.check);
+            }
+        }
+
+        /* Compacting is linear, so wait until at least half of the slots are
+         * tombstones to keep removal amortized O(1) */
+        if ((list.size() - alive) * 2 > list.size())
+        {
+            auto it = std::remove_if(list.begin(), list.end(),
+                [] (const std::optional<T>& el) { return !el.has_value(); });
+            list.erase(it, list.end());
+        }
+    }
+
+    /* Insert the value at the position determined by check, or at the end of
+     * the list if check is not set. Must not be called while iterating. */
+    void insert(T&& value, const std::function<insert_place_t(T&)>& check) const
+    {
+        auto it = check ? list.begin() : list.end();
+        for (; it != list.end(); ++it)
+        {
+            /* Skip empty elements */
+            if (!it->has_value())
+            {
+                continue;
+            }
+
+            auto place = check(**it);
+            if (place == INSERT_AFTER)
             {
                 ++it;
-            } else
+                break;
+            } else if (place == INSERT_BEFORE)
             {
-                it = list.erase(it);
+                break;
             }
         }
-    };
 
-    /* Return whether the list has invalidated elements */
-    bool is_dirty() const
-    {
-        return idle_cleanup.is_connected();
+        list.emplace(it, std::move(value));
+        ++alive;
     }
 
+    /* Marks the list as being iterated over for the lifetime of the guard */
+    struct iteration_guard_t
+    {
+        const safe_list_t *self;
+        iteration_guard_t(const safe_list_t *self) : self(self)
+        {
+            ++self->iterating;
+        }
+
+        ~iteration_guard_t()
+        {
+            --self->iterating;
+            self->do_cleanup();
+        }
+    };
+
   public:
     safe_list_t()
     {}
 
-    /* Copy the not-erased elements from other, but do not copy the idle source */
+    /* Copy the not-erased elements from other */
     safe_list_t(const safe_list_t& other)
     {
         *this = other;
@@ -56,11 +134,18 @@ class safe_list_t
 
     safe_list_t& operator =(const safe_list_t& other)
     {
-        this->idle_cleanup_source = NULL;
+        if (this == &other)
+        {
+            return *this;
+        }
+
+        clear();
         other.for_each([&] (auto& el)
         {
             this->push_back(el);
         });
+
+        return *this;
     }
 
     safe_list_t(safe_list_t&& other) = default;
@@ -68,14 +153,16 @@ class safe_list_t
 
     T& back()
     {
-        /* No invalidated elements */
-        if (!is_dirty())
+        for (auto it = pending.rbegin(); it != pending.rend(); ++it)
         {
-            return *list.back();
+            if (!it->check)
+            {
+                return it->value;
+            }
         }
 
         auto it = list.rbegin();
-        while (it != list.rend() && (*it) == nullptr)
+        while (it != list.rend() && !it->has_value())
         {
             ++it;
         }
@@ -90,78 +177,33 @@ class safe_list_t
 
     size_t size() const
     {
-        if (!is_dirty())
-        {
-            return list.size();
-        }
-
-        /* Count non-null elements, because that's the real size */
-        size_t sz = 0;
-        for (auto& it : list)
-        {
-            sz += (it != nullptr);
-        }
-
-        return sz;
+        return alive + pending.size();
     }
 
     /* Push back by copying */
     void push_back(T value)
     {
-        list.push_back(std::make_unique<T>(std::move(value)));
+        emplace_back(std::move(value));
     }
 
     /* Push back by moving */
     void emplace_back(T&& value)
     {
-        list.push_back(std::make_unique<T>(value));
+        emplace_at(std::move(value), nullptr);
     }
 
-    enum insert_place_t
-    {
-        INSERT_BEFORE,
-        INSERT_AFTER,
-        INSERT_NONE,
-    };
-
     /* Insert the given value at a position in the list, determined by the
      * check function. The value is inserted at the first position that
      * check indicates, or at the end of the list otherwise */
     void emplace_at(T&& value, std::function<insert_place_t(T&)> check)
     {
-        auto it = list.begin();
-        while (it != list.end())
+        if (iterating > 0)
         {
-            /* Skip empty elements */
-            if (*it == nullptr)
-            {
-                ++it;
-                continue;
-            }
-
-            auto place = check(**it);
-            switch (place)
-            {
-              case INSERT_AFTER:
-                /* We can safely increment it, because it points to an
-                 * element in the list */
-                ++it;
-
-              // fall through
-              case INSERT_BEFORE:
-                list.emplace(it, std::make_unique<T>(value));
-
-                return;
-
-              default:
-                break;
-            }
-
-            ++it;
+            pending.push_back({std::move(value), check});
+            return;
         }
 
-        /* If no place found, insert at the end */
-        emplace_back(std::move(value));
+        insert(std::move(value), check);
     }
 
     void insert_at(T value, std::function<insert_place_t(T&)> check)
@@ -172,13 +214,16 @@ class safe_list_t
     /* Call func for each non-erased element of the list */
     void for_each(std::function<void(T&)> func) const
     {
-        /* Go through all elements currently in the list */
-        auto it = list.begin();
-        for (int size = list.size(); size > 0; size--, it++)
+        iteration_guard_t guard{this};
+
+        /* Go through all elements currently in the list. The storage is not
+         * reallocated during iteration, but func may erase elements. */
+        const size_t size = list.size();
+        for (size_t i = 0; i < size; i++)
         {
-            if (*it)
+            if (list[i])
             {
-                func(**it);
+                func(*list[i]);
             }
         }
     }
@@ -186,12 +231,12 @@ class safe_list_t
     /* Call func for each non-erased element of the list in reversed order */
     void for_each_reverse(std::function<void(T&)> func) const
     {
-        auto it = list.rbegin();
-        for (int size = list.size(); size > 0; size--, it++)
+        iteration_guard_t guard{this};
+        for (size_t i = list.size(); i > 0; i--)
         {
-            if (*it)
+            if (list[i - 1])
             {
-                func(**it);
+                func(*list[i - 1]);
             }
         }
     }
@@ -209,27 +254,26 @@ class safe_list_t
     }
 
     /* Remove all elements satisfying a given condition.
-     * This function resets their pointers and scheduling a cleanup operation */
+     * Their values are destroyed immediately, and their slots are cleaned up
+     * later. */
     void remove_if(std::function<bool(const T&)> predicate)
     {
-        bool actually_removed = false;
-        for (auto& it : list)
+        for (auto& el : list)
         {
-            if (it && predicate(*it))
+            if (el && predicate(*el))
             {
-                actually_removed = true;
                 /* First reset the element in the list, and then free resources */
-                auto copy = std::move(it);
-                it = nullptr;
+                [[maybe_unused]] auto copy = std::move(*el);
+                el.reset();
+                --alive;
                 /* Now copy goes out of scope */
             }
         }
 
-        /* Schedule a clean-up, but be careful to not schedule it twice */
-        if (!is_dirty() && actually_removed)
-        {
-            idle_cleanup.run_once([this] () { this->do_cleanup(); });
-        }
+        pending.erase(std::remove_if(pending.begin(), pending.end(),
+            [&] (const pending_t& p) { return predicate(p.value); }), pending.end());
+
+        do_cleanup();
     }
 };
 }
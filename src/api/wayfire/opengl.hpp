@@ -98,6 +98,14 @@ struct render_target_t : public framebuffer_t
      * other framebuffer transformations, if has_nonstandard_transform is set */
     glm::mat4 transform = glm::mat4(1.0);
 
+    /**
+     * Get how many framebuffer pixels correspond to one unit of the logical
+     * @geometry. This is the same as @scale, unless a @subbuffer shrinks (or
+     * enlarges) the logical geometry, for example when workspaces are shown
+     * as thumbnails.
+     */
+    float get_effective_scale() const;
+
     /**
      * Get a render target which is the same as this, but whose geometry is
      * translated by @offset.
@@ -222,6 +230,8 @@ enum rendering_flags_t
      * This allows re-use of uniform values for different damage rectangles.
      */
     RENDER_FLAG_CACHED         = (1 << 3),
+    /* Use GL_NEAREST when magnifying the texture. Supported only by batch_texture(). */
+    TEXTURE_FILTER_NEAREST     = (1 << 4),
 };
 
 /**
@@ -293,11 +303,66 @@ void draw_cached();
  */
 void clear_cached();
 
+/**
+ * Queue a textured quad for rendering with the built-in shaders.
+ *
+ * Quads queued inside a batch_begin()/batch_end() block are collected and drawn
+ * together when the batch is flushed. Quads with the same texture and color
+ * are drawn with a single draw call, and quads may be drawn out of order if
+ * they do not overlap, so the result is the same as drawing them one by one.
+ * Outside of such a block, the quad is drawn immediately.
+ *
+ * This function does not need to be called between render_begin() and
+ * render_end().
+ *
+ * @param texture  The texture to render.
+ * @param target   The render target to draw on.
+ * @param geometry The geometry of the quad, in the same coordinate system as
+ *                   the target geometry.
+ * @param damage   The region of the quad to draw, in the same coordinate
+ *                   system as the target geometry.
+ * @param color    A color multiplier for each channel of the texture.
+ * @param bits     A bitwise OR of TEXTURE_TRANSFORM_INVERT_X,
+ *                   TEXTURE_TRANSFORM_INVERT_Y and TEXTURE_FILTER_NEAREST.
+ */
+void batch_texture(const wf::texture_t& texture,
+    const wf::render_target_t& target,
+    const wf::geometry_t& geometry,
+    const wf::region_t& damage,
+    glm::vec4 color = glm::vec4(1.f),
+    uint32_t bits   = 0);
+
+/**
+ * Queue a colored rectangle for rendering, see batch_texture().
+ */
+void batch_rectangle(const wf::render_target_t& target,
+    const wf::geometry_t& geometry,
+    const wf::region_t& damage,
+    wf::color_t color);
+
+/**
+ * Start collecting quads queued with batch_texture() and batch_rectangle().
+ * Blocks may be nested.
+ */
+void batch_begin();
+
+/**
+ * End a block started with batch_begin() and draw all queued quads.
+ */
+void batch_end();
+
+/**
+ * Draw all queued quads. This is done automatically by render_begin(), so that
+ * regular rendering operations are not reordered with queued quads.
+ */
+void flush_batch();
+
 /* Compiles the given shader source */
 GLuint compile_shader(std::string source, GLuint type);
 
 /**
- * Create an OpenGL program from the given shader sources.
+ * Create an OpenGL program from the given shader sources. The program is owned
+ * by the caller. It is loaded from the shader cache on disk if possible.
  *
  * @param vertex_source The source code of the vertex shader.
  * @param frag_source The source code of the fragment shader.
@@ -313,6 +378,24 @@ GLuint compile_program(std::string vertex_source, std::string frag_source);
  */
 void render_rectangle(wf::geometry_t box, wf::color_t color, glm::mat4 matrix);
 
+/**
+ * A uniform of a program_t, obtained with program_t::get_uniform(). Setting a
+ * uniform through its handle avoids looking up the name on every call.
+ *
+ * Handles are valid only for the program_t which created them, but stay valid
+ * if the program is compiled again.
+ */
+struct uniform_t
+{
+    int index = -1;
+};
+
+/** A vertex attribute of a program_t, obtained with program_t::get_attrib(). */
+struct attrib_t
+{
+    int index = -1;
+};
+
 /**
  * An OpenGL program for rendering texture_t.
  * It contains multiple programs for the different texture types.
@@ -345,6 +428,9 @@ class program_t
      *
      * The following identifiers should not be defined in the user source:
      *   _wayfire_texture, _wayfire_uv_scale, _wayfire_y_base, get_pixel
+     *
+     * The programs are shared with all other programs with the same sources,
+     * and are linked in the background or on first use.
      */
     void compile(const std::string& vertex_source,
         const std::string& fragment_source);
@@ -356,7 +442,19 @@ class program_t
     void set_simple(GLuint program_id,
         wf::texture_type_t type = wf::TEXTURE_TYPE_RGBA);
 
-    /** Deletes the underlying OpenGL programs */
+    /**
+     * Create a simple program from the given sources, supporting only the
+     * given type.
+     *
+     * Unlike set_simple(compile_program(...)), the program is shared with all
+     * other programs with the same sources, and is linked in the background or
+     * on first use, so this does not block on shader compilation.
+     */
+    void set_simple(const std::string& vertex_source,
+        const std::string& fragment_source,
+        wf::texture_type_t type = wf::TEXTURE_TYPE_RGBA);
+
+    /** Deletes the underlying OpenGL programs, or releases the shared ones */
     void free_resources();
 
     /**
@@ -369,6 +467,31 @@ class program_t
     /** @return The program ID for the given texture type, or 0 on failure */
     int get_program_id(wf::texture_type_t type);
 
+    /**
+     * Get a handle for the uniform with the given name, which can be used to
+     * set it in all of the programs for the different texture types. The
+     * locations are resolved once per program, the first time they are used.
+     *
+     * May be called before the program is compiled.
+     */
+    uniform_t get_uniform(const std::string& name);
+
+    /** Get a handle for the vertex attribute with the given name. */
+    attrib_t get_attrib(const std::string& name);
+
+    /** Set the given uniform for the currently used program. */
+    void uniform1i(uniform_t uniform, int value);
+    /** Set the given uniform for the currently used program. */
+    void uniform1f(uniform_t uniform, float value);
+    /** Set the given uniform for the currently used program. */
+    void uniform2f(uniform_t uniform, float x, float y);
+    /** Set the given uniform for the currently used program. */
+    void uniform3f(uniform_t uniform, float x, float y, float z);
+    /** Set the given uniform for the currently used program. */
+    void uniform4f(uniform_t uniform, const glm::vec4& value);
+    /** Set the given uniform for the currently used program. */
+    void uniformMatrix4f(uniform_t uniform, const glm::mat4& value);
+
     /** Set the given uniform for the currently used program. */
     void uniform1i(const std::string& name, int value);
     /** Set the given uniform for the currently used program. */
@@ -392,6 +515,10 @@ class program_t
     void attrib_pointer(const std::string& attrib,
         int size, int stride, const void *ptr, GLenum type = GL_FLOAT);
 
+    /** Same as attrib_pointer(), with a handle from get_attrib(). */
+    void attrib_pointer(attrib_t attrib,
+        int size, int stride, const void *ptr, GLenum type = GL_FLOAT);
+
     /*
      * Set the attrib divisor. Analogous to glVertexAttribDivisor().
      *
@@ -400,6 +527,9 @@ class program_t
      */
     void attrib_divisor(const std::string& attrib, int divisor);
 
+    /** Same as attrib_divisor(), with a handle from get_attrib(). */
+    void attrib_divisor(attrib_t attrib, int divisor);
+
     /**
      * Set the active texture, and modify the builtin Y-inversion uniforms.
      * Will not work with custom programs.
@@ -1,11 +1,24 @@
 #pragma once
 
 #include <pixman.h>
+#include <memory>
 #include "wayfire/geometry.hpp"
 
 /* ---------------------- pixman utility functions -------------------------- */
 namespace wf
 {
+/**
+ * A set of rectangles, backed by a pixman region.
+ *
+ * Most regions in the damage tracking paths consist of a single rectangle, so
+ * these are stored inline and operations between them do not call pixman at
+ * all. Regions with more rectangles share their pixman storage between copies
+ * and only duplicate it when one of the copies is modified (copy-on-write), so
+ * passing regions by value is cheap.
+ *
+ * Note that the storage is not duplicated when the region is copied after
+ * to_pixman() was called, so the returned pointer should not be kept around.
+ */
 struct region_t
 {
     region_t();
@@ -24,6 +37,20 @@ struct region_t
     void clear();
 
     void expand_edges(int amount);
+
+    /**
+     * Simplify the region so that it consists of at most @max_rects
+     * rectangles, by replacing groups of nearby rectangles with their bounding
+     * box. Rectangles are merged so that as few pixels as possible are added.
+     * A @max_rects value of 0 leaves the region unchanged.
+     *
+     * @return The number of pixels added to the region.
+     */
+    uint64_t simplify(size_t max_rects);
+
+    bool operator ==(const region_t& other) const;
+    bool operator !=(const region_t& other) const;
+
     pixman_box32_t get_extents() const;
     bool contains_point(const point_t& point) const;
     bool contains_pointf(const pointf_t& point) const;
@@ -56,17 +83,34 @@ struct region_t
     region_t& operator ^=(const wlr_box& box);
     region_t& operator ^=(const region_t& other);
 
+    /**
+     * Get the underlying pixman region, for example to pass it to wlroots.
+     * Converts single-rectangle regions to pixman storage and duplicates
+     * shared storage, so avoid calling it in hot paths.
+     */
     pixman_region32_t *to_pixman();
 
     const pixman_box32_t *begin() const;
     const pixman_box32_t *end() const;
 
   private:
-    pixman_region32_t _region;
-    /* Returns a const-casted pixman_region32_t*, useful in const operators
-     * where we use this->_region as only source for calculations, but pixman
-     * won't let us pass a const pixman_region32_t* */
-    pixman_region32_t *unconst() const;
+    struct storage_t;
+    class pixman_view_t;
+
+    /* The region if storage is not set, or the empty box {0, 0, 0, 0} */
+    pixman_box32_t box = {0, 0, 0, 0};
+    /* A pixman region with multiple rectangles, possibly shared with copies */
+    std::shared_ptr<storage_t> storage;
+
+    /* Make sure the region has pixman storage which is not shared with other
+     * regions, so that it can be modified */
+    pixman_region32_t *make_unique();
+    /* Go back to inline storage if the region has at most one rectangle */
+    void normalize();
+    /* Replace the region with the result of op(dst, src), where src holds the
+     * current region. Operates in-place if the storage is not shared. */
+    template<class Op>
+    void apply(Op op);
 };
 }
 
@@ -52,6 +52,98 @@ using post_hook_t = std::function<void (const wf::framebuffer_t& source,
 struct frame_done_signal
 {};
 
+/**
+ * The stages of an output's repaint cycle, as measured by the frame profiler of the render manager.
+ */
+enum frame_stage_t
+{
+    /* Running the OUTPUT_EFFECT_PRE and OUTPUT_EFFECT_DAMAGE hooks */
+    FRAME_STAGE_PRE_EFFECTS         = 0,
+    /* Trying to directly scan out a view */
+    FRAME_STAGE_DIRECT_SCANOUT      = 1,
+    /* Attaching the renderer to the output and querying its damage */
+    FRAME_STAGE_MAKE_CURRENT        = 2,
+    /* Scheduling the render instructions of the scenegraph */
+    FRAME_STAGE_GATHER_INSTRUCTIONS = 3,
+    /* Clearing the background and rendering the scheduled instructions */
+    FRAME_STAGE_RENDER_INSTANCES    = 4,
+    /* Running the OUTPUT_EFFECT_OVERLAY hooks */
+    FRAME_STAGE_OVERLAY_EFFECTS     = 5,
+    /* Running the postprocessing hooks */
+    FRAME_STAGE_POST_EFFECTS        = 6,
+    /* Rendering software cursors */
+    FRAME_STAGE_SW_CURSORS          = 7,
+    /* Committing the output */
+    FRAME_STAGE_SWAP_BUFFERS        = 8,
+    /* Invalid stage, used internally */
+    FRAME_STAGE_TOTAL               = 9,
+};
+
+/**
+ * How a frame ended.
+ */
+enum class frame_result_t
+{
+    /* The frame was rendered and committed */
+    RENDERED,
+    /* A view was directly scanned out */
+    SCANOUT,
+    /* The output did not need a repaint, or could not be made current */
+    SKIPPED,
+};
+
+/**
+ * The timings of a single paint of an output.
+ */
+struct frame_timings_t
+{
+    /* When painting started, in microseconds, using CLOCK_MONOTONIC as a base */
+    int64_t start = 0;
+    /* The repaint delay used for this frame, in milliseconds */
+    int repaint_delay = 0;
+    /* The time spent in each stage, in microseconds. Stages which were not reached are zero. */
+    int64_t stage[FRAME_STAGE_TOTAL] = {0};
+    /* The total time spent painting, in microseconds */
+    int64_t total = 0;
+    frame_result_t result = frame_result_t::SKIPPED;
+
+    /* The number of rectangles in the damaged region before and after merging, see core/max_damage_rects */
+    int damage_rects = 0;
+    int simplified_damage_rects = 0;
+    /* The number of undamaged pixels which were repainted because of merging */
+    uint64_t damage_overdraw = 0;
+};
+
+/**
+ * The maximal number of frames for which the render manager keeps timings.
+ */
+static constexpr size_t FRAME_TIMINGS_HISTORY = 256;
+
+/**
+ * The state of the repaint delay scheduling of an output.
+ */
+struct repaint_delay_stats_t
+{
+    /* Whether the delay is predicted from the render times, see core/predictive_repaint_delay */
+    bool predictive = false;
+    /* The current repaint delay, in milliseconds */
+    int delay = 0;
+    /* The refresh period of the output, in microseconds */
+    int64_t refresh = 0;
+    /* The render time percentile the delay is based on, in microseconds */
+    int64_t predicted_render_time = 0;
+    /* The safety margin added to the predicted render time, including the extra margin after misses */
+    int64_t margin = 0;
+    /* The width of a histogram bucket, in microseconds */
+    int64_t bucket_size = 0;
+    /* The number of recent frames whose render time fell in each bucket. The last bucket also
+     * contains all longer frames. */
+    std::vector<uint32_t> histogram;
+    /* The number of frames which missed their vblank, and the total number of frames */
+    uint64_t missed_frames = 0;
+    uint64_t total_frames  = 0;
+};
+
 /** Render manager
  *
  * Each output has a render manager, which is responsible for all rendering
@@ -171,6 +263,16 @@ class render_manager
      */
     wf::render_target_t get_target_framebuffer() const;
 
+    /**
+     * @return The timings of the last (at most FRAME_TIMINGS_HISTORY) frames on this output, oldest first.
+     */
+    std::vector<frame_timings_t> get_frame_timings() const;
+
+    /**
+     * @return The render time histogram and the chosen repaint delay of the output.
+     */
+    repaint_delay_stats_t get_repaint_delay_stats() const;
+
   private:
     class impl;
     std::unique_ptr<impl> pimpl;
@@ -155,6 +155,31 @@ class render_instance_t
      */
     virtual void compute_visibility(wf::output_t *output, wf::region_t& visible)
     {}
+
+    /**
+     * @return The node this render instance was generated for, or nullptr if
+     *   the instance does not correspond to a single node. It is used to
+     *   attribute rendering costs to nodes when profiling render passes.
+     */
+    virtual node_t *get_node() const
+    {
+        return nullptr;
+    }
+
+    /**
+     * Whether schedule_instructions() may run on a worker thread, see the
+     * core/parallel_scheduling option.
+     *
+     * This requires that schedule_instructions() does not modify any state or
+     * use OpenGL, and that it only intersects and subtracts from the damage.
+     * In this case, it can be called with a larger damage region, and the
+     * resulting instructions can be clipped to the real damage later.
+     * Instances with children should also check their children.
+     */
+    virtual bool can_schedule_in_parallel()
+    {
+        return false;
+    }
 };
 
 using render_instance_uptr = std::unique_ptr<render_instance_t>;
@@ -184,6 +209,10 @@ inline void damage_node(NodePtr node, wf::region_t damage)
 /**
  * Signal that a render pass starts.
  * emitted on: core.
+ *
+ * When core/parallel_scheduling is enabled, the signal may additionally be
+ * emitted for a speculative pass with a larger damage region, so handlers
+ * should only adjust the damage and not keep per-pass state.
  */
 struct render_pass_begin_signal
 {
@@ -271,6 +300,48 @@ struct render_pass_params_t
 wf::region_t run_render_pass(
     const render_pass_params_t& params, uint32_t flags);
 
+/**
+ * GPU time spent executing the render instructions of a single node.
+ * Instructions of nested render passes (for example, a transformer rendering
+ * its children to an auxilliary buffer) are accounted to the outermost node.
+ */
+struct node_gpu_timings_t
+{
+    /** The stringified node, see node_t::stringify() */
+    std::string name;
+    /** The number of measured render instructions */
+    uint64_t samples = 0;
+    /** The GPU time of all measured render instructions, in nanoseconds */
+    uint64_t total_ns = 0;
+    /** The GPU time of the most recent render instruction, in nanoseconds */
+    uint64_t last_ns = 0;
+    /** The GPU time of the most expensive render instruction, in nanoseconds */
+    uint64_t max_ns = 0;
+};
+
+/**
+ * Enable or disable GPU profiling of render passes.
+ *
+ * While enabled, each render instruction executed by run_render_pass() is
+ * bracketed by a GPU timer query. The results are read back asynchronously
+ * during the following render passes, so the statistics lag a few frames
+ * behind. Profiling requires the GL_EXT_disjoint_timer_query extension.
+ *
+ * @return Whether profiling is enabled after the call.
+ */
+bool set_gpu_profiling(bool enabled);
+
+/**
+ * @return The GPU time statistics collected since profiling was enabled or
+ *   the last call to reset_gpu_timings(), sorted by total time, descending.
+ */
+std::vector<node_gpu_timings_t> get_gpu_timings();
+
+/**
+ * Clear the collected GPU time statistics.
+ */
+void reset_gpu_timings();
+
 /**
  * A helper function for direct scanout implementations.
  * It tries to forward the direct scanout request to the first render instance
@@ -281,6 +352,25 @@ direct_scanout try_scanout_from_list(
     const std::vector<render_instance_uptr>& instances,
     wf::output_t *scanout);
 
+/**
+ * A helper function for can_schedule_in_parallel implementations.
+ * @return Whether all instances in the list can be scheduled in parallel.
+ */
+bool can_schedule_list_in_parallel(const std::vector<render_instance_uptr>& instances);
+
+/**
+ * Pick how much smaller than the target an auxiliary buffer can be, when its
+ * contents are shown shrunk by @shrink (for example, a view thumbnail shown at
+ * a quarter of its size).
+ *
+ * Like mipmap levels, the result is rounded up to a power of two, so that the
+ * contents are never rendered at a lower resolution than they are shown, and
+ * buffers are not reallocated every frame while the shrink factor is animated.
+ *
+ * @return A factor in (0, 1] to multiply the render target's scale with.
+ */
+float get_render_scale_level(float shrink);
+
 /**
  * A helper function for compute_visibility implementations. It applies an offset to the damage and reverts it
  * afterwards. It also calls compute_visibility for the children instances.
@@ -314,6 +404,11 @@ class simple_render_instance_t : public render_instance_t
                 });
     }
 
+    node_t *get_node() const override
+    {
+        return self;
+    }
+
   protected:
     Node *self;
     wf::signal::connection_t<scene::node_damage_signal> on_self_damage = [=] (scene::node_damage_signal *ev)
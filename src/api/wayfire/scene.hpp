@@ -243,9 +243,26 @@ class node_t : public std::enable_shared_from_this<node_t>,
      * and does not apply any transformations which may be implemented by the
      * node. It is simply the bounding box of the bounding boxes of the children
      * as reported by their get_bounding_box() method.
+     *
+     * If core/bounding_box_cache is enabled, the result is cached until the
+     * list of children changes or wf::scene::update() is called with
+     * update_flag::GEOMETRY or update_flag::CHILDREN_LIST on the node or on
+     * one of its descendants. Nodes above views with transformers are not
+     * cached, because plugins change the parameters of transformers without
+     * updating the scenegraph.
      */
     wf::geometry_t get_children_bounding_box();
 
+    /**
+     * Drop the cached bounding box of the node's children, and those of all
+     * its ancestors.
+     *
+     * wf::scene::update() does this automatically. Nodes whose bounding box
+     * changes without a scenegraph update (for example, transformers whose
+     * parameters changed) should call this on themselves.
+     */
+    void invalidate_bounding_box();
+
     /**
      * Structure nodes are special nodes which core usually creates when Wayfire
      * is started (e.g. layer and output nodes). These nodes should not be
@@ -324,6 +341,23 @@ class node_t : public std::enable_shared_from_this<node_t>,
     std::vector<std::shared_ptr<node_t>> children;
 
     void set_children_unchecked(std::vector<node_ptr> new_list);
+
+  private:
+    /**
+     * An index of the children's bounding boxes, used by the default
+     * find_node_at() implementation if core/input_spatial_index is enabled.
+     */
+    struct children_index_t;
+    std::unique_ptr<children_index_t> children_index;
+
+    std::optional<input_node_t> find_node_at_indexed(const wf::pointf_t& local);
+
+    // The cached result of get_children_bounding_box(), if still valid.
+    std::optional<wf::geometry_t> cached_children_bbox;
+    // Whether the bounding box of the children depends on a transformer, as
+    // of the last time it was computed.
+    bool children_bbox_volatile = false;
+    wf::geometry_t compute_children_bounding_box();
 };
 
 /**
@@ -458,6 +492,13 @@ enum update_flag
 struct root_node_update_signal
 {
     uint32_t flags;
+
+    /**
+     * The node on which wf::scene::update() was called. Only this node and its
+     * subtree have changed in the way described by @flags, so listeners may
+     * limit their updates to that part of the scenegraph.
+     */
+    node_ptr changed_node;
 };
 
 /**
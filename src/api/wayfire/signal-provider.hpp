@@ -5,7 +5,11 @@
 #include <unordered_set>
 #include <unordered_map>
 #include <wayfire/nonstd/safe-list.hpp>
+#include <vector>
 #include <cassert>
+#include <algorithm>
+#include <cstdint>
+#include <typeinfo>
 #include <typeindex>
 
 namespace wf
@@ -14,6 +18,22 @@ namespace signal
 {
 class provider_t;
 
+namespace detail
+{
+/**
+ * Get the index of the given signal type. Indices are small consecutive
+ * integers assigned on first use, and are shared by core and all plugins.
+ */
+uint32_t get_signal_type_index(const std::type_info& type);
+
+template<class SignalType>
+uint32_t signal_type_index()
+{
+    static const uint32_t index = get_signal_type_index(typeid(SignalType));
+    return index;
+}
+}
+
 /**
  * A base class for all connection_t, needed to store list of connections in a
  * type-safe way.
@@ -137,7 +157,15 @@ class provider_t
     template<class SignalType>
     void connect(connection_t<SignalType> *callback)
     {
-        typed_connections[index<SignalType>()].push_back(callback);
+        const uint32_t type = detail::signal_type_index<SignalType>();
+        int idx = find_slot(type);
+        if (idx < 0)
+        {
+            slots.push_back({type, {}});
+            idx = slots.size() - 1;
+        }
+
+        slots[idx].connections.push_back(callback);
         callback->connected_to.insert(this);
     }
 
@@ -145,23 +173,46 @@ class provider_t
     void disconnect(connection_base_t *callback)
     {
         callback->connected_to.erase(this);
-        for (auto& [id, connected] : typed_connections)
+        for (auto& slot : slots)
         {
-            connected.remove_all(callback);
+            for (auto& conn : slot.connections)
+            {
+                if (conn == callback)
+                {
+                    conn  = nullptr;
+                    dirty = true;
+                }
+            }
         }
+
+        compact();
     }
 
     /** Emit the given signal. */
     template<class SignalType>
     void emit(SignalType *data)
     {
-        auto& conns = typed_connections[std::type_index(typeid(SignalType))];
-        conns.for_each([&] (connection_base_t *tc)
+        const int idx = find_slot(detail::signal_type_index<SignalType>());
+        if (idx < 0)
         {
-            auto real_type = dynamic_cast<connection_t<SignalType>*>(tc);
-            assert(real_type);
-            real_type->emit(data);
-        });
+            return;
+        }
+
+        // Connections added during the emission are not called. Callbacks may
+        // connect and disconnect, so the connection list is indexed anew for
+        // every connection.
+        ++emitting;
+        const size_t count = slots[idx].connections.size();
+        for (size_t i = 0; i < count; i++)
+        {
+            if (auto conn = slots[idx].connections[i])
+            {
+                static_cast<connection_t<SignalType>*>(conn)->emit(data);
+            }
+        }
+
+        --emitting;
+        compact();
     }
 
     provider_t()
@@ -169,12 +220,15 @@ class provider_t
 
     ~provider_t()
     {
-        for (auto& [id, connected] : typed_connections)
+        for (auto& slot : slots)
         {
-            connected.for_each([&] (connection_base_t *base)
+            for (auto& conn : slot.connections)
             {
-                base->connected_to.erase(this);
-            });
+                if (conn)
+                {
+                    conn->connected_to.erase(this);
+                }
+            }
         }
     }
 
@@ -187,14 +241,50 @@ class provider_t
     provider_t& operator =(provider_t&& other) = delete;
 
   private:
-    template<class SignalType>
-    static inline std::type_index index()
+    /**
+     * The connections for a single signal type. Disconnected connections are
+     * replaced with nullptr and removed once no emission is in progress.
+     */
+    struct slot_t
+    {
+        uint32_t type;
+        std::vector<connection_base_t*> connections;
+    };
+
+    // Objects usually have connections for only a few signal types, so a
+    // linear search is faster than hashing.
+    std::vector<slot_t> slots;
+    int emitting = 0;
+    bool dirty   = false;
+
+    int find_slot(uint32_t type) const
     {
-        return std::type_index(typeid(SignalType));
+        for (size_t i = 0; i < slots.size(); i++)
+        {
+            if (slots[i].type == type)
+            {
+                return i;
+            }
+        }
+
+        return -1;
     }
 
-    std::unordered_map<std::type_index, wf::safe_list_t<connection_base_t*>>
-    typed_connections;
+    void compact()
+    {
+        if (emitting || !dirty)
+        {
+            return;
+        }
+
+        for (auto& slot : slots)
+        {
+            auto it = std::remove(slot.connections.begin(), slot.connections.end(), nullptr);
+            slot.connections.erase(it, slot.connections.end());
+        }
+
+        dirty = false;
+    }
 };
 }
 }
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include <wayfire/txn/transaction-object.hpp>
+
+struct wl_client;
+
+namespace wf
+{
+namespace txn
+{
+/**
+ * Statistics about how quickly a client responds to configure events, that is, the time between sending a
+ * configure and the client committing a buffer which acknowledges it.
+ *
+ * The estimate is a rolling one: the average and the deviation are exponentially weighted moving averages,
+ * so that the estimate follows clients whose behavior changes over time.
+ */
+struct client_latency_t
+{
+    wl_client *client = nullptr;
+    // Number of samples collected so far.
+    uint64_t samples = 0;
+    // Smoothed configure->commit latency, in microseconds.
+    int64_t average = 0;
+    // Smoothed mean deviation of the latency, in microseconds.
+    int64_t deviation = 0;
+    // The largest latency observed, in microseconds.
+    int64_t max = 0;
+};
+
+/**
+ * Record that the client took @latency microseconds to respond to a configure event.
+ */
+void record_client_latency(wl_client *client, int64_t latency);
+
+/**
+ * Get the latency statistics of the given client, or nullopt if no samples were recorded for it.
+ */
+std::optional<client_latency_t> get_client_latency(wl_client *client);
+
+/**
+ * Get the latency statistics of all clients with at least one recorded sample.
+ */
+std::vector<client_latency_t> get_all_client_latencies();
+
+/**
+ * Estimate how long, in milliseconds, to wait for the client to respond to a configure event.
+ *
+ * @return nullopt if there are not enough samples for the client to give an estimate.
+ */
+std::optional<uint64_t> get_client_timeout(wl_client *client);
+
+/**
+ * Estimate how long, in milliseconds, to wait for all of the given objects to become ready, based on the
+ * clients they depend on.
+ *
+ * @return The largest estimate of the clients, but at most @max_timeout. If any object does not have an
+ *   estimate (including objects without a client), @max_timeout.
+ */
+uint64_t get_adaptive_timeout(const std::vector<transaction_object_sptr>& objects, uint64_t max_timeout);
+}
+}
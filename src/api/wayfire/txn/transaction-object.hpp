@@ -2,6 +2,8 @@
 
 #include <wayfire/signal-provider.hpp>
 
+struct wl_client;
+
 namespace wf
 {
 namespace txn
@@ -43,6 +45,16 @@ class transaction_object_t : public signal::provider_t
      */
     virtual void apply() = 0;
 
+    /**
+     * Get the client whose cooperation is needed for the object to become ready, if any.
+     * Transactions with a default timeout use the response history of these clients to pick a timeout,
+     * see wayfire/txn/client-latency.hpp.
+     */
+    virtual wl_client *get_client() const
+    {
+        return nullptr;
+    }
+
     virtual ~transaction_object_t() = default;
 };
 
@@ -3,6 +3,7 @@
 #include "wayfire/signal-provider.hpp"
 #include "wayfire/util.hpp"
 #include <wayfire/txn/transaction-object.hpp>
+#include <unordered_set>
 
 namespace wf
 {
@@ -21,7 +22,8 @@ class transaction_t : public signal::provider_t
      * Create a new transaction.
      *
      * @param timeout The timeout for the transaction in milliseconds after it is committed.
-     *   -1 means that core should pick a default timeout.
+     *   -1 means that core should pick a default timeout, which may be lowered based on how quickly the
+     *   clients of the participating objects usually respond (see core/adaptive_transaction_timeout).
      */
     static std::unique_ptr<transaction_t> create(int64_t timeout = -1);
 
@@ -39,6 +41,12 @@ class transaction_t : public signal::provider_t
      */
     void add_object(transaction_object_sptr object);
 
+    /**
+     * Remove an object from the transaction. If the object is not part of it, this is no-op.
+     * Objects may be removed only before the transaction is committed.
+     */
+    void remove_object(transaction_object_t *object);
+
     /**
      * Get a list of all the objects currently part of the transaction.
      */
@@ -50,10 +58,21 @@ class transaction_t : public signal::provider_t
      */
     void commit();
 
+    /**
+     * Create a new empty transaction with the same timeout as this one, for example for objects which
+     * are split off from this transaction.
+     *
+     * The default implementation uses the same timer setter. Subclasses whose timer setter keeps state
+     * for a single transaction need to override this.
+     */
+    virtual std::unique_ptr<transaction_t> create_sibling() const;
+
     virtual ~transaction_t() = default;
 
   private:
     std::vector<transaction_object_sptr> objects;
+    // The same objects, for fast lookups in add_object()
+    std::unordered_set<transaction_object_t*> object_set;
     int count_ready_objects = 0;
     uint64_t timeout;
     timer_setter_t timer_setter;
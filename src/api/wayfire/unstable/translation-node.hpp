@@ -16,7 +16,8 @@ class translation_node_t : public wf::scene::floating_inner_node_t
     translation_node_t();
 
     /**
-     * Set the offset the node applies to its children.
+     * Set the offset the node applies to its children and emit a geometry
+     * update for the node.
      * Note that damage is not automatically applied.
      */
     void set_offset(wf::point_t offset);
@@ -18,6 +18,8 @@ struct surface_state_t
     wlr_texture *texture; // The texture of the wlr_client_buffer
 
     wf::region_t accumulated_damage;
+    // The opaque region of the surface, in surface-local coordinates.
+    wf::region_t opaque_region;
     wf::dimensions_t size = {0, 0};
     std::optional<wlr_fbox> src_viewport;
 
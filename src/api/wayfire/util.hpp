@@ -10,9 +10,15 @@ namespace wf
 /** Convert timespect to milliseconds. */
 int64_t timespec_to_msec(const timespec& ts);
 
+/** Convert timespec to microseconds. */
+int64_t timespec_to_usec(const timespec& ts);
+
 /** Returns current time in msec, using CLOCK_MONOTONIC as a base */
 int64_t get_current_time();
 
+/** Returns current time in usec, using CLOCK_MONOTONIC as a base */
+int64_t get_current_time_usec();
+
 /**
  * A wrapper around wl_listener compatible with C++11 std::functions
  */
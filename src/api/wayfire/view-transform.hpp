@@ -69,7 +69,7 @@ class transformer_render_instance_t : public render_instance_t
      *
      * @param scale The scale to use when generating the texture. The scale
      *   indicates how much bigger the temporary buffer should be than its logical
-     *   size.
+     *   size. See @get_texture_scale().
      */
     wf::texture_t get_texture(float scale)
     {
@@ -103,8 +103,9 @@ class transformer_render_instance_t : public render_instance_t
         int target_height = scale * bbox.height;
 
         OpenGL::render_begin();
+        const bool scale_changed = (inner_content.scale != scale);
         inner_content.scale = scale;
-        if (inner_content.allocate(target_width, target_height))
+        if (inner_content.allocate(target_width, target_height) || scale_changed)
         {
             cached_damage |= bbox;
         }
@@ -123,6 +124,20 @@ class transformer_render_instance_t : public render_instance_t
         return wf::texture_t{inner_content.tex};
     }
 
+    /**
+     * Get the scale for @get_texture() when rendering to the given target.
+     *
+     * The texture does not need a higher resolution than what it covers on the
+     * target, so if the target is shown shrunk (see
+     * render_target_t::get_effective_scale()) or the transformer shrinks its
+     * contents by @shrink, a smaller buffer is used.
+     */
+    static float get_texture_scale(const wf::render_target_t& target, float shrink = 1.0)
+    {
+        const float density = target.get_effective_scale() * shrink;
+        return target.scale * get_render_scale_level(density / target.scale);
+    }
+
     void presentation_feedback(wf::output_t *output) override
     {
         for (auto& ch : children)
@@ -191,6 +206,11 @@ class transformer_render_instance_t : public render_instance_t
         return direct_scanout::OCCLUSION;
     }
 
+    node_t *get_node() const override
+    {
+        return self;
+    }
+
     bool has_instances()
     {
         return !children.empty();
@@ -270,6 +290,14 @@ class transform_manager_node_t : public wf::scene::floating_inner_node_t
         return nullptr;
     }
 
+    /**
+     * @return Whether any transformers have been added.
+     */
+    bool has_transformers() const
+    {
+        return !transformers.empty();
+    }
+
     std::string stringify() const override
     {
         return "view-transform-root";
@@ -389,6 +389,17 @@ class view_interface_t : public wf::signal::provider_t, public wf::object_base_t
      */
     virtual const wf::render_target_t& take_snapshot();
 
+    /**
+     * Increase or decrease the persistent snapshot counter of the view.
+     *
+     * While the counter is positive, the view keeps the render instances used
+     * for snapshots alive and tracks damage on its contents. take_snapshot()
+     * then re-renders only the parts of the view which changed since the last
+     * snapshot, instead of the whole view. This is useful for plugins which show
+     * live thumbnails of many views every frame.
+     */
+    void set_persistent_snapshot(bool persistent);
+
     /**
      * View lifetime is managed by reference counting. To take a reference,
      * use take_ref(). Note that one reference is automatically made when the
@@ -2,9 +2,28 @@
 #include "wayfire/nonstd/safe-list.hpp"
 #include <unordered_map>
 #include <set>
+#include <string>
 
 #include <wayfire/signal-provider.hpp>
 
+/**
+ * The registry is keyed by a copy of the type name, because the type_info
+ * objects of signals declared by plugins go away when the plugin is unloaded.
+ */
+uint32_t wf::signal::detail::get_signal_type_index(const std::type_info& type)
+{
+    static std::unordered_map<std::string, uint32_t> indices;
+    auto it = indices.find(type.name());
+    if (it != indices.end())
+    {
+        return it->second;
+    }
+
+    const uint32_t index = indices.size();
+    indices.emplace(type.name(), index);
+    return index;
+}
+
 void wf::signal::connection_base_t::disconnect()
 {
     auto connected_copy = this->connected_to;
@@ -1,6 +1,10 @@
 #include <wayfire/util/log.hpp>
+#include <algorithm>
 #include <map>
+#include <optional>
+#include <unordered_map>
 #include "opengl-priv.hpp"
+#include "program-cache.hpp"
 #include "wayfire/geometry.hpp"
 #include "wayfire/output.hpp"
 #include "core-impl.hpp"
@@ -11,6 +15,7 @@
 
 #include "shaders.tpp"
 #include "wayfire/region.hpp"
+#include "wayfire/debug.hpp"
 
 const char *gl_error_string(const GLenum err)
 {
@@ -52,6 +57,29 @@ namespace OpenGL
  * Each of the following functions uses the currently bound context
  */
 program_t program, color_program;
+
+/** Handles for the uniforms and attributes of the default programs */
+struct default_locations_t
+{
+    attrib_t position;
+    attrib_t uv_position;
+    uniform_t mvp;
+    uniform_t color;
+    uniform_t uv_base;
+    uniform_t uv_scale;
+
+    void init(program_t& prog)
+    {
+        position    = prog.get_attrib("position");
+        uv_position = prog.get_attrib("uvPosition");
+        mvp   = prog.get_uniform("MVP");
+        color = prog.get_uniform("color");
+        uv_base  = prog.get_uniform("_wayfire_uv_base");
+        uv_scale = prog.get_uniform("_wayfire_uv_scale");
+    }
+};
+
+default_locations_t program_locs, color_program_locs;
 GLuint compile_shader(std::string source, GLuint type)
 {
     GLuint shader = GL_CALL(glCreateShader(type));
@@ -80,38 +108,297 @@ GLuint compile_shader(std::string source, GLuint type)
 /* Create a very simple gl program from the given shader sources */
 GLuint compile_program(std::string vertex_source, std::string frag_source)
 {
-    auto vertex_shader   = compile_shader(vertex_source, GL_VERTEX_SHADER);
-    auto fragment_shader = compile_shader(frag_source, GL_FRAGMENT_SHADER);
-    auto result_program  = GL_CALL(glCreateProgram());
-    GL_CALL(glAttachShader(result_program, vertex_shader));
-    GL_CALL(glAttachShader(result_program, fragment_shader));
-    GL_CALL(glLinkProgram(result_program));
+    return get_program_cache().link(vertex_source, frag_source);
+}
+
+namespace
+{
+void make_context_current()
+{
+    if (!wlr_egl_is_current(wf::get_core_impl().egl))
+    {
+        wlr_egl_make_current(wf::get_core_impl().egl, EGL_NO_SURFACE, NULL);
+    }
+}
+
+/**
+ * Collects textured and colored quads and draws them with as few draw calls
+ * and state changes as possible.
+ *
+ * Quads are grouped by the GL state they need. A quad may be added to an
+ * earlier group only if it does not overlap any of the groups queued after it,
+ * so the result is the same as drawing the quads in the order they were queued.
+ * All groups are uploaded to a single vertex buffer on flush.
+ */
+class batch_renderer_t
+{
+  public:
+    struct state_t
+    {
+        /* 0 for colored rectangles */
+        GLuint tex_id     = 0;
+        GLenum tex_target = GL_TEXTURE_2D;
+        wf::texture_type_t type = wf::TEXTURE_TYPE_RGBA;
+        GLint mag_filter = GL_LINEAR;
+        glm::vec4 color{1.0f};
+
+        bool operator ==(const state_t& other) const
+        {
+            return tex_id == other.tex_id && tex_target == other.tex_target &&
+                   type == other.type && mag_filter == other.mag_filter &&
+                   color == other.color;
+        }
+    };
+
+    int depth = 0;
+
+    void init()
+    {
+        GL_CALL(glGenBuffers(1, &vbo));
+    }
+
+    void fini()
+    {
+        groups.clear();
+        GL_CALL(glDeleteBuffers(1, &vbo));
+        vbo = 0;
+    }
+
+    /**
+     * Queue a quad.
+     *
+     * @param uv The texture coordinates of the left (x1), right (x2), top (y1)
+     *   and bottom (y2) edges of the quad.
+     */
+    void add_quad(const wf::render_target_t& new_target, const state_t& state,
+        const wf::geometry_t& geometry, const gl_geometry& uv, const wf::region_t& damage)
+    {
+        if ((geometry.width <= 0) || (geometry.height <= 0))
+        {
+            return;
+        }
+
+        /* Clip in framebuffer pixels, rounded outwards in the same way as a
+         * scissor (and the background clear) for the same damage would be. */
+        wf::region_t clipped = new_target.framebuffer_region_from_geometry_region(damage) &
+            new_target.framebuffer_box_from_geometry_box(geometry);
+        if (clipped.empty())
+        {
+            return;
+        }
+
+        set_target(new_target);
+
+        int idx = -1;
+        for (int i = (int)groups.size() - 1; i >= 0; i--)
+        {
+            if (groups[i].state == state)
+            {
+                idx = i;
+                break;
+            }
+
+            if (!(groups[i].bounds & clipped).empty())
+            {
+                break;
+            }
+        }
+
+        if (idx < 0)
+        {
+            groups.push_back({});
+            groups.back().state = state;
+            idx = groups.size() - 1;
+        }
+
+        auto& group = groups[idx];
+        auto uv_at  = [&] (float x, float y) -> glm::vec2
+        {
+            float fx = (x - geometry.x) / geometry.width;
+            float fy = (y - geometry.y) / geometry.height;
+            return {uv.x1 + (uv.x2 - uv.x1) * fx, uv.y1 + (uv.y2 - uv.y1) * fy};
+        };
+
+        for (const auto& rect : clipped)
+        {
+            const glm::vec2 a = to_logical(rect.x1, rect.y1);
+            const glm::vec2 b = to_logical(rect.x2, rect.y2);
+            const float x1 = std::max<float>(std::min(a.x, b.x), geometry.x);
+            const float y1 = std::max<float>(std::min(a.y, b.y), geometry.y);
+            const float x2 = std::min<float>(std::max(a.x, b.x), geometry.x + geometry.width);
+            const float y2 = std::min<float>(std::max(a.y, b.y), geometry.y + geometry.height);
+            if ((x1 >= x2) || (y1 >= y2))
+            {
+                continue;
+            }
+
+            const glm::vec2 tl = uv_at(x1, y1), tr = uv_at(x2, y1);
+            const glm::vec2 bl = uv_at(x1, y2), br = uv_at(x2, y2);
+            group.vertices.insert(group.vertices.end(), {
+                x1, y2, bl.x, bl.y,
+                x2, y2, br.x, br.y,
+                x2, y1, tr.x, tr.y,
+                x1, y2, bl.x, bl.y,
+                x2, y1, tr.x, tr.y,
+                x1, y1, tl.x, tl.y,
+            });
+        }
+
+        group.bounds |= clipped;
+    }
+
+    void flush()
+    {
+        if (groups.empty())
+        {
+            return;
+        }
+
+        make_context_current();
+        target->bind();
+        GL_CALL(glDisable(GL_SCISSOR_TEST));
+        GL_CALL(glEnable(GL_BLEND));
+        GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
+
+        upload.clear();
+        for (auto& group : groups)
+        {
+            upload.insert(upload.end(), group.vertices.begin(), group.vertices.end());
+        }
+
+        GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, vbo));
+        GL_CALL(glBufferData(GL_ARRAY_BUFFER, upload.size() * sizeof(GLfloat),
+            upload.data(), GL_STREAM_DRAW));
+
+        const GLsizei stride = 4 * sizeof(GLfloat);
+        program_t *current_program = nullptr;
+        int current_type = -1;
+        GLint first = 0;
+        for (auto& group : groups)
+        {
+            auto& state = group.state;
+            program_t *prog = state.tex_id ? &program : &color_program;
+            auto& locs = state.tex_id ? program_locs : color_program_locs;
+            if ((prog != current_program) || (state.type != current_type))
+            {
+                if (current_program)
+                {
+                    current_program->deactivate();
+                }
+
+                current_program = prog;
+                current_type    = state.type;
+                prog->use(state.type);
+                prog->attrib_pointer(locs.position, 2, stride, (void*)0);
+                if (state.tex_id)
+                {
+                    prog->attrib_pointer(locs.uv_position, 2, stride, (void*)(2 * sizeof(GLfloat)));
+                    // Viewport and inversion are already applied to the coordinates
+                    prog->uniform2f(locs.uv_base, 0.0f, 0.0f);
+                    prog->uniform2f(locs.uv_scale, 1.0f, 1.0f);
+                }
+
+                prog->uniformMatrix4f(locs.mvp, projection);
+            }
+
+            if (state.tex_id)
+            {
+                GL_CALL(glActiveTexture(GL_TEXTURE0));
+                GL_CALL(glBindTexture(state.tex_target, state.tex_id));
+                GL_CALL(glTexParameteri(state.tex_target, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+                GL_CALL(glTexParameteri(state.tex_target, GL_TEXTURE_MAG_FILTER, state.mag_filter));
+            }
+
+            prog->uniform4f(locs.color, state.color);
+
+            const GLsizei count = group.vertices.size() / 4;
+            GL_CALL(glDrawArrays(GL_TRIANGLES, first, count));
+            first += count;
+        }
+
+        current_program->deactivate();
+        GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+        groups.clear();
+        target.reset();
+        render_end();
+    }
+
+  private:
+    struct group_t
+    {
+        state_t state;
+        /* Interleaved x, y, u, v for each vertex */
+        std::vector<GLfloat> vertices;
+        /* In framebuffer coordinates */
+        wf::region_t bounds;
+    };
+
+    GLuint vbo = 0;
+    std::optional<wf::render_target_t> target;
+    glm::mat4 projection;
+    /* Maps framebuffer coordinates (top-left origin) to logical coordinates */
+    glm::mat4 framebuffer_to_logical;
+
+    std::vector<group_t> groups;
+    std::vector<GLfloat> upload;
+
+    void set_target(const wf::render_target_t& new_target)
+    {
+        const auto new_projection = new_target.get_orthographic_projection();
+        if (target && ((target->fb != new_target.fb) ||
+                       (target->viewport_width != new_target.viewport_width) ||
+                       (target->viewport_height != new_target.viewport_height) ||
+                       (projection != new_projection)))
+        {
+            flush();
+        }
+
+        target     = new_target;
+        projection = new_projection;
+
+        const float half_w = new_target.viewport_width / 2.0f;
+        const float half_h = new_target.viewport_height / 2.0f;
+        const glm::mat4 ndc_to_framebuffer =
+            glm::translate(glm::mat4(1.0), glm::vec3(half_w, half_h, 0.0)) *
+            glm::scale(glm::mat4(1.0), glm::vec3(half_w, -half_h, 1.0));
+        framebuffer_to_logical = glm::inverse(ndc_to_framebuffer * projection);
+    }
 
-    /* won't be really deleted until program is deleted as well */
-    GL_CALL(glDeleteShader(vertex_shader));
-    GL_CALL(glDeleteShader(fragment_shader));
+    glm::vec2 to_logical(float x, float y) const
+    {
+        const glm::vec4 logical = framebuffer_to_logical * glm::vec4(x, y, 0.0, 1.0);
+        return {logical.x, logical.y};
+    }
+};
 
-    return result_program;
+batch_renderer_t batch;
 }
 
 void init()
 {
     render_begin();
     // enable_gl_synchronuous_debug()
+    init_program_cache();
     program.compile(default_vertex_shader_source,
         default_fragment_shader_source);
 
-    color_program.set_simple(compile_program(default_vertex_shader_source,
-        color_rect_fragment_source));
+    color_program.set_simple(default_vertex_shader_source,
+        color_rect_fragment_source);
+    program_locs.init(program);
+    color_program_locs.init(color_program);
 
+    batch.init();
     render_end();
 }
 
 void fini()
 {
     render_begin();
+    batch.fini();
     program.free_resources();
     color_program.free_resources();
+    fini_program_cache();
     render_end();
 }
 
@@ -175,10 +462,10 @@ void render_transformed_texture(wf::texture_t tex,
     };
 
     program.set_active_texture(tex);
-    program.attrib_pointer("position", 2, 0, vertexData.data());
-    program.attrib_pointer("uvPosition", 2, 0, coordData.data());
-    program.uniformMatrix4f("MVP", model);
-    program.uniform4f("color", color);
+    program.attrib_pointer(program_locs.position, 2, 0, vertexData.data());
+    program.attrib_pointer(program_locs.uv_position, 2, 0, coordData.data());
+    program.uniformMatrix4f(program_locs.mvp, model);
+    program.uniform4f(program_locs.color, color);
 
     GL_CALL(glEnable(GL_BLEND));
     GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
@@ -239,9 +526,9 @@ void render_rectangle(wf::geometry_t geometry, wf::color_t color,
         x, y,
     };
 
-    color_program.attrib_pointer("position", 2, 0, vertexData);
-    color_program.uniformMatrix4f("MVP", matrix);
-    color_program.uniform4f("color", {color.r, color.g, color.b, color.a});
+    color_program.attrib_pointer(color_program_locs.position, 2, 0, vertexData);
+    color_program.uniformMatrix4f(color_program_locs.mvp, matrix);
+    color_program.uniform4f(color_program_locs.color, {color.r, color.g, color.b, color.a});
 
     GL_CALL(glEnable(GL_BLEND));
     GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
@@ -250,13 +537,92 @@ void render_rectangle(wf::geometry_t geometry, wf::color_t color,
     color_program.deactivate();
 }
 
-void render_begin()
+void batch_texture(const wf::texture_t& texture,
+    const wf::render_target_t& target, const wf::geometry_t& geometry,
+    const wf::region_t& damage, glm::vec4 color, uint32_t bits)
 {
-    if (!wlr_egl_is_current(wf::get_core_impl().egl))
+    batch_renderer_t::state_t state;
+    state.tex_id     = texture.tex_id;
+    state.tex_target = texture.target;
+    state.type  = texture.type;
+    state.color = color;
+    state.mag_filter = (bits & TEXTURE_FILTER_NEAREST) ? GL_NEAREST : GL_LINEAR;
+
+    // Edges of the quad in the same [0,1]x[0,1] space as render_transformed_texture()
+    gl_geometry uv = {0.0f, 1.0f, 1.0f, 0.0f};
+    if (bits & TEXTURE_TRANSFORM_INVERT_X)
     {
-        wlr_egl_make_current(wf::get_core_impl().egl, EGL_NO_SURFACE, NULL);
+        std::swap(uv.x1, uv.x2);
     }
 
+    if (bits & TEXTURE_TRANSFORM_INVERT_Y)
+    {
+        std::swap(uv.y1, uv.y2);
+    }
+
+    // Apply the texture viewport and inversion, see program_t::set_active_texture()
+    glm::vec2 base{0.0f, 0.0f};
+    glm::vec2 scale{1.0f, 1.0f};
+    if (texture.has_viewport)
+    {
+        scale.x = texture.viewport_box.x2 - texture.viewport_box.x1;
+        scale.y = texture.viewport_box.y2 - texture.viewport_box.y1;
+        base.x  = texture.viewport_box.x1;
+        base.y  = texture.viewport_box.y1;
+    }
+
+    if (texture.invert_y)
+    {
+        scale.y *= -1;
+        base.y   = 1.0 - base.y;
+    }
+
+    uv.x1 = base.x + scale.x * uv.x1;
+    uv.x2 = base.x + scale.x * uv.x2;
+    uv.y1 = base.y + scale.y * uv.y1;
+    uv.y2 = base.y + scale.y * uv.y2;
+
+    batch.add_quad(target, state, geometry, uv, damage);
+    if (batch.depth == 0)
+    {
+        batch.flush();
+    }
+}
+
+void batch_rectangle(const wf::render_target_t& target,
+    const wf::geometry_t& geometry, const wf::region_t& damage, wf::color_t color)
+{
+    batch_renderer_t::state_t state;
+    state.color = {color.r, color.g, color.b, color.a};
+    batch.add_quad(target, state, geometry, {0, 0, 0, 0}, damage);
+    if (batch.depth == 0)
+    {
+        batch.flush();
+    }
+}
+
+void batch_begin()
+{
+    ++batch.depth;
+}
+
+void batch_end()
+{
+    assert(batch.depth > 0);
+    --batch.depth;
+    batch.flush();
+}
+
+void flush_batch()
+{
+    batch.flush();
+}
+
+void render_begin()
+{
+    make_context_current();
+    batch.flush();
+
     GL_CALL(glEnable(GL_BLEND));
     GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
 }
@@ -406,6 +772,16 @@ void wf::framebuffer_t::reset()
     viewport_width = viewport_height = 0;
 }
 
+float wf::render_target_t::get_effective_scale() const
+{
+    if (!subbuffer || (viewport_width <= 0))
+    {
+        return scale;
+    }
+
+    return scale * subbuffer->width / viewport_width;
+}
+
 wlr_box wf::render_target_t::framebuffer_box_from_geometry_box(wlr_box box) const
 {
     /* Step 1: Make relative to the framebuffer */
@@ -574,46 +950,109 @@ wf::texture_t::texture_t(wlr_texture *texture, std::optional<wlr_fbox> viewport)
 
 namespace OpenGL
 {
-class program_t::impl
+/**
+ * The uniforms or attributes of a program_t, indexed by their handles, and
+ * their locations in each program.
+ */
+class location_table_t
 {
   public:
-    std::set<int> active_attrs;
-    std::set<int> active_attrs_divisors;
+    using resolve_t = GLint (*)(GLuint, const GLchar*);
+    location_table_t(resolve_t resolve) : resolve(resolve)
+    {}
 
-    int active_program_idx = 0;
+    int get_index(const std::string& name)
+    {
+        auto it = index.find(name);
+        if (it != index.end())
+        {
+            return it->second;
+        }
 
-    int id[wf::TEXTURE_TYPE_ALL];
-    std::unordered_map<std::string, int> uniforms[wf::TEXTURE_TYPE_ALL];
+        names.push_back(name);
+        index[name] = names.size() - 1;
+        return names.size() - 1;
+    }
 
-    /** Find the uniform location for the currently bound program */
-    int find_uniform_loc(const std::string& name)
+    /** Find the location in the given program, resolving it on first use */
+    int find(int type, GLuint program_id, int idx)
     {
-        auto it = uniforms[active_program_idx].find(name);
-        if (it != uniforms[active_program_idx].end())
+        wf::dassert((idx >= 0) && (idx < (int)names.size()),
+            "Invalid handle, was it obtained with get_uniform()/get_attrib() of the same program?");
+        auto& locs = locations[type];
+        if (idx >= (int)locs.size())
         {
-            return it->second;
+            locs.resize(names.size(), UNRESOLVED);
         }
 
-        uniforms[active_program_idx][name] =
-            GL_CALL(glGetUniformLocation(id[active_program_idx], name.c_str()));
+        if (locs[idx] == UNRESOLVED)
+        {
+            locs[idx] = GL_CALL(resolve(program_id, names[idx].c_str()));
+        }
 
-        return uniforms[active_program_idx][name];
+        return locs[idx];
     }
 
-    std::map<std::string, int> attribs[wf::TEXTURE_TYPE_ALL];
-    /** Find the attrib location for the currently bound program */
-    int find_attrib_loc(const std::string& name)
+    /** Forget the resolved locations, but keep the handles valid */
+    void clear_locations()
     {
-        auto it = attribs[active_program_idx].find(name);
-        if (it != attribs[active_program_idx].end())
+        for (auto& locs : locations)
         {
-            return it->second;
+            locs.clear();
         }
+    }
+
+  private:
+    /* -1 is returned by GL for names which are not used in the program */
+    static constexpr int UNRESOLVED = -2;
+
+    resolve_t resolve;
+    std::unordered_map<std::string, int> index;
+    std::vector<std::string> names;
+    std::vector<int> locations[wf::TEXTURE_TYPE_ALL];
+};
 
-        attribs[active_program_idx][name] =
-            GL_CALL(glGetAttribLocation(id[active_program_idx], name.c_str()));
+class program_t::impl
+{
+  public:
+    std::vector<int> active_attrs;
+    std::vector<int> active_attrs_divisors;
 
-        return attribs[active_program_idx][name];
+    int active_program_idx = 0;
+
+    /* Programs set with set_simple(GLuint), owned by the program_t */
+    int id[wf::TEXTURE_TYPE_ALL];
+    /* Programs compiled from source, shared through the program cache */
+    cached_program_t *cached[wf::TEXTURE_TYPE_ALL];
+
+    location_table_t uniforms{glGetUniformLocation};
+    location_table_t attribs{glGetAttribLocation};
+
+    /* Builtin uniforms, used by set_active_texture() */
+    uniform_t uv_base;
+    uniform_t uv_scale;
+
+    /** @return The program id for the given type, linking it if necessary */
+    int get_id(int type)
+    {
+        if (cached[type])
+        {
+            return get_program_cache().get_id(cached[type]);
+        }
+
+        return id[type];
+    }
+
+    /** Find the uniform location for the currently bound program */
+    int find_uniform_loc(uniform_t uniform)
+    {
+        return uniforms.find(active_program_idx, get_id(active_program_idx), uniform.index);
+    }
+
+    /** Find the attrib location for the currently bound program */
+    int find_attrib_loc(attrib_t attrib)
+    {
+        return attribs.find(active_program_idx, get_id(active_program_idx), attrib.index);
     }
 };
 
@@ -622,8 +1061,12 @@ program_t::program_t()
     this->priv = std::make_unique<impl>();
     for (int i = 0; i < wf::TEXTURE_TYPE_ALL; i++)
     {
-        this->priv->id[i] = 0;
+        this->priv->id[i]     = 0;
+        this->priv->cached[i] = nullptr;
     }
+
+    this->priv->uv_base  = get_uniform("_wayfire_uv_base");
+    this->priv->uv_scale = get_uniform("_wayfire_uv_scale");
 }
 
 void program_t::set_simple(GLuint program_id, wf::texture_type_t type)
@@ -633,6 +1076,15 @@ void program_t::set_simple(GLuint program_id, wf::texture_type_t type)
     this->priv->id[type] = program_id;
 }
 
+void program_t::set_simple(const std::string& vertex_source,
+    const std::string& fragment_source, wf::texture_type_t type)
+{
+    free_resources();
+    assert(type < wf::TEXTURE_TYPE_ALL);
+    this->priv->cached[type] =
+        get_program_cache().acquire(vertex_source, fragment_source);
+}
+
 program_t::~program_t()
 {}
 
@@ -674,8 +1126,8 @@ void program_t::compile(const std::string& vertex_source,
             builtin, program_type.second.builtin);
         fragment = replace_builtin_with(fragment,
             builtin_ext, program_type.second.builtin_ext);
-        this->priv->id[program_type.first] =
-            compile_program(vertex_source, fragment);
+        this->priv->cached[program_type.first] =
+            get_program_cache().acquire(vertex_source, fragment);
     }
 }
 
@@ -688,79 +1140,150 @@ void program_t::free_resources()
             GL_CALL(glDeleteProgram(priv->id[i]));
             this->priv->id[i] = 0;
         }
+
+        if (this->priv->cached[i])
+        {
+            get_program_cache().release(priv->cached[i]);
+            this->priv->cached[i] = nullptr;
+        }
     }
+
+    // Locations may differ in the next program
+    this->priv->uniforms.clear_locations();
+    this->priv->attribs.clear_locations();
 }
 
 void program_t::use(wf::texture_type_t type)
 {
-    if (priv->id[type] == 0)
+    int id = priv->get_id(type);
+    if (id == 0)
     {
         throw std::runtime_error("program_t has no program for type " +
             std::to_string(type));
     }
 
-    GL_CALL(glUseProgram(priv->id[type]));
+    GL_CALL(glUseProgram(id));
     priv->active_program_idx = type;
 }
 
 int program_t::get_program_id(wf::texture_type_t type)
 {
-    return priv->id[type];
+    return priv->get_id(type);
 }
 
-void program_t::uniform1i(const std::string& name, int value)
+uniform_t program_t::get_uniform(const std::string& name)
 {
-    int loc = priv->find_uniform_loc(name);
+    return uniform_t{priv->uniforms.get_index(name)};
+}
+
+attrib_t program_t::get_attrib(const std::string& name)
+{
+    return attrib_t{priv->attribs.get_index(name)};
+}
+
+void program_t::uniform1i(uniform_t uniform, int value)
+{
+    int loc = priv->find_uniform_loc(uniform);
     GL_CALL(glUniform1i(loc, value));
 }
 
-void program_t::uniform1f(const std::string& name, float value)
+void program_t::uniform1f(uniform_t uniform, float value)
 {
-    int loc = priv->find_uniform_loc(name);
+    int loc = priv->find_uniform_loc(uniform);
     GL_CALL(glUniform1f(loc, value));
 }
 
-void program_t::uniform2f(const std::string& name, float x, float y)
+void program_t::uniform2f(uniform_t uniform, float x, float y)
 {
-    int loc = priv->find_uniform_loc(name);
+    int loc = priv->find_uniform_loc(uniform);
     GL_CALL(glUniform2f(loc, x, y));
 }
 
-void program_t::uniform3f(const std::string& name, float x, float y, float z)
+void program_t::uniform3f(uniform_t uniform, float x, float y, float z)
 {
-    int loc = priv->find_uniform_loc(name);
+    int loc = priv->find_uniform_loc(uniform);
     GL_CALL(glUniform3f(loc, x, y, z));
 }
 
-void program_t::uniform4f(const std::string& name, const glm::vec4& value)
+void program_t::uniform4f(uniform_t uniform, const glm::vec4& value)
 {
-    int loc = priv->find_uniform_loc(name);
+    int loc = priv->find_uniform_loc(uniform);
     GL_CALL(glUniform4f(loc, value.r, value.g, value.b, value.a));
 }
 
-void program_t::uniformMatrix4f(const std::string& name, const glm::mat4& value)
+void program_t::uniformMatrix4f(uniform_t uniform, const glm::mat4& value)
 {
-    int loc = priv->find_uniform_loc(name);
+    int loc = priv->find_uniform_loc(uniform);
     GL_CALL(glUniformMatrix4fv(loc, 1, GL_FALSE, &value[0][0]));
 }
 
-void program_t::attrib_pointer(const std::string& attrib,
+void program_t::uniform1i(const std::string& name, int value)
+{
+    uniform1i(get_uniform(name), value);
+}
+
+void program_t::uniform1f(const std::string& name, float value)
+{
+    uniform1f(get_uniform(name), value);
+}
+
+void program_t::uniform2f(const std::string& name, float x, float y)
+{
+    uniform2f(get_uniform(name), x, y);
+}
+
+void program_t::uniform3f(const std::string& name, float x, float y, float z)
+{
+    uniform3f(get_uniform(name), x, y, z);
+}
+
+void program_t::uniform4f(const std::string& name, const glm::vec4& value)
+{
+    uniform4f(get_uniform(name), value);
+}
+
+void program_t::uniformMatrix4f(const std::string& name, const glm::mat4& value)
+{
+    uniformMatrix4f(get_uniform(name), value);
+}
+
+void program_t::attrib_pointer(attrib_t attrib,
     int size, int stride, const void *ptr, GLenum type)
 {
     int loc = priv->find_attrib_loc(attrib);
-    priv->active_attrs.insert(loc);
+    if (std::find(priv->active_attrs.begin(), priv->active_attrs.end(), loc) ==
+        priv->active_attrs.end())
+    {
+        priv->active_attrs.push_back(loc);
+    }
 
     GL_CALL(glEnableVertexAttribArray(loc));
     GL_CALL(glVertexAttribPointer(loc, size, type, GL_FALSE, stride, ptr));
 }
 
-void program_t::attrib_divisor(const std::string& attrib, int divisor)
+void program_t::attrib_pointer(const std::string& attrib,
+    int size, int stride, const void *ptr, GLenum type)
+{
+    attrib_pointer(get_attrib(attrib), size, stride, ptr, type);
+}
+
+void program_t::attrib_divisor(attrib_t attrib, int divisor)
 {
     int loc = priv->find_attrib_loc(attrib);
-    priv->active_attrs_divisors.insert(loc);
+    if (std::find(priv->active_attrs_divisors.begin(), priv->active_attrs_divisors.end(), loc) ==
+        priv->active_attrs_divisors.end())
+    {
+        priv->active_attrs_divisors.push_back(loc);
+    }
+
     GL_CALL(glVertexAttribDivisor(loc, divisor));
 }
 
+void program_t::attrib_divisor(const std::string& attrib, int divisor)
+{
+    attrib_divisor(get_attrib(attrib), divisor);
+}
+
 void program_t::set_active_texture(const wf::texture_t& texture)
 {
     GL_CALL(glActiveTexture(GL_TEXTURE0));
@@ -784,8 +1307,8 @@ void program_t::set_active_texture(const wf::texture_t& texture)
         base.y   = 1.0 - base.y;
     }
 
-    uniform2f("_wayfire_uv_base", base.x, base.y);
-    uniform2f("_wayfire_uv_scale", scale.x, scale.y);
+    uniform2f(priv->uv_base, base.x, base.y);
+    uniform2f(priv->uv_scale, scale.x, scale.y);
 }
 
 void program_t::deactivate()
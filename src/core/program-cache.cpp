@@ -0,0 +1,322 @@
+#include "program-cache.hpp"
+#include <wayfire/option-wrapper.hpp>
+#include <wayfire/util/log.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <unistd.h>
+
+/* Link the program from source, without using the binary store */
+static GLuint compile_and_link(const std::string& vertex_source, const std::string& fragment_source,
+    bool retrievable)
+{
+    auto vertex_shader   = OpenGL::compile_shader(vertex_source, GL_VERTEX_SHADER);
+    auto fragment_shader = OpenGL::compile_shader(fragment_source, GL_FRAGMENT_SHADER);
+    auto result_program  = GL_CALL(glCreateProgram());
+    GL_CALL(glAttachShader(result_program, vertex_shader));
+    GL_CALL(glAttachShader(result_program, fragment_shader));
+    if (retrievable)
+    {
+        GL_CALL(glProgramParameteri(result_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+    }
+
+    GL_CALL(glLinkProgram(result_program));
+
+    /* won't be really deleted until program is deleted as well */
+    GL_CALL(glDeleteShader(vertex_shader));
+    GL_CALL(glDeleteShader(fragment_shader));
+
+    return result_program;
+}
+
+static bool is_linked(GLuint program)
+{
+    GLint status = GL_FALSE;
+    GL_CALL(glGetProgramiv(program, GL_LINK_STATUS, &status));
+    return status == GL_TRUE;
+}
+
+/* Magic number at the start of each stored binary, followed by the format, the
+ * length of the key, the key and the binary itself. */
+static const uint32_t BINARY_MAGIC = 0x57465042; // WFPB
+
+namespace OpenGL
+{
+program_binary_store_t::program_binary_store_t()
+{
+    wf::option_wrapper_t<bool> shader_cache{"core/shader_cache"};
+    if (!shader_cache)
+    {
+        return;
+    }
+
+    // Program binaries are a GLES 3.0 feature, but the renderer may have created
+    // a GLES 2.0 context.
+    const char *version = (const char*)glGetString(GL_VERSION);
+    int major = 0;
+    if (!version || (sscanf(version, "OpenGL ES %d", &major) != 1) || (major < 3))
+    {
+        return;
+    }
+
+    GLint nr_formats = 0;
+    GL_CALL(glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &nr_formats));
+    if (nr_formats <= 0)
+    {
+        LOGD("The driver does not support program binaries, not caching shaders");
+        return;
+    }
+
+    const char *cache_home = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    if (cache_home && *cache_home)
+    {
+        directory = cache_home;
+    } else if (home && *home)
+    {
+        directory = std::filesystem::path(home) / ".cache";
+    } else
+    {
+        return;
+    }
+
+    directory /= "wayfire/shaders";
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    if (ec)
+    {
+        LOGW("Failed to create shader cache directory ", directory.string(), ": ", ec.message());
+        return;
+    }
+
+    driver = std::string((const char*)glGetString(GL_VENDOR)) + "\n" +
+        (const char*)glGetString(GL_RENDERER) + "\n" + version;
+    enabled = true;
+}
+
+std::string program_binary_store_t::get_key(const std::string& vertex_source,
+    const std::string& fragment_source) const
+{
+    return driver + '\0' + vertex_source + '\0' + fragment_source;
+}
+
+std::filesystem::path program_binary_store_t::get_path(const std::string& key) const
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016zx.bin", std::hash<std::string>{}(key));
+    return directory / name;
+}
+
+GLuint program_binary_store_t::load(const std::string& vertex_source, const std::string& fragment_source)
+{
+    if (!enabled)
+    {
+        return 0;
+    }
+
+    const auto key  = get_key(vertex_source, fragment_source);
+    const auto path = get_path(key);
+    std::ifstream file{path, std::ios::binary};
+    if (!file)
+    {
+        return 0;
+    }
+
+    uint32_t header[3];
+    if (!file.read((char*)header, sizeof(header)) || (header[0] != BINARY_MAGIC) ||
+        (header[2] != key.size()))
+    {
+        return 0;
+    }
+
+    std::string stored_key(key.size(), '\0');
+    if (!file.read(stored_key.data(), stored_key.size()) || (stored_key != key))
+    {
+        // Different sources with the same hash, will be overwritten by save()
+        return 0;
+    }
+
+    std::vector<char> binary{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    auto program = GL_CALL(glCreateProgram());
+    GL_CALL(glProgramBinary(program, header[1], binary.data(), binary.size()));
+    if (!is_linked(program))
+    {
+        // The driver may reject binaries, for ex. after an update which did not
+        // change the version string.
+        GL_CALL(glDeleteProgram(program));
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+        return 0;
+    }
+
+    return program;
+}
+
+void program_binary_store_t::save(const std::string& vertex_source, const std::string& fragment_source,
+    GLuint program)
+{
+    if (!enabled || !is_linked(program))
+    {
+        return;
+    }
+
+    GLint length = 0;
+    GL_CALL(glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length));
+    if (length <= 0)
+    {
+        return;
+    }
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    GL_CALL(glGetProgramBinary(program, length, &length, &format, binary.data()));
+
+    const auto key  = get_key(vertex_source, fragment_source);
+    const auto path = get_path(key);
+
+    // Write to a temporary file first, so that a crash or a second instance of
+    // Wayfire never sees a partially written binary.
+    auto tmp_path = path;
+    tmp_path += "." + std::to_string(getpid()) + ".tmp";
+    {
+        std::ofstream file{tmp_path, std::ios::binary | std::ios::trunc};
+        uint32_t header[3] = {BINARY_MAGIC, format, (uint32_t)key.size()};
+        file.write((const char*)header, sizeof(header));
+        file.write(key.data(), key.size());
+        file.write(binary.data(), length);
+        if (!file)
+        {
+            LOGW("Failed to write shader cache file ", tmp_path.string());
+            std::error_code ec;
+            std::filesystem::remove(tmp_path, ec);
+            return;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, path, ec);
+    if (ec)
+    {
+        std::filesystem::remove(tmp_path, ec);
+    }
+}
+
+/* How often the pending programs are linked, one per timeout */
+static constexpr int PREWARM_INTERVAL = 1;
+
+program_cache_t::program_cache_t()
+{
+    store = std::make_unique<program_binary_store_t>();
+}
+
+program_cache_t::~program_cache_t()
+{
+    for (auto& [_, program] : programs)
+    {
+        if (program->id)
+        {
+            GL_CALL(glDeleteProgram(program->id));
+        }
+    }
+}
+
+GLuint program_cache_t::link(const std::string& vertex_source, const std::string& fragment_source)
+{
+    if (auto program = store->load(vertex_source, fragment_source))
+    {
+        return program;
+    }
+
+    auto program = compile_and_link(vertex_source, fragment_source, store->is_enabled());
+    store->save(vertex_source, fragment_source, program);
+    return program;
+}
+
+cached_program_t*program_cache_t::acquire(const std::string& vertex_source,
+    const std::string& fragment_source)
+{
+    auto& program = programs[vertex_source + '\0' + fragment_source];
+    if (!program)
+    {
+        program = std::make_unique<cached_program_t>();
+        program->vertex_source   = vertex_source;
+        program->fragment_source = fragment_source;
+        pending.push_back(program.get());
+        if (!prewarm.is_connected())
+        {
+            prewarm.set_timeout(PREWARM_INTERVAL, [=] ()
+            {
+                // Programs may have been linked on use in the meantime
+                if (pending.empty())
+                {
+                    return false;
+                }
+
+                OpenGL::render_begin();
+                get_id(pending.front());
+                OpenGL::render_end();
+                return !pending.empty();
+            });
+        }
+    }
+
+    ++program->refcount;
+    return program.get();
+}
+
+void program_cache_t::release(cached_program_t *program)
+{
+    if (--program->refcount > 0)
+    {
+        return;
+    }
+
+    if (program->id)
+    {
+        GL_CALL(glDeleteProgram(program->id));
+    }
+
+    auto it = std::find(pending.begin(), pending.end(), program);
+    if (it != pending.end())
+    {
+        pending.erase(it);
+        if (pending.empty())
+        {
+            prewarm.disconnect();
+        }
+    }
+
+    programs.erase(program->vertex_source + '\0' + program->fragment_source);
+}
+
+GLuint program_cache_t::get_id(cached_program_t *program)
+{
+    if (program->id)
+    {
+        return program->id;
+    }
+
+    program->id = link(program->vertex_source, program->fragment_source);
+    pending.erase(std::remove(pending.begin(), pending.end(), program), pending.end());
+    return program->id;
+}
+
+static std::unique_ptr<program_cache_t> program_cache;
+
+void init_program_cache()
+{
+    program_cache = std::make_unique<program_cache_t>();
+}
+
+void fini_program_cache()
+{
+    program_cache.reset();
+}
+
+program_cache_t& get_program_cache()
+{
+    return *program_cache;
+}
+}
@@ -0,0 +1,108 @@
+#ifndef WF_PROGRAM_CACHE_HPP
+#define WF_PROGRAM_CACHE_HPP
+
+#include <wayfire/opengl.hpp>
+#include <wayfire/util.hpp>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace OpenGL
+{
+/**
+ * Stores the binaries of linked programs (glGetProgramBinary) on disk, so that
+ * the programs do not have to be compiled again the next time Wayfire starts.
+ *
+ * The binaries are stored in $XDG_CACHE_HOME/wayfire/shaders. Each file also
+ * contains the sources and the driver it was created with, and is used only if
+ * both match.
+ */
+class program_binary_store_t
+{
+  public:
+    /** Needs a current GL context, since it checks support for binaries. */
+    program_binary_store_t();
+
+    /** @return The linked program for the sources, or 0 if not stored. */
+    GLuint load(const std::string& vertex_source, const std::string& fragment_source);
+
+    /** Store the binary of the given linked program. */
+    void save(const std::string& vertex_source, const std::string& fragment_source, GLuint program);
+
+    bool is_enabled() const
+    {
+        return enabled;
+    }
+
+  private:
+    bool enabled = false;
+    std::string driver;
+    std::filesystem::path directory;
+
+    std::string get_key(const std::string& vertex_source, const std::string& fragment_source) const;
+    std::filesystem::path get_path(const std::string& key) const;
+};
+
+/** A program shared by all program_t's which were created from the same sources. */
+struct cached_program_t
+{
+    std::string vertex_source;
+    std::string fragment_source;
+
+    /* 0 until the program has been linked */
+    GLuint id = 0;
+    int refcount = 0;
+};
+
+/**
+ * The cache of all programs used by core and plugins.
+ *
+ * Identical programs are linked only once, no matter how many plugins or
+ * outputs use them. Linking is deferred: new programs are linked one at a time
+ * shortly after they have been requested, or on first use if that happens
+ * earlier, so that loading plugins does not stall the compositor.
+ *
+ * All functions need a current GL context, except acquire().
+ */
+class program_cache_t
+{
+  public:
+    program_cache_t();
+    ~program_cache_t();
+
+    /**
+     * Link a new program which is owned by the caller, using the binary store
+     * if possible.
+     */
+    GLuint link(const std::string& vertex_source, const std::string& fragment_source);
+
+    /** Get a reference to the shared program with the given sources. */
+    cached_program_t *acquire(const std::string& vertex_source, const std::string& fragment_source);
+
+    /** Drop a reference, deleting the program if it was the last one. */
+    void release(cached_program_t *program);
+
+    /** @return The id of the program, linking it first if necessary. */
+    GLuint get_id(cached_program_t *program);
+
+  private:
+    std::unique_ptr<program_binary_store_t> store;
+
+    /* Indexed by the vertex and fragment sources */
+    std::unordered_map<std::string, std::unique_ptr<cached_program_t>> programs;
+    /* Programs which have been acquired, but not linked yet */
+    std::vector<cached_program_t*> pending;
+    wf::wl_timer<true> prewarm;
+};
+
+/** Create the global program cache. Called from OpenGL::init(). */
+void init_program_cache();
+/** Delete the global program cache. Called from OpenGL::fini(). */
+void fini_program_cache();
+/** Get the global program cache. */
+program_cache_t& get_program_cache();
+}
+
+#endif /* end of include guard: WF_PROGRAM_CACHE_HPP */
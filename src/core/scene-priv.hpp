@@ -1,12 +1,58 @@
 #pragma once
 #include <wayfire/scene.hpp>
+#include <wayfire/option-wrapper.hpp>
 
 
 namespace wf
 {
 namespace scene
 {
+/**
+ * The options of the scenegraph. They are loaded together with the root node,
+ * so that the hot paths (for ex. find_node_at()) do not have to check whether
+ * they have been loaded already.
+ */
 struct root_node_t::priv_t
-{};
+{
+    priv_t();
+
+    wf::option_wrapper_t<bool> input_spatial_index{"core/input_spatial_index"};
+    wf::option_wrapper_t<bool> bounding_box_cache{"core/bounding_box_cache"};
+};
+
+/**
+ * Fill the cached bounding boxes of the scenegraph, and do not modify them
+ * until thaw_bounding_boxes() is called. Render instances may be scheduled on
+ * worker threads in between (see core/parallel_scheduling), which only read
+ * the caches.
+ */
+void freeze_bounding_boxes();
+
+/** Allow filling the cached bounding boxes again. */
+void thaw_bounding_boxes();
+
+/**
+ * A tag for inner nodes directly below an output node, whose render instances
+ * are their own instance followed by the instances of their children, as
+ * generated by node_t::gen_render_instances(), for ex. workspace sets.
+ *
+ * The render instance of the output node keeps the instances of each child of
+ * such nodes separately, so that a restack or a new view on the output does not
+ * require regenerating the instances of all views.
+ */
+class flat_instances_tag_t
+{
+  public:
+    virtual ~flat_instances_tag_t() = default;
+};
+
+/**
+ * Update the render instance of an output node after @changed_node, which is
+ * below the output node, was updated. Only the instances of the affected child
+ * of the output node (or of a workspace set on it) are regenerated.
+ *
+ * @return False if @instance is not the render instance of an output node.
+ */
+bool update_output_render_instance(render_instance_t *instance, node_t *changed_node);
 }
 }
@@ -2,7 +2,9 @@
 #include <memory>
 #include <wayfire/scene.hpp>
 #include <wayfire/view.hpp>
+#include <wayfire/view-transform.hpp>
 #include <wayfire/output.hpp>
+#include <map>
 #include <set>
 #include <algorithm>
 
@@ -16,6 +18,7 @@
 #include "wayfire/signal-provider.hpp"
 #include "wayfire/util.hpp"
 #include <wayfire/core.hpp>
+#include <wayfire/option-wrapper.hpp>
 
 namespace wf
 {
@@ -74,9 +77,184 @@ std::string node_t::stringify_flags() const
     return "(" + fl + ")";
 }
 
+// ------------------------- find_node_at acceleration -------------------------
+namespace
+{
+/* The values of core/input_spatial_index and core/bounding_box_cache, kept
+ * up to date by the root node */
+bool use_input_index = false;
+bool use_bounding_box_cache = false;
+
+/* Set while worker threads may read the cached bounding boxes */
+bool bounding_boxes_frozen = false;
+
+/* Nodes with fewer children are simply searched linearly */
+constexpr size_t MIN_INDEXED_CHILDREN = 8;
+}
+
+/* Transformers may change the bounding box of a view at any time, for ex.
+ * during an animation, without a scenegraph update. */
+static bool has_transformers(view_node_tag_t *tag)
+{
+    auto view = tag->get_view();
+    return view && view->get_transformed_node()->has_transformers();
+}
+
+/**
+ * A uniform grid over the bounding boxes of a node's children. It is used to
+ * find the children which may contain a given point, without asking all of
+ * them. The index is rebuilt lazily after it was invalidated together with the
+ * cached bounding box of the node, see node_t::invalidate_bounding_box().
+ *
+ * Only views without transformers are indexed by their bounding box, since
+ * their input region is contained in it. Other children (for example, input
+ * grabs or nodes which want raw input) may accept input anywhere, so they are
+ * candidates everywhere.
+ */
+struct node_t::children_index_t
+{
+    static constexpr int64_t GRID_SIZE = 16;
+
+    bool valid = false;
+    wf::geometry_t extents = {0, 0, 0, 0};
+    // The indices of the candidate children in each cell, in stacking order
+    std::vector<std::vector<uint32_t>> cells;
+    // The candidates for points outside of the extents
+    std::vector<uint32_t> outside;
+    // The bounding box of each indexed child, or nullopt if it is not indexed
+    std::vector<std::optional<wf::geometry_t>> boxes;
+
+    void rebuild(const std::vector<node_ptr>& children)
+    {
+        valid = true;
+        boxes.assign(children.size(), std::nullopt);
+        outside.clear();
+        cells.assign(GRID_SIZE * GRID_SIZE, {});
+
+        int min_x = std::numeric_limits<int>::max();
+        int min_y = std::numeric_limits<int>::max();
+        int max_x = std::numeric_limits<int>::min();
+        int max_y = std::numeric_limits<int>::min();
+        for (size_t i = 0; i < children.size(); i++)
+        {
+            auto& ch = children[i];
+            auto tag = dynamic_cast<view_node_tag_t*>(ch.get());
+            if (!tag || ch->wants_raw_input() || has_transformers(tag))
+            {
+                continue;
+            }
+
+            auto box = ch->get_bounding_box();
+            boxes[i] = box;
+            if ((box.width > 0) && (box.height > 0))
+            {
+                min_x = std::min(min_x, box.x);
+                min_y = std::min(min_y, box.y);
+                max_x = std::max(max_x, box.x + box.width);
+                max_y = std::max(max_y, box.y + box.height);
+            }
+        }
+
+        extents = {0, 0, 0, 0};
+        if (min_x < max_x)
+        {
+            extents = {min_x, min_y, max_x - min_x, max_y - min_y};
+        }
+        for (uint32_t i = 0; i < children.size(); i++)
+        {
+            if (!boxes[i])
+            {
+                outside.push_back(i);
+                for (auto& cell : cells)
+                {
+                    cell.push_back(i);
+                }
+
+                continue;
+            }
+
+            auto& box = *boxes[i];
+            if ((box.width <= 0) || (box.height <= 0))
+            {
+                continue;
+            }
+
+            // The cells which contain points in [box.x, box.x + box.width)
+            const int64_t x1 = (box.x - extents.x) * GRID_SIZE / extents.width;
+            const int64_t y1 = (box.y - extents.y) * GRID_SIZE / extents.height;
+            const int64_t x2 = ((box.x + box.width - extents.x) * GRID_SIZE +
+                extents.width - 1) / extents.width - 1;
+            const int64_t y2 = ((box.y + box.height - extents.y) * GRID_SIZE +
+                extents.height - 1) / extents.height - 1;
+            for (int64_t y = y1; y <= y2; y++)
+            {
+                for (int64_t x = x1; x <= x2; x++)
+                {
+                    cells[y * GRID_SIZE + x].push_back(i);
+                }
+            }
+        }
+    }
+
+    const std::vector<uint32_t>& get_candidates(const wf::pointf_t& at) const
+    {
+        if (!(extents & at))
+        {
+            return outside;
+        }
+
+        const int64_t x = std::clamp<int64_t>(
+            (at.x - extents.x) * GRID_SIZE / extents.width, 0, GRID_SIZE - 1);
+        const int64_t y = std::clamp<int64_t>(
+            (at.y - extents.y) * GRID_SIZE / extents.height, 0, GRID_SIZE - 1);
+        return cells[y * GRID_SIZE + x];
+    }
+};
+
+std::optional<input_node_t> node_t::find_node_at_indexed(const wf::pointf_t& local)
+{
+    if (!children_index)
+    {
+        children_index = std::make_unique<children_index_t>();
+    }
+
+    if (!children_index->valid || (children_index->boxes.size() != children.size()))
+    {
+        children_index->rebuild(children);
+    }
+
+    for (auto i : children_index->get_candidates(local))
+    {
+        auto& node = children[i];
+        if (!node->is_enabled())
+        {
+            continue;
+        }
+
+        auto& box = children_index->boxes[i];
+        if (box && !(*box & local))
+        {
+            continue;
+        }
+
+        auto child_node = node->find_node_at(local);
+        if (child_node.has_value())
+        {
+            return child_node;
+        }
+    }
+
+    return {};
+}
+
 std::optional<input_node_t> node_t::find_node_at(const wf::pointf_t& at)
 {
     auto local = this->to_local(at);
+    if (use_input_index && (children.size() >= MIN_INDEXED_CHILDREN))
+    {
+        return find_node_at_indexed(local);
+    }
+
     for (auto& node : get_children())
     {
         if (!node->is_enabled())
@@ -141,6 +319,7 @@ void node_t::set_children_unchecked(std::vector<node_ptr> new_list)
     }
 
     this->children = std::move(new_list);
+    invalidate_bounding_box();
 
     data.region |= get_bounding_box();
     this->emit(&data);
@@ -236,6 +415,11 @@ class default_render_instance_t : public render_instance_t
         // from being scanned out.
         return direct_scanout::SKIP;
     }
+
+    bool can_schedule_in_parallel() override
+    {
+        return true;
+    }
 };
 
 void node_t::gen_render_instances(std::vector<render_instance_uptr> & instances,
@@ -257,8 +441,67 @@ void node_t::gen_render_instances(std::vector<render_instance_uptr> & instances,
 
 wf::geometry_t node_t::get_children_bounding_box()
 {
+    if (!use_bounding_box_cache)
+    {
+        return compute_children_bounding_box();
+    }
+
+    if (cached_children_bbox)
+    {
+        if (!bounding_boxes_frozen &&
+            wf::log::enabled_categories[(size_t)wf::log::logging_category::BBOX])
+        {
+            auto actual = compute_children_bounding_box();
+            if (actual != *cached_children_bbox)
+            {
+                LOGE("Stale cached bounding box of ", stringify(), ": cached ", *cached_children_bbox,
+                    ", actual ", actual);
+                cached_children_bbox = actual;
+            }
+        }
+
+        return *cached_children_bbox;
+    }
+
+    auto bbox = compute_children_bounding_box();
+    if (!bounding_boxes_frozen && !children_bbox_volatile)
+    {
+        cached_children_bbox = bbox;
+    }
+
+    return bbox;
+}
+
+void node_t::invalidate_bounding_box()
+{
+    // Nodes which override get_bounding_box() may not have a cache themselves,
+    // but their ancestors still depend on them, so go all the way up. The
+    // input indices of the ancestors contain the same boxes.
+    for (node_t *node = this; node; node = node->parent())
+    {
+        node->cached_children_bbox.reset();
+        if (node->children_index)
+        {
+            node->children_index->valid = false;
+        }
+    }
+}
+
+wf::geometry_t node_t::compute_children_bounding_box()
+{
+    bool is_volatile = false;
+    if (auto manager = dynamic_cast<transform_manager_node_t*>(this))
+    {
+        is_volatile = manager->has_transformers();
+    }
+
     if (children.empty())
     {
+        if (!bounding_boxes_frozen)
+        {
+            children_bbox_volatile = is_volatile;
+        }
+
         return {0, 0, 0, 0};
     }
 
@@ -270,6 +513,7 @@ wf::geometry_t node_t::get_children_bounding_box()
     for (auto& ch : children)
     {
         auto bbox = ch->get_bounding_box();
+        is_volatile |= ch->children_bbox_volatile;
 
         min_x = std::min(min_x, bbox.x);
         min_y = std::min(min_y, bbox.y);
@@ -277,6 +521,11 @@ wf::geometry_t node_t::get_children_bounding_box()
         max_y = std::max(max_y, bbox.y + bbox.height);
     }
 
+    if (!bounding_boxes_frozen)
+    {
+        children_bbox_volatile = is_volatile;
+    }
+
     return {min_x, min_y, max_x - min_x, max_y - min_y};
 }
 
@@ -324,23 +573,176 @@ class output_render_instance_t : public default_render_instance_t
     output_node_t *self;
     std::vector<render_instance_uptr> children;
 
+    wf::output_t *shown_on;
+    damage_callback child_damage;
+
+    /**
+     * The children are a concatenation of segments, one for each child of the
+     * output node, in stacking order. Children tagged with flat_instances_tag_t
+     * have a segment with only their own instance (@self_only), followed by a
+     * segment for each of their children.
+     */
+    struct segment_t
+    {
+        node_t *node;
+        bool self_only;
+        size_t count;
+    };
+
+    std::vector<segment_t> segments;
+
+    static bool is_flat(node_t *node)
+    {
+        return dynamic_cast<flat_instances_tag_t*>(node) != nullptr;
+    }
+
+    /**
+     * Lay out the segments again after the list of children of the output node
+     * or of a flat child changed. The instances of nodes which still have a
+     * segment are reused, only nodes which did not have one before get new
+     * instances.
+     */
+    void rebuild_segments()
+    {
+        std::map<std::pair<node_t*, bool>, std::vector<render_instance_uptr>> old;
+        auto it = children.begin();
+        for (auto& segment : segments)
+        {
+            auto& list = old[{segment.node, segment.self_only}];
+            list.insert(list.end(), std::make_move_iterator(it),
+                std::make_move_iterator(it + segment.count));
+            it += segment.count;
+        }
+
+        // The old instances are destroyed only after the new ones have been
+        // generated, so that surfaces which stay visible do not receive leave
+        // and enter events.
+        std::vector<render_instance_uptr> new_children;
+        std::vector<segment_t> new_segments;
+        auto add_segment = [&] (node_t *node, bool self_only)
+        {
+            const size_t start = new_children.size();
+            auto existing = old.find({node, self_only});
+            if (existing != old.end())
+            {
+                new_children.insert(new_children.end(),
+                    std::make_move_iterator(existing->second.begin()),
+                    std::make_move_iterator(existing->second.end()));
+                old.erase(existing);
+            } else if (self_only)
+            {
+                // Same as node_t::gen_render_instances()
+                new_children.push_back(std::make_unique<default_render_instance_t>(node, child_damage));
+            } else
+            {
+                node->gen_render_instances(new_children, child_damage, shown_on);
+            }
+
+            new_segments.push_back({node, self_only, new_children.size() - start});
+        };
+
+        for (auto& child : self->get_children())
+        {
+            if (!child->is_enabled())
+            {
+                continue;
+            }
+
+            if (!is_flat(child.get()))
+            {
+                add_segment(child.get(), false);
+                continue;
+            }
+
+            add_segment(child.get(), true);
+            for (auto& ch : child->get_children())
+            {
+                if (ch->is_enabled())
+                {
+                    add_segment(ch.get(), false);
+                }
+            }
+        }
+
+        children = std::move(new_children);
+        segments = std::move(new_segments);
+    }
+
+    /**
+     * Regenerate the instances of the segment of @node.
+     *
+     * @return False if @node does not have a segment.
+     */
+    bool regenerate_segment(node_t *node)
+    {
+        size_t offset = 0;
+        for (auto& segment : segments)
+        {
+            if ((segment.node != node) || segment.self_only)
+            {
+                offset += segment.count;
+                continue;
+            }
+
+            std::vector<render_instance_uptr> new_instances;
+            if (node->is_enabled())
+            {
+                node->gen_render_instances(new_instances, child_damage, shown_on);
+            }
+
+            auto it = children.begin() + offset;
+            it = children.erase(it, it + segment.count);
+            children.insert(it, std::make_move_iterator(new_instances.begin()),
+                std::make_move_iterator(new_instances.end()));
+            segment.count = new_instances.size();
+            return true;
+        }
+
+        return false;
+    }
+
   public:
     output_render_instance_t(output_node_t *self, damage_callback callback,
         wf::output_t *output, wf::output_t *shown_on) :
         default_render_instance_t(self, transform_damage(callback))
     {
-        this->self   = self;
-        this->output = output;
+        this->self     = self;
+        this->output   = output;
+        this->shown_on = shown_on;
 
         // Children are stored as a sublist, because we need to translate every
         // time between global and output-local geometry.
-        for (auto& child : self->get_children())
+        this->child_damage = transform_damage(callback);
+        rebuild_segments();
+    }
+
+    /**
+     * Update the instances after @changed_node, which is below the output
+     * node, was updated.
+     */
+    void update(node_t *changed_node)
+    {
+        if ((changed_node == self) ||
+            ((changed_node->parent() == self) && is_flat(changed_node)))
         {
-            if (child->is_enabled())
-            {
-                child->gen_render_instances(children,
-                    transform_damage(callback), shown_on);
-            }
+            // The list of children changed, or a flat child was enabled or
+            // disabled.
+            rebuild_segments();
+            return;
+        }
+
+        // Find the node which has a segment
+        node_t *node = changed_node;
+        while (node->parent() && (node->parent() != self) &&
+               !(is_flat(node->parent()) && (node->parent()->parent() == self)))
+        {
+            node = node->parent();
+        }
+
+        if (!regenerate_segment(node))
+        {
+            // For ex. a node which was just enabled
+            rebuild_segments();
         }
     }
 
@@ -417,8 +819,24 @@ class output_render_instance_t : public default_render_instance_t
         auto offset = wf::origin(output->get_layout_geometry());
         compute_visibility_from_list(children, output, visible, offset);
     }
+
+    bool can_schedule_in_parallel() override
+    {
+        return can_schedule_list_in_parallel(children);
+    }
 };
 
+bool update_output_render_instance(render_instance_t *instance, node_t *changed_node)
+{
+    if (auto output_instance = dynamic_cast<output_render_instance_t*>(instance))
+    {
+        output_instance->update(changed_node);
+        return true;
+    }
+
+    return false;
+}
+
 void output_node_t::gen_render_instances(
     std::vector<render_instance_uptr> & instances, damage_callback push_damage,
     wf::output_t *shown_on)
@@ -443,6 +861,21 @@ wf::geometry_t output_node_t::get_bounding_box()
 }
 
 // ------------------------------ root_node_t ----------------------------------
+root_node_t::priv_t::priv_t()
+{
+    use_input_index = input_spatial_index;
+    input_spatial_index.set_callback([=] ()
+    {
+        use_input_index = input_spatial_index;
+    });
+
+    use_bounding_box_cache = bounding_box_cache;
+    bounding_box_cache.set_callback([=] ()
+    {
+        use_bounding_box_cache = bounding_box_cache;
+    });
+}
+
 root_node_t::root_node_t() : floating_inner_node_t(true)
 {
     std::vector<node_ptr> children;
@@ -483,8 +916,26 @@ void set_node_enabled(wf::scene::node_ptr node, bool enabled)
     }
 }
 
+void freeze_bounding_boxes()
+{
+    // Computing the bounding box of the root fills the caches of all nodes
+    // below it.
+    wf::get_core().scene()->get_bounding_box();
+    bounding_boxes_frozen = true;
+}
+
+void thaw_bounding_boxes()
+{
+    bounding_boxes_frozen = false;
+}
+
 void update(node_ptr changed_node, uint32_t flags)
 {
+    if ((flags & update_flag::CHILDREN_LIST) || (flags & update_flag::GEOMETRY))
+    {
+        changed_node->invalidate_bounding_box();
+    }
+
     if ((flags & update_flag::CHILDREN_LIST) ||
         (flags & update_flag::ENABLED) ||
         (flags & update_flag::GEOMETRY))
@@ -492,17 +943,21 @@ void update(node_ptr changed_node, uint32_t flags)
         flags |= update_flag::INPUT_STATE;
     }
 
-    if (changed_node == wf::get_core().scene())
+    // Propagate the update up to the root. Nodes which are not part of the
+    // scenegraph (i.e. whose last ancestor is not the root) do not trigger
+    // any updates.
+    node_t *node = changed_node.get();
+    while (node->parent())
     {
-        root_node_update_signal data;
-        data.flags = flags;
-        wf::get_core().scene()->emit(&data);
-        return;
+        node = node->parent();
     }
 
-    if (changed_node->parent())
+    if (node == wf::get_core().scene().get())
     {
-        update(changed_node->parent()->shared_from_this(), flags);
+        root_node_update_signal data;
+        data.flags = flags;
+        data.changed_node = changed_node;
+        wf::get_core().scene()->emit(&data);
     }
 }
 } // namespace scene
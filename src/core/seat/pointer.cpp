@@ -34,6 +34,23 @@ wf::pointer_t::pointer_t(nonstd::observer_ptr<wf::input_manager_t> input,
     };
 
     wf::get_core().scene()->connect(&on_root_node_updated);
+
+    on_output_frame = [=] (wf::frame_done_signal*)
+    {
+        if (motion_pending)
+        {
+            flush_motion();
+            wlr_seat_pointer_notify_frame(seat->seat);
+        }
+    };
+
+    update_motion_coalescing();
+    motion_coalescing_opt.set_callback([=] ()
+    {
+        // A pending motion may not be flushed in the new mode
+        flush_motion();
+        update_motion_coalescing();
+    });
 }
 
 wf::pointer_t::~pointer_t()
@@ -207,6 +224,8 @@ void wf::pointer_t::grab_surface(wf::scene::node_ptr node)
 void wf::pointer_t::handle_pointer_button(wlr_pointer_button_event *ev,
     input_event_processing_mode_t mode)
 {
+    // Buttons should be sent to the node under the cursor's latest position
+    flush_motion();
     seat->priv->break_mod_bindings();
     bool handled_in_binding = (mode != input_event_processing_mode_t::FULL);
 
@@ -301,12 +320,88 @@ void wf::pointer_t::send_motion(uint32_t time_msec)
     }
 }
 
+bool wf::pointer_t::focused_client_has_relative_pointer() const
+{
+    auto focused = seat->seat->pointer_state.focused_client;
+    if (!focused)
+    {
+        return false;
+    }
+
+    wlr_relative_pointer_v1 *relative_pointer;
+    wl_list_for_each(relative_pointer,
+        &wf::get_core().protocols.relative_pointer->relative_pointers, link)
+    {
+        if (wl_resource_get_client(relative_pointer->resource) == focused->client)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void wf::pointer_t::update_motion_coalescing()
+{
+    const std::string mode = motion_coalescing_opt;
+    if (mode == "frame")
+    {
+        motion_coalescing = motion_coalescing_t::FRAME;
+    } else if (mode == "output")
+    {
+        motion_coalescing = motion_coalescing_t::OUTPUT;
+    } else
+    {
+        motion_coalescing = motion_coalescing_t::NONE;
+    }
+}
+
+void wf::pointer_t::handle_motion(uint32_t time_msec)
+{
+    // Games and similar clients get every event as it arrives.
+    if ((motion_coalescing == motion_coalescing_t::NONE) || focused_client_has_relative_pointer())
+    {
+        flush_motion();
+        update_cursor_position(time_msec);
+        return;
+    }
+
+    motion_pending = true;
+    pending_motion_time = time_msec;
+    if ((motion_coalescing == motion_coalescing_t::OUTPUT) && !on_output_frame.is_connected())
+    {
+        auto cursor = seat->priv->cursor->cursor;
+        auto wo = wf::get_core().output_layout->get_output_at(cursor->x, cursor->y);
+        if (wo)
+        {
+            wo->connect(&on_output_frame);
+            // Make sure a frame comes even if nothing on the output is damaged.
+            wo->render->schedule_redraw();
+        } else
+        {
+            flush_motion();
+        }
+    }
+}
+
+void wf::pointer_t::flush_motion()
+{
+    if (!motion_pending)
+    {
+        return;
+    }
+
+    motion_pending = false;
+    on_output_frame.disconnect();
+    update_cursor_position(pending_motion_time);
+}
+
 void wf::pointer_t::handle_pointer_motion(wlr_pointer_motion_event *ev,
     input_event_processing_mode_t mode)
 {
     /* XXX: maybe warp directly? */
     wlr_cursor_move(seat->priv->cursor->cursor, &ev->pointer->base, ev->delta_x, ev->delta_y);
-    update_cursor_position(ev->time_msec);
+    handle_motion(ev->time_msec);
 }
 
 void wf::pointer_t::handle_pointer_motion_absolute(
@@ -326,12 +421,14 @@ void wf::pointer_t::handle_pointer_motion_absolute(
 
     // TODO: indirection via wf_cursor
     wlr_cursor_warp_closest(seat->priv->cursor->cursor, NULL, cx, cy);
-    update_cursor_position(ev->time_msec);
+    handle_motion(ev->time_msec);
 }
 
 void wf::pointer_t::handle_pointer_axis(wlr_pointer_axis_event *ev,
     input_event_processing_mode_t mode)
 {
+    flush_motion();
+
     bool handled_in_binding = wf::get_core().bindings->handle_axis(
         seat->priv->get_modifiers(), ev);
     seat->priv->break_mod_bindings();
@@ -423,5 +520,16 @@ void wf::pointer_t::handle_pointer_hold_end(wlr_pointer_hold_end_event *ev,
 
 void wf::pointer_t::handle_pointer_frame()
 {
+    if (motion_coalescing == motion_coalescing_t::FRAME)
+    {
+        flush_motion();
+    }
+
+    if (motion_pending)
+    {
+        // The frame is sent together with the motion in the next output frame.
+        return;
+    }
+
     wlr_seat_pointer_notify_frame(seat->seat);
 }
@@ -7,6 +7,7 @@
 #include <wayfire/util.hpp>
 #include <wayfire/option-wrapper.hpp>
 #include "wayfire/scene-input.hpp"
+#include "wayfire/render-manager.hpp"
 #include "wayfire/signal-definitions.hpp"
 #include "wayfire/signal-provider.hpp"
 #include <wayfire/nonstd/wlroots-full.hpp>
@@ -139,6 +140,36 @@ class pointer_t
      * Send synthetic button release events to the current cursor focus.
      */
     void force_release_buttons();
+
+    /**
+     * Whether a motion event has been received, but the focus has not been
+     * updated and no motion has been sent to the focus yet.
+     * See input/pointer_motion_coalescing.
+     */
+    bool motion_pending = false;
+    uint32_t pending_motion_time = 0;
+    wf::signal::connection_t<wf::frame_done_signal> on_output_frame;
+
+    enum class motion_coalescing_t
+    {
+        NONE,
+        FRAME,
+        OUTPUT,
+    };
+
+    wf::option_wrapper_t<std::string> motion_coalescing_opt{"input/pointer_motion_coalescing"};
+    /** The parsed value of motion_coalescing_opt */
+    motion_coalescing_t motion_coalescing = motion_coalescing_t::NONE;
+    void update_motion_coalescing();
+
+    /** Update the focus and send motion after the cursor has moved, or defer it. */
+    void handle_motion(uint32_t time_msec);
+
+    /** Send the pending motion, if any. */
+    void flush_motion();
+
+    /** Whether the focused client uses the relative-pointer protocol. */
+    bool focused_client_has_relative_pointer() const;
 };
 }
 
@@ -0,0 +1,134 @@
+#include <wayfire/txn/client-latency.hpp>
+#include <wayfire/debug.hpp>
+#include <wayland-server-core.h>
+#include <unordered_map>
+#include <memory>
+#include <cstdlib>
+#include <algorithm>
+
+namespace
+{
+/**
+ * Clients need to respond to this many configures before we trust the estimate.
+ */
+constexpr uint64_t MIN_SAMPLES = 4;
+
+/**
+ * Never wait less than this many milliseconds, even for very responsive clients, so that scheduling jitter
+ * does not cause spurious timeouts.
+ */
+constexpr uint64_t MIN_TIMEOUT = 10;
+
+struct client_entry_t
+{
+    wf::txn::client_latency_t stats;
+    wl_listener on_destroy;
+};
+
+std::unordered_map<wl_client*, std::unique_ptr<client_entry_t>>& get_clients()
+{
+    static std::unordered_map<wl_client*, std::unique_ptr<client_entry_t>> clients;
+    return clients;
+}
+
+void handle_client_destroy(wl_listener *listener, void*)
+{
+    client_entry_t *entry = wl_container_of(listener, entry, on_destroy);
+    wl_list_remove(&entry->on_destroy.link);
+    get_clients().erase(entry->stats.client);
+}
+}
+
+void wf::txn::record_client_latency(wl_client *client, int64_t latency)
+{
+    if (!client || (latency < 0))
+    {
+        return;
+    }
+
+    auto& entry = get_clients()[client];
+    if (!entry)
+    {
+        entry = std::make_unique<client_entry_t>();
+        entry->stats.client = client;
+        entry->on_destroy.notify = handle_client_destroy;
+        wl_client_add_destroy_listener(client, &entry->on_destroy);
+    }
+
+    // Same smoothing as the TCP retransmission timer (RFC 6298): the average and the deviation follow new
+    // samples with gains of 1/8 and 1/4 respectively.
+    auto& stats = entry->stats;
+    if (stats.samples == 0)
+    {
+        stats.average   = latency;
+        stats.deviation = latency / 2;
+    } else
+    {
+        const int64_t error = latency - stats.average;
+        stats.average   += error / 8;
+        stats.deviation += (std::abs(error) - stats.deviation) / 4;
+    }
+
+    stats.max = std::max(stats.max, latency);
+    stats.samples++;
+    LOGC(TXNI, "Client ", client, " configure latency ", latency, "us, average ", stats.average,
+        "us, deviation ", stats.deviation, "us");
+}
+
+std::optional<wf::txn::client_latency_t> wf::txn::get_client_latency(wl_client *client)
+{
+    auto it = get_clients().find(client);
+    if (it == get_clients().end())
+    {
+        return {};
+    }
+
+    return it->second->stats;
+}
+
+std::vector<wf::txn::client_latency_t> wf::txn::get_all_client_latencies()
+{
+    std::vector<client_latency_t> result;
+    for (auto& [client, entry] : get_clients())
+    {
+        result.push_back(entry->stats);
+    }
+
+    return result;
+}
+
+std::optional<uint64_t> wf::txn::get_client_timeout(wl_client *client)
+{
+    auto stats = get_client_latency(client);
+    if (!stats || (stats->samples < MIN_SAMPLES))
+    {
+        return {};
+    }
+
+    const int64_t timeout_us = stats->average + 4 * stats->deviation;
+    return std::max<uint64_t>(MIN_TIMEOUT, (timeout_us + 999) / 1000);
+}
+
+uint64_t wf::txn::get_adaptive_timeout(const std::vector<transaction_object_sptr>& objects,
+    uint64_t max_timeout)
+{
+    if (objects.empty())
+    {
+        return max_timeout;
+    }
+
+    uint64_t timeout = 0;
+    for (auto& obj : objects)
+    {
+        auto client_timeout = get_client_timeout(obj->get_client());
+        if (!client_timeout)
+        {
+            // We know nothing about this object, so be conservative.
+            return max_timeout;
+        }
+
+        timeout = std::max(timeout, *client_timeout);
+    }
+
+    return std::min(timeout, max_timeout);
+}
@@ -2,19 +2,12 @@
 #include "wayfire/txn/transaction.hpp"
 #include <algorithm>
 #include <iterator>
+#include <unordered_map>
+#include <unordered_set>
 #include <wayfire/txn/transaction-manager.hpp>
 #include <wayfire/debug.hpp>
-
-static bool transactions_intersect(const wf::txn::transaction_uptr& a, const wf::txn::transaction_uptr& b)
-{
-    const auto& obj_a = a->get_objects();
-    const auto& obj_b = b->get_objects();
-
-    return std::any_of(obj_a.begin(), obj_a.end(), [&] (const wf::txn::transaction_object_sptr& x)
-    {
-        return std::find(obj_b.begin(), obj_b.end(), x) != obj_b.end();
-    });
-}
+#include <wayfire/option-wrapper.hpp>
+#include <wayfire/txn/client-latency.hpp>
 
 struct wf::txn::transaction_manager_t::impl
 {
@@ -28,45 +21,132 @@ struct wf::txn::transaction_manager_t::impl
         LOGC(TXN, "Scheduling transaction ", tx.get());
 
         // Step 1: add any objects which are directly or indirectly connected to the objects in tx
-        coalesce_transactions(tx);
+        auto merged = coalesce_transactions(tx);
 
         // Step 2: remove any transactions we don't need anymore, as their objects were added to tx
-        remove_conflicts(tx);
+        remove_conflicts(merged);
+
+        // Step 3: optionally move the objects of slow clients to a separate transaction, so that they do not
+        // hold back the rest of the objects.
+        auto slow = split_slow_clients(tx);
+
+        // Step 4: schedule tx for execution. At this point, there are no conflicts in all pending txs
+        add_pending(std::move(tx));
+        if (slow)
+        {
+            add_pending(std::move(slow));
+        }
 
-        // Step 3: schedule tx for execution. At this point, there are no conflicts in all pending txs
-        pending.push_back(std::move(tx));
         consider_commit();
     }
 
-    void coalesce_transactions(const transaction_uptr& tx)
+    void add_pending(transaction_uptr tx)
     {
-        while (true)
+        for (auto& obj : tx->get_objects())
         {
-            const size_t start_size = tx->get_objects().size();
-            for (auto& existing : pending)
+            pending_index[obj.get()] = tx.get();
+        }
+
+        pending.push_back(std::move(tx));
+    }
+
+    static bool is_slow_client(wl_client *client)
+    {
+        static wf::option_wrapper_t<int> slow_client_threshold{"core/slow_client_threshold"};
+        if (slow_client_threshold <= 0)
+        {
+            return false;
+        }
+
+        auto timeout = get_client_timeout(client);
+        return timeout && (*timeout > (uint64_t)(int)slow_client_threshold);
+    }
+
+    /**
+     * Move the objects of clients which are known to respond slowly from tx to a new transaction.
+     *
+     * @return The new transaction, or nullptr if tx does not have both slow and other objects.
+     */
+    transaction_uptr split_slow_clients(const transaction_uptr& tx)
+    {
+        std::vector<transaction_object_sptr> slow_objects;
+        std::unordered_map<wl_client*, bool> slow_clients;
+        for (auto& obj : tx->get_objects())
+        {
+            auto client = obj->get_client();
+            if (!client)
             {
-                if (transactions_intersect(existing, tx))
-                {
-                    for (auto& obj : existing->get_objects())
-                    {
-                        tx->add_object(obj);
-                    }
-                }
+                continue;
+            }
+
+            auto it = slow_clients.find(client);
+            if (it == slow_clients.end())
+            {
+                it = slow_clients.emplace(client, is_slow_client(client)).first;
             }
 
-            if (start_size == tx->get_objects().size())
+            if (it->second)
             {
-                // No new objects were added in the last iteration => done
-                break;
+                slow_objects.push_back(obj);
             }
         }
+
+        if (slow_objects.empty() || (slow_objects.size() == tx->get_objects().size()))
+        {
+            return nullptr;
+        }
+
+        // The objects keep the timeout they were scheduled with
+        auto slow = tx->create_sibling();
+        for (auto& obj : slow_objects)
+        {
+            tx->remove_object(obj.get());
+            slow->add_object(obj);
+        }
+
+        LOGC(TXN, "Split ", slow_objects.size(), " objects of slow clients from ", tx.get(),
+            " to ", slow.get());
+        return slow;
     }
 
-    void remove_conflicts(const transaction_uptr& tx)
+    /**
+     * Add the objects of all pending transactions which intersect tx to tx.
+     *
+     * Pending transactions never share objects, so the objects added from one
+     * transaction cannot connect tx to another pending transaction. Thus, a
+     * single lookup per object is enough.
+     *
+     * @return The pending transactions which were merged into tx.
+     */
+    std::unordered_set<transaction_t*> coalesce_transactions(const transaction_uptr& tx)
     {
+        std::unordered_set<transaction_t*> merged;
+        const size_t nr_objects = tx->get_objects().size();
+        for (size_t i = 0; i < nr_objects; i++)
+        {
+            auto it = pending_index.find(tx->get_objects()[i].get());
+            if ((it != pending_index.end()) && merged.insert(it->second).second)
+            {
+                for (auto& obj : it->second->get_objects())
+                {
+                    tx->add_object(obj);
+                }
+            }
+        }
+
+        return merged;
+    }
+
+    void remove_conflicts(const std::unordered_set<transaction_t*>& merged)
+    {
+        if (merged.empty())
+        {
+            return;
+        }
+
         auto it = std::remove_if(pending.begin(), pending.end(), [&] (const transaction_uptr& existing)
         {
-            return transactions_intersect(existing, tx);
+            return merged.count(existing.get());
         });
         pending.erase(it, pending.end());
     }
@@ -96,14 +176,21 @@ struct wf::txn::transaction_manager_t::impl
 
     bool can_commit_transaction(const transaction_uptr& tx)
     {
-        return std::none_of(committed.begin(), committed.end(), [&] (const transaction_uptr& comm)
+        const auto& objects = tx->get_objects();
+        return std::none_of(objects.begin(), objects.end(), [&] (const transaction_object_sptr& obj)
         {
-            return transactions_intersect(tx, comm);
+            return committed_index.count(obj.get());
         });
     }
 
     void do_commit(transaction_uptr tx)
     {
+        for (auto& obj : tx->get_objects())
+        {
+            pending_index.erase(obj.get());
+            committed_index[obj.get()] = tx.get();
+        }
+
         tx->connect(&on_tx_apply);
         committed.push_back(std::move(tx));
         // Note: this might immediately trigger tx_apply if all objects are already ready!
@@ -115,6 +202,10 @@ struct wf::txn::transaction_manager_t::impl
     std::vector<transaction_uptr> pending;
     wf::wl_idle_call idle_clear_done;
 
+    // The transaction each object is part of. Neither pending nor committed transactions share objects.
+    std::unordered_map<transaction_object_t*, transaction_t*> pending_index;
+    std::unordered_map<transaction_object_t*, transaction_t*> committed_index;
+
     wf::signal::connection_t<transaction_applied_signal> on_tx_apply = [&] (transaction_applied_signal *ev)
     {
         // Move transactions which are done from committed to done.
@@ -124,6 +215,11 @@ struct wf::txn::transaction_manager_t::impl
             return existing.get() == ev->self;
         });
 
+        for (auto& obj : ev->self->get_objects())
+        {
+            committed_index.erase(obj.get());
+        }
+
         done.push_back(std::move(*it));
         committed.erase(it);
         consider_commit();
@@ -1,6 +1,8 @@
 #include "wayfire/option-wrapper.hpp"
 #include "wayfire/txn/transaction-object.hpp"
 #include <wayfire/txn/transaction.hpp>
+#include <wayfire/txn/client-latency.hpp>
+#include <algorithm>
 #include <sstream>
 #include <wayfire/debug.hpp>
 
@@ -37,14 +39,26 @@ const std::vector<wf::txn::transaction_object_sptr>& wf::txn::transaction_t::get
 
 void wf::txn::transaction_t::add_object(transaction_object_sptr object)
 {
-    auto it = std::find(objects.begin(), objects.end(), object);
-    if (it == objects.end())
+    if (object_set.insert(object.get()).second)
     {
         LOGC(TXNI, "Transaction ", this, " add object ", object->stringify());
         objects.push_back(object);
     }
 }
 
+void wf::txn::transaction_t::remove_object(transaction_object_t *object)
+{
+    if (object_set.erase(object))
+    {
+        LOGC(TXNI, "Transaction ", this, " remove object ", object->stringify());
+        auto it = std::find_if(objects.begin(), objects.end(), [&] (const transaction_object_sptr& obj)
+        {
+            return obj.get() == object;
+        });
+        objects.erase(it);
+    }
+}
+
 void wf::txn::transaction_t::commit()
 {
     LOGC(TXN, "Committing transaction ", this, " with timeout ", this->timeout);
@@ -77,21 +91,45 @@ void wf::txn::transaction_t::apply(bool did_timeout)
     this->emit(&ev);
 }
 
+std::unique_ptr<wf::txn::transaction_t> wf::txn::transaction_t::create_sibling() const
+{
+    return std::make_unique<transaction_t>(timeout, timer_setter);
+}
+
 /**
  * A transaction which uses wl_timer for timeouts.
+ *
+ * If the timeout was picked by core and adaptive timeouts are enabled, the timeout is lowered to what the
+ * clients of the transaction objects usually need to respond, so that a single slow client can hold back
+ * the transaction only as long as it is expected to.
  */
 class wayfire_default_transaction_t : public wf::txn::transaction_t
 {
   public:
-    wayfire_default_transaction_t(int64_t timeout) : transaction_t(timeout, get_timer_setter())
+    wayfire_default_transaction_t(int64_t timeout, bool adaptive) :
+        transaction_t(timeout, get_timer_setter()), max_timeout(timeout), adaptive(adaptive)
     {}
 
+    std::unique_ptr<transaction_t> create_sibling() const override
+    {
+        // Each transaction needs its own timer
+        return std::make_unique<wayfire_default_transaction_t>(max_timeout, adaptive);
+    }
+
   private:
+    int64_t max_timeout;
+    bool adaptive;
     wf::wl_timer<false> timer;
     timer_setter_t get_timer_setter()
     {
         return [this] (uint64_t timeout, wf::wl_timer<false>::callback_t cb)
         {
+            if (adaptive)
+            {
+                timeout = wf::txn::get_adaptive_timeout(get_objects(), timeout);
+                LOGC(TXN, "Transaction ", this, " adaptive timeout ", timeout);
+            }
+
             timer.set_timeout(timeout, cb);
         };
     }
@@ -99,11 +137,14 @@ class wayfire_default_transaction_t : public wf::txn::transaction_t
 
 std::unique_ptr<wf::txn::transaction_t> wf::txn::transaction_t::create(int64_t timeout)
 {
+    bool adaptive = false;
     if (timeout == -1)
     {
         static wf::option_wrapper_t<int> tx_timeout{"core/transaction_timeout"};
-        timeout = tx_timeout;
+        static wf::option_wrapper_t<bool> adaptive_timeout{"core/adaptive_transaction_timeout"};
+        timeout  = tx_timeout;
+        adaptive = adaptive_timeout;
     }
 
-    return std::make_unique<wayfire_default_transaction_t>(timeout);
+    return std::make_unique<wayfire_default_transaction_t>(timeout, adaptive);
 }
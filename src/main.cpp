@@ -211,6 +211,10 @@ void parse_extended_debugging(const std::vector<std::string>& categories)
         {
             LOGD("Enabling extended debugging for keyboard events");
             wf::log::enabled_categories.set((size_t)wf::log::logging_category::KBD, 1);
+        } else if (cat == "bbox")
+        {
+            LOGD("Enabling verification of cached bounding boxes");
+            wf::log::enabled_categories.set((size_t)wf::log::logging_category::BBOX, 1);
         } else
         {
             LOGE("Unrecognized debugging category \"", cat, "\"");
@@ -0,0 +1,204 @@
+#include "gpu-profiler.hpp"
+#include "wayfire/scene.hpp"
+#include <wayfire/util/log.hpp>
+#include <algorithm>
+#include <typeinfo>
+
+// From GL_EXT_disjoint_timer_query
+#ifndef GL_TIME_ELAPSED_EXT
+    #define GL_TIME_ELAPSED_EXT 0x88BF
+#endif
+
+#ifndef GL_GPU_DISJOINT_EXT
+    #define GL_GPU_DISJOINT_EXT 0x8FBB
+#endif
+
+namespace wf
+{
+namespace scene
+{
+gpu_profiler_t& gpu_profiler_t::get()
+{
+    static gpu_profiler_t profiler;
+    return profiler;
+}
+
+bool gpu_profiler_t::check_support()
+{
+    if (!supported.has_value())
+    {
+        auto extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+        supported = extensions &&
+            std::string(extensions).find("GL_EXT_disjoint_timer_query") != std::string::npos;
+    }
+
+    return supported.value();
+}
+
+bool gpu_profiler_t::set_enabled(bool enabled)
+{
+    if (enabled == this->enabled)
+    {
+        return enabled;
+    }
+
+    OpenGL::render_begin();
+    if (enabled && !check_support())
+    {
+        LOGE("GPU profiling requires GL_EXT_disjoint_timer_query, which is not supported!");
+    } else
+    {
+        this->enabled = enabled;
+    }
+
+    if (!this->enabled)
+    {
+        free_queries();
+    }
+
+    OpenGL::render_end();
+    return this->enabled;
+}
+
+void gpu_profiler_t::free_queries()
+{
+    for (auto& query : pending)
+    {
+        GL_CALL(glDeleteQueries(1, &query.query));
+    }
+
+    if (!free_list.empty())
+    {
+        GL_CALL(glDeleteQueries(free_list.size(), free_list.data()));
+    }
+
+    pending.clear();
+    free_list.clear();
+}
+
+bool gpu_profiler_t::begin_instruction(const render_instruction_t& instruction)
+{
+    if (!enabled || query_active || (pending.size() >= MAX_PENDING_QUERIES))
+    {
+        return false;
+    }
+
+    pending_query_t query;
+    if (auto node = instruction.instance->get_node())
+    {
+        query.name = node->stringify();
+    } else
+    {
+        query.name = typeid(*instruction.instance).name();
+    }
+
+    OpenGL::render_begin();
+    if (free_list.empty())
+    {
+        GL_CALL(glGenQueries(1, &query.query));
+    } else
+    {
+        query.query = free_list.back();
+        free_list.pop_back();
+    }
+
+    GL_CALL(glBeginQuery(GL_TIME_ELAPSED_EXT, query.query));
+    OpenGL::render_end();
+
+    pending.push_back(std::move(query));
+    query_active = true;
+    return true;
+}
+
+void gpu_profiler_t::end_instruction()
+{
+    OpenGL::render_begin();
+    GL_CALL(glEndQuery(GL_TIME_ELAPSED_EXT));
+    OpenGL::render_end();
+    query_active = false;
+}
+
+void gpu_profiler_t::collect()
+{
+    if (pending.empty() || query_active)
+    {
+        return;
+    }
+
+    OpenGL::render_begin();
+
+    // If a disjoint operation occurred (for example, a GPU reset or frequency
+    // change), the results of the queries which are currently in flight are
+    // meaningless.
+    GLint disjoint = 0;
+    GL_CALL(glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint));
+
+    while (!pending.empty())
+    {
+        auto& query = pending.front();
+
+        GLuint available = 0;
+        GL_CALL(glGetQueryObjectuiv(query.query, GL_QUERY_RESULT_AVAILABLE, &available));
+        if (!available)
+        {
+            // Queries finish in order, so no need to look further.
+            break;
+        }
+
+        GLuint elapsed_ns = 0;
+        GL_CALL(glGetQueryObjectuiv(query.query, GL_QUERY_RESULT, &elapsed_ns));
+        if (!disjoint)
+        {
+            auto& entry = timings[query.name];
+            entry.name = query.name;
+            entry.samples++;
+            entry.total_ns += elapsed_ns;
+            entry.last_ns   = elapsed_ns;
+            entry.max_ns    = std::max<uint64_t>(entry.max_ns, elapsed_ns);
+        }
+
+        free_list.push_back(query.query);
+        pending.pop_front();
+    }
+
+    OpenGL::render_end();
+}
+
+std::vector<node_gpu_timings_t> gpu_profiler_t::get_timings() const
+{
+    std::vector<node_gpu_timings_t> result;
+    result.reserve(timings.size());
+    for (auto& [name, entry] : timings)
+    {
+        result.push_back(entry);
+    }
+
+    std::sort(result.begin(), result.end(), [] (const auto& a, const auto& b)
+    {
+        return a.total_ns > b.total_ns;
+    });
+
+    return result;
+}
+
+void gpu_profiler_t::reset()
+{
+    timings.clear();
+}
+
+bool set_gpu_profiling(bool enabled)
+{
+    return gpu_profiler_t::get().set_enabled(enabled);
+}
+
+std::vector<node_gpu_timings_t> get_gpu_timings()
+{
+    return gpu_profiler_t::get().get_timings();
+}
+
+void reset_gpu_timings()
+{
+    gpu_profiler_t::get().reset();
+}
+}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <wayfire/scene-render.hpp>
+#include <deque>
+#include <optional>
+#include <map>
+
+namespace wf
+{
+namespace scene
+{
+/**
+ * The GPU profiler measures the GPU time needed for each render instruction
+ * in a render pass with GL timer queries.
+ *
+ * Queries are read back asynchronously at the start of later render passes,
+ * so that the CPU never has to wait for the GPU to finish. Only one timer
+ * query can be active at a time, therefore instructions of nested render
+ * passes are not measured separately, but are included in the time of the
+ * instruction which started the nested render pass.
+ */
+class gpu_profiler_t
+{
+  public:
+    static gpu_profiler_t& get();
+
+    /**
+     * Enable or disable profiling.
+     * @return Whether profiling is enabled after the call.
+     */
+    bool set_enabled(bool enabled);
+
+    /**
+     * Start measuring the given instruction.
+     *
+     * @return True if a measurement was started. In this case, end_instruction()
+     *   has to be called after rendering the instruction.
+     */
+    bool begin_instruction(const render_instruction_t& instruction);
+
+    /**
+     * Stop measuring the current instruction.
+     */
+    void end_instruction();
+
+    /**
+     * Read back the results of all finished queries.
+     */
+    void collect();
+
+    std::vector<node_gpu_timings_t> get_timings() const;
+    void reset();
+
+  private:
+    gpu_profiler_t() = default;
+
+    bool check_support();
+    void free_queries();
+
+    // Avoid leaking queries if the driver never reports results as available.
+    static constexpr size_t MAX_PENDING_QUERIES = 4096;
+
+    bool enabled = false;
+    bool query_active = false;
+    std::optional<bool> supported;
+
+    struct pending_query_t
+    {
+        GLuint query;
+        std::string name;
+    };
+
+    std::deque<pending_query_t> pending;
+    std::vector<GLuint> free_list;
+    std::map<std::string, node_gpu_timings_t> timings;
+};
+}
+}
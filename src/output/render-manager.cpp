@@ -15,8 +15,13 @@
 #include "wayfire/util.hpp"
 #include "wayfire/workspace-set.hpp"
 #include "../core/opengl-priv.hpp"
+#include "../core/scene-priv.hpp"
 #include "../main.hpp"
+#include "gpu-profiler.hpp"
+#include "worker-pool.hpp"
 #include <algorithm>
+#include <array>
+#include <cmath>
 #include <wayfire/nonstd/reverse.hpp>
 #include <wayfire/nonstd/safe-list.hpp>
 #include <wayfire/util/log.hpp>
@@ -32,6 +37,34 @@ struct output_damage_t
     signal::connection_t<scene::root_node_update_signal> root_update;
     std::vector<scene::render_instance_uptr> render_instances;
 
+    /**
+     * Render instances are generated separately for each top-level node, that
+     * is, each child of a layer node (and each child of the root node which is
+     * not a layer). Thus, render_instances is a concatenation of segments, one
+     * for each top-level node, in stacking order.
+     *
+     * An update which affects only a single top-level node requires only the
+     * node's segment to be regenerated. Top-level nodes are typically output
+     * nodes, whose render instance in turn regenerates only the instances of
+     * the affected view (see update_output_render_instance()).
+     */
+    struct instance_segment_t
+    {
+        scene::node_t *node;
+        size_t count;
+    };
+
+    std::vector<instance_segment_t> segments;
+    scene::damage_callback push_damage;
+
+    // The root and layer nodes do not get render instances, so we need to
+    // track their damage directly.
+    signal::connection_t<scene::node_damage_signal> on_structure_damage =
+        [=] (scene::node_damage_signal *ev)
+    {
+        push_damage(ev->region);
+    };
+
     wf::wl_listener_wrapper on_damage_destroy;
 
     wf::region_t frame_damage;
@@ -39,7 +72,138 @@ struct output_damage_t
     wlr_output_damage *damage_manager;
     output_t *wo;
 
-    void update_scenegraph(uint32_t update_mask)
+    static bool is_layer_node(scene::node_t *node)
+    {
+        auto root = wf::get_core().scene();
+        for (auto& layer : root->layers)
+        {
+            if (layer.get() == node)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void add_segment(scene::node_t *node)
+    {
+        const size_t start = render_instances.size();
+        if (node->is_enabled())
+        {
+            node->gen_render_instances(render_instances, push_damage, wo);
+        }
+
+        segments.push_back({node, render_instances.size() - start});
+    }
+
+    void regenerate_all_instances()
+    {
+        auto root = wf::get_core().scene();
+
+        render_instances.clear();
+        segments.clear();
+        on_structure_damage.disconnect();
+        root->connect(&on_structure_damage);
+
+        for (auto& child : root->get_children())
+        {
+            if (!is_layer_node(child.get()))
+            {
+                add_segment(child.get());
+                continue;
+            }
+
+            if (child->is_enabled())
+            {
+                child->connect(&on_structure_damage);
+                for (auto& top_level : child->get_children())
+                {
+                    add_segment(top_level.get());
+                }
+            }
+        }
+    }
+
+    /**
+     * Regenerate the render instances of the given top-level node, after
+     * @changed_node below it was updated.
+     *
+     * @return False if the node does not have a segment.
+     */
+    bool regenerate_segment(scene::node_t *node, scene::node_t *changed_node)
+    {
+        size_t offset = 0;
+        for (auto& segment : segments)
+        {
+            if (segment.node != node)
+            {
+                offset += segment.count;
+                continue;
+            }
+
+            if ((changed_node != node) && (segment.count == 1) &&
+                scene::update_output_render_instance(render_instances[offset].get(), changed_node))
+            {
+                return true;
+            }
+
+            // Generate the new instances before destroying the old ones, so that
+            // surfaces which stay visible do not receive leave and enter events.
+            std::vector<scene::render_instance_uptr> new_instances;
+            if (node->is_enabled())
+            {
+                node->gen_render_instances(new_instances, push_damage, wo);
+            }
+
+            auto it = render_instances.begin() + offset;
+            it = render_instances.erase(it, it + segment.count);
+            render_instances.insert(it, std::make_move_iterator(new_instances.begin()),
+                std::make_move_iterator(new_instances.end()));
+            segment.count = new_instances.size();
+            return true;
+        }
+
+        return false;
+    }
+
+    /**
+     * Update the render instances after @changed_node was updated.
+     */
+    void update_instances(scene::node_t *changed_node)
+    {
+        ++damage_serial;
+        auto root = wf::get_core().scene().get();
+        if (!changed_node || (changed_node == root) || is_layer_node(changed_node))
+        {
+            regenerate_all_instances();
+            return;
+        }
+
+        // Find the top-level node which contains the changed node.
+        scene::node_t *top_level = changed_node;
+        while (top_level->parent() && (top_level->parent() != root) &&
+               !is_layer_node(top_level->parent()))
+        {
+            top_level = top_level->parent();
+        }
+
+        if (regenerate_segment(top_level, changed_node))
+        {
+            return;
+        }
+
+        if (top_level->parent() && is_layer_node(top_level->parent()) &&
+            !top_level->parent()->is_enabled())
+        {
+            // Node in a disabled layer, it is not visible anyway.
+            return;
+        }
+
+        regenerate_all_instances();
+    }
+
+    void update_scenegraph(uint32_t update_mask, scene::node_t *changed_node)
     {
         constexpr uint32_t recompute_instances_on = scene::update_flag::CHILDREN_LIST |
             scene::update_flag::ENABLED;
@@ -47,17 +211,7 @@ struct output_damage_t
 
         if (update_mask & recompute_instances_on)
         {
-            auto root = wf::get_core().scene();
-            scene::damage_callback push_damage = [=] (wf::region_t region)
-            {
-                // Damage is pushed up to the root in root coordinate system,
-                // we need it in layout-local coordinate system.
-                region += -wf::origin(wo->get_layout_geometry());
-                this->damage(region);
-            };
-
-            render_instances.clear();
-            root->gen_render_instances(render_instances, push_damage, wo);
+            update_instances(changed_node);
         }
 
         if (update_mask & recompute_visibility_on)
@@ -80,14 +234,22 @@ struct output_damage_t
         on_damage_destroy.set_callback([=] (void*) { damage_manager = nullptr; });
         on_damage_destroy.connect(&damage_manager->events.destroy);
 
+        push_damage = [=] (wf::region_t region)
+        {
+            // Damage is pushed up to the root in root coordinate system,
+            // we need it in layout-local coordinate system.
+            region += -wf::origin(wo->get_layout_geometry());
+            this->damage(region);
+        };
+
         auto root = wf::get_core().scene();
         root_update = [=] (scene::root_node_update_signal *data)
         {
-            update_scenegraph(data->flags);
+            update_scenegraph(data->flags, data->changed_node.get());
         };
 
         root->connect<scene::root_node_update_signal>(&root_update);
-        update_scenegraph(scene::update_flag::CHILDREN_LIST);
+        update_scenegraph(scene::update_flag::CHILDREN_LIST, nullptr);
     }
 
     /**
@@ -103,6 +265,7 @@ struct output_damage_t
         /* Wlroots expects damage after scaling */
         auto scaled_region = region * wo->handle->scale;
         frame_damage |= scaled_region;
+        ++damage_serial;
         wlr_output_damage_add(damage_manager, scaled_region.to_pixman());
     }
 
@@ -116,11 +279,25 @@ struct output_damage_t
         /* Wlroots expects damage after scaling */
         auto scaled_box = box * wo->handle->scale;
         frame_damage |= scaled_box;
+        ++damage_serial;
         wlr_output_damage_add_box(damage_manager, &scaled_box);
     }
 
     wf::region_t acc_damage;
 
+    /**
+     * Incremented whenever damage is added or the render instances change, so
+     * that the render instructions gathered before can be invalidated.
+     */
+    uint64_t damage_serial = 0;
+
+    /**
+     * The damage of the last frames before accumulating, newest first.
+     * With double or triple buffering, the damage accumulated by
+     * make_current() is contained in it.
+     */
+    std::array<wf::region_t, 2> recent_damage;
+
     /**
      * Make the output current. This sets its EGL context as current, checks
      * whether there is any damage and makes sure frame_damage contains all the
@@ -153,6 +330,9 @@ struct output_damage_t
      */
     void accumulate_damage()
     {
+        recent_damage[1] = std::move(recent_damage[0]);
+        recent_damage[0] = frame_damage;
+
         frame_damage |= acc_damage;
         if (runtime_config.no_damage_track)
         {
@@ -246,6 +426,28 @@ struct output_damage_t
         return scaled & get_ws_box(ws);
     }
 
+    /**
+     * Returns a superset of the damage that the next frame will have on the
+     * given workspace, in output-local coordinates. Unlike get_ws_damage(),
+     * this can be called before make_current().
+     */
+    wf::region_t get_speculative_ws_damage(wf::point_t ws)
+    {
+        wf::region_t damage = frame_damage;
+        for (auto& region : recent_damage)
+        {
+            damage |= region;
+        }
+
+        if (runtime_config.no_damage_track)
+        {
+            damage |= get_wlr_damage_box();
+        }
+
+        auto scaled = damage * (1.0 / wo->handle->scale);
+        return scaled & get_ws_box(ws);
+    }
+
     /**
      * Same as render_manager::damage_whole()
      */
@@ -588,6 +790,11 @@ class depth_buffer_manager_t
  * delay is increased by one. If the next frame is delayed, then
  * `increase_window` is doubled, otherwise, it is halved
  * (but it must stay between `MIN_INCREASE_WINDOW` and `MAX_INCREASE_WINDOW`).
+ *
+ * Alternatively, if core/predictive_repaint_delay is enabled, the render times
+ * of the recent frames are collected in a histogram, and the delay is chosen so
+ * that a given percentile of them (plus a safety margin) still fits in the
+ * refresh cycle. Each missed frame temporarily increases the margin.
  */
 struct repaint_delay_manager_t
 {
@@ -625,7 +832,22 @@ struct repaint_delay_manager_t
         const int64_t refresh = this->refresh_nsec / 1e6;
         const int64_t on_time_thresh = refresh * 1.5;
         const int64_t last_frame_len = get_current_time() - last_pageflip;
-        if (last_frame_len <= on_time_thresh)
+        const bool on_time = (last_frame_len <= on_time_thresh);
+
+        ++total_frames;
+        if (!on_time)
+        {
+            ++missed_frames;
+        }
+
+        if (predictive)
+        {
+            update_predicted_delay(on_time);
+            last_pageflip = get_current_time();
+            return;
+        }
+
+        if (on_time)
         {
             // We rendered last frame on time
             if (get_current_time() - last_increase >= increase_window)
@@ -673,9 +895,121 @@ struct repaint_delay_manager_t
         return delay;
     }
 
+    /**
+     * Add the time it took to render the last frame, in microseconds.
+     */
+    void add_render_time(int64_t usec)
+    {
+        render_times.add(usec);
+    }
+
+    repaint_delay_stats_t get_stats() const
+    {
+        repaint_delay_stats_t stats;
+        stats.predictive = predictive;
+        stats.delay = delay;
+        stats.refresh = refresh_nsec / 1000;
+        stats.predicted_render_time = predicted_render_time;
+        stats.margin = margin + miss_margin;
+        stats.bucket_size = render_time_histogram_t::BUCKET_USEC;
+        stats.histogram   = render_times.buckets;
+        stats.missed_frames = missed_frames;
+        stats.total_frames  = total_frames;
+        return stats;
+    }
+
   private:
     int delay = 0;
 
+    /**
+     * A histogram of the render times of the last WINDOW frames.
+     */
+    struct render_time_histogram_t
+    {
+        static constexpr int64_t BUCKET_USEC = 250;
+        static constexpr size_t NUM_BUCKETS  = 200;
+        static constexpr size_t WINDOW = 240;
+
+        std::vector<uint32_t> buckets = std::vector<uint32_t>(NUM_BUCKETS, 0);
+        // Ring buffer with the bucket of each sample in the window
+        std::vector<uint32_t> samples;
+        size_t next_sample = 0;
+
+        void add(int64_t usec)
+        {
+            const uint32_t bucket = std::min<int64_t>(std::max<int64_t>(usec, 0) / BUCKET_USEC,
+                NUM_BUCKETS - 1);
+            if (samples.size() < WINDOW)
+            {
+                samples.push_back(bucket);
+            } else
+            {
+                --buckets[samples[next_sample]];
+                samples[next_sample] = bucket;
+            }
+
+            ++buckets[bucket];
+            next_sample = (next_sample + 1) % WINDOW;
+        }
+
+        /**
+         * @return The smallest time in microseconds which is at least as long
+         *   as the given percentage of the samples.
+         */
+        int64_t percentile(int percent) const
+        {
+            const size_t needed = (samples.size() * percent + 99) / 100;
+            size_t seen = 0;
+            for (size_t i = 0; i < NUM_BUCKETS; i++)
+            {
+                seen += buckets[i];
+                if ((seen >= needed) && (seen > 0))
+                {
+                    return (i + 1) * BUCKET_USEC;
+                }
+            }
+
+            return NUM_BUCKETS * BUCKET_USEC;
+        }
+    };
+
+    render_time_histogram_t render_times;
+
+    // Don't predict anything before we have seen a few frames
+    static constexpr size_t MIN_PREDICTION_SAMPLES = 30;
+    // After a missed frame, the margin is doubled (but at least by this amount),
+    // and then slowly decays by MISS_MARGIN_DECAY with each frame on time.
+    static constexpr int64_t MIN_MISS_MARGIN   = 1000;
+    static constexpr int64_t MISS_MARGIN_DECAY = 10;
+
+    int64_t predicted_render_time = 0;
+    int64_t miss_margin = 0;
+    uint64_t missed_frames = 0;
+    uint64_t total_frames  = 0;
+
+    void update_predicted_delay(bool last_on_time)
+    {
+        const int64_t refresh = this->refresh_nsec / 1000;
+        if (last_on_time)
+        {
+            miss_margin = std::max<int64_t>(0, miss_margin - MISS_MARGIN_DECAY);
+        } else
+        {
+            miss_margin = std::min(std::max(2 * miss_margin, MIN_MISS_MARGIN), refresh / 2);
+        }
+
+        if ((render_times.samples.size() < MIN_PREDICTION_SAMPLES) || (refresh <= 0))
+        {
+            predicted_render_time = 0;
+            delay = 0;
+            return;
+        }
+
+        predicted_render_time = render_times.percentile(clamp((int)percentile, 1, 100));
+        const int64_t budget = refresh - predicted_render_time - margin - miss_margin;
+        delay = std::max<int64_t>(0, budget / 1000);
+    }
+
     void update_delay(int delta)
     {
         int config_delay = std::max(0,
@@ -714,13 +1048,117 @@ struct repaint_delay_manager_t
     // Time of last frame
     int64_t last_pageflip = -1; // -1 is invalid
 
-    int64_t refresh_nsec;
+    int64_t refresh_nsec = 0;
     wf::option_wrapper_t<int> max_render_time{"core/max_render_time"};
     wf::option_wrapper_t<bool> dynamic_delay{"workarounds/dynamic_repaint_delay"};
+    wf::option_wrapper_t<bool> predictive{"core/predictive_repaint_delay"};
+    wf::option_wrapper_t<int> percentile{"core/repaint_delay_percentile"};
+    wf::option_wrapper_t<int> margin{"core/repaint_delay_margin"};
 
     wf::wl_listener_wrapper on_present;
 };
 
+/**
+ * Collects the timings of the different stages of paint() for the last
+ * FRAME_TIMINGS_HISTORY frames of an output.
+ *
+ * Each call to mark() attributes the time since the previous mark (or since
+ * the start of the frame) to the given stage.
+ */
+struct frame_profiler_t
+{
+    void start_frame(int repaint_delay)
+    {
+        current = {};
+        current.start = last_mark = get_current_time_usec();
+        current.repaint_delay = repaint_delay;
+    }
+
+    void mark(frame_stage_t stage)
+    {
+        const int64_t now = get_current_time_usec();
+        current.stage[stage] += now - last_mark;
+        last_mark = now;
+    }
+
+    void end_frame(frame_result_t result)
+    {
+        current.result = result;
+        current.total  = get_current_time_usec() - current.start;
+
+        if (history.size() < FRAME_TIMINGS_HISTORY)
+        {
+            history.push_back(current);
+        } else
+        {
+            history[next_slot] = current;
+        }
+
+        next_slot = (next_slot + 1) % FRAME_TIMINGS_HISTORY;
+    }
+
+    /**
+     * @return The total time of the last finished frame, in microseconds.
+     */
+    int64_t get_last_total() const
+    {
+        return current.total;
+    }
+
+    void record_damage_simplification(int before, int after, uint64_t overdraw)
+    {
+        current.damage_rects = before;
+        current.simplified_damage_rects = after;
+        current.damage_overdraw = overdraw;
+    }
+
+    /**
+     * @return The recorded frames, oldest first.
+     */
+    std::vector<frame_timings_t> get_history() const
+    {
+        if (history.size() < FRAME_TIMINGS_HISTORY)
+        {
+            return history;
+        }
+
+        std::vector<frame_timings_t> result;
+        result.reserve(history.size());
+        result.insert(result.end(), history.begin() + next_slot, history.end());
+        result.insert(result.end(), history.begin(), history.begin() + next_slot);
+        return result;
+    }
+
+  private:
+    frame_timings_t current;
+    int64_t last_mark = 0;
+
+    std::vector<frame_timings_t> history;
+    size_t next_slot = 0;
+};
+
+/**
+ * Render instructions gathered on a worker thread ahead of the actual render
+ * pass, for a superset of the damage of the frame. See core/parallel_scheduling.
+ */
+struct speculative_pass_t
+{
+    /** The target used for gathering. Its framebuffer is not known yet. */
+    wf::render_target_t target;
+    /** The damage before emitting render_pass_begin, output-local. */
+    wf::region_t input_damage;
+    /** The damage after emitting render_pass_begin. */
+    wf::region_t damage;
+    /** The damage which was left after gathering the instructions. */
+    wf::region_t remaining_damage;
+    std::vector<scene::render_instruction_t> instructions;
+    /** The damage serial of the output at the time of gathering. */
+    uint64_t damage_serial;
+};
+
+static wf::region_t run_render_pass_impl(const scene::render_pass_params_t& params,
+    uint32_t flags, frame_profiler_t *profiler, speculative_pass_t *speculative = nullptr);
+
 class wf::render_manager::impl
 {
   public:
@@ -734,8 +1172,17 @@ class wf::render_manager::impl
     std::unique_ptr<postprocessing_manager_t> postprocessing;
     std::unique_ptr<depth_buffer_manager_t> depth_buffer_manager;
     std::unique_ptr<repaint_delay_manager_t> delay_manager;
+    frame_profiler_t profiler;
 
     wf::option_wrapper_t<wf::color_t> background_color_opt;
+    wf::option_wrapper_t<int> max_damage_rects{"core/max_damage_rects"};
+    wf::option_wrapper_t<bool> parallel_scheduling{"core/parallel_scheduling"};
+
+    /**
+     * The instructions gathered for the next frame by prepare_speculative_pass(),
+     * if any.
+     */
+    std::unique_ptr<speculative_pass_t> speculative;
 
     impl(output_t *o) :
         output(o)
@@ -760,14 +1207,14 @@ class wf::render_manager::impl
             // https://github.com/swaywm/sway/pull/4588
             if (repaint_delay < 1)
             {
-                paint();
+                schedule_paint();
             } else
             {
                 output->handle->frame_pending = true;
                 repaint_timer.set_timeout(repaint_delay, [=] ()
                 {
                     output->handle->frame_pending = false;
-                    paint();
+                    schedule_paint();
                 });
             }
 
@@ -785,6 +1232,12 @@ class wf::render_manager::impl
         output_damage->schedule_repaint();
     }
 
+    ~impl()
+    {
+        auto& outputs = get_frame_batch().outputs;
+        std::replace(outputs.begin(), outputs.end(), this, (impl*)nullptr);
+    }
+
     int constant_redraw_counter = 0;
     void set_redraw_always(bool always)
     {
@@ -882,22 +1335,98 @@ class wf::render_manager::impl
             OpenGL::render_end();
         }
 
+        auto damage = output_damage->get_ws_damage(output->wset()->get_current_workspace());
+        const wf::region_t exact_damage = damage;
+
+        /* Each damage rectangle costs at least one draw call per render
+         * instance, so merge highly fragmented damage into a few boxes. */
+        const int rects_before = damage.end() - damage.begin();
+        const uint64_t overdraw = damage.simplify(std::max(0, (int)max_damage_rects));
+
+        if (speculative && (speculative->damage_serial != output_damage->damage_serial))
+        {
+            // The scenegraph changed since the instructions were gathered.
+            speculative.reset();
+        }
+
+        if (speculative && (exact_damage ^ speculative->input_damage).empty())
+        {
+            // Merging boxes may have added areas the speculative pass did not
+            // cover, but those do not need to be repainted anyway.
+            damage &= speculative->input_damage;
+        }
+
+        profiler.record_damage_simplification(rects_before, damage.end() - damage.begin(), overdraw);
+
+        auto params = get_render_pass_params(damage);
+        this->swap_damage = run_render_pass_impl(params,
+            scene::RPASS_CLEAR_BACKGROUND | scene::RPASS_EMIT_SIGNALS, &profiler, speculative.get());
+        speculative.reset();
+        swap_damage += -wf::origin(output->get_layout_geometry());
+        swap_damage  = swap_damage * output->handle->scale;
+        swap_damage &= output_damage->get_wlr_damage_box();
+    }
+
+    /**
+     * Build the parameters of a render pass of the output's scenegraph.
+     *
+     * @param damage The damage in output-local coordinates.
+     */
+    scene::render_pass_params_t get_render_pass_params(const wf::region_t& damage)
+    {
         scene::render_pass_params_t params;
         params.instances = &output_damage->render_instances;
-        params.damage    = output_damage->get_ws_damage(
-            output->wset()->get_current_workspace());
-        params.damage += wf::origin(output->get_layout_geometry());
-
-        params.target = postprocessing->get_target_framebuffer().translated(
+        params.damage    = damage + wf::origin(output->get_layout_geometry());
+        params.target    = postprocessing->get_target_framebuffer().translated(
             wf::origin(output->get_layout_geometry()));
         params.background_color = background_color_opt;
         params.reference_output = this->output;
+        return params;
+    }
 
-        this->swap_damage = scene::run_render_pass(params,
-            scene::RPASS_CLEAR_BACKGROUND | scene::RPASS_EMIT_SIGNALS);
-        swap_damage += -wf::origin(output->get_layout_geometry());
-        swap_damage  = swap_damage * output->handle->scale;
-        swap_damage &= output_damage->get_wlr_damage_box();
+    /**
+     * Start gathering the render instructions of the next frame ahead of time,
+     * for a superset of the damage the frame will have. The instructions are
+     * clipped to the actual damage in render_output(), unless the scenegraph
+     * changed in the meantime.
+     *
+     * @return A job which gathers the instructions and can run on any thread,
+     *   or an empty function if not all render instances support this.
+     */
+    std::function<void()> prepare_speculative_pass()
+    {
+        speculative.reset();
+        if (!scene::can_schedule_list_in_parallel(output_damage->render_instances))
+        {
+            return {};
+        }
+
+        auto damage = output_damage->get_speculative_ws_damage(
+            output->wset()->get_current_workspace());
+        damage.simplify(std::max(0, (int)max_damage_rects));
+        auto params = get_render_pass_params(damage);
+
+        auto pass = std::make_unique<speculative_pass_t>();
+        pass->target = params.target;
+        pass->input_damage  = damage;
+        pass->damage = params.damage;
+        pass->damage_serial = output_damage->damage_serial;
+
+        // Plugins expanding the damage need to see the speculative pass too,
+        // and signals may only be emitted from the main thread.
+        scene::render_pass_begin_signal ev{pass->damage, pass->target};
+        wf::get_core().emit(&ev);
+
+        speculative = std::move(pass);
+        return [spec = speculative.get(), instances = params.instances] ()
+        {
+            spec->remaining_damage = spec->damage;
+            for (auto& inst : *instances)
+            {
+                inst->schedule_instructions(spec->instructions, spec->target,
+                    spec->remaining_damage);
+            }
+        };
     }
 
     void update_bound_output()
@@ -912,27 +1441,142 @@ class wf::render_manager::impl
             default_fb.fb, default_fb.viewport_width, default_fb.viewport_height);
     }
 
+    /**
+     * Outputs whose frames started in the same event loop iteration. They are
+     * painted together, so that their render instructions can be gathered in
+     * parallel.
+     */
+    struct frame_batch_t
+    {
+        std::vector<impl*> outputs;
+        wf::wl_idle_call idle_paint;
+    };
+
+    static frame_batch_t& get_frame_batch()
+    {
+        static frame_batch_t batch;
+        return batch;
+    }
+
+    /**
+     * Paint the output now, or together with the other outputs starting a
+     * frame in this loop iteration if core/parallel_scheduling is enabled.
+     */
+    void schedule_paint()
+    {
+        if (!parallel_scheduling)
+        {
+            paint();
+            return;
+        }
+
+        auto& batch = get_frame_batch();
+        batch.outputs.push_back(this);
+        if (!batch.idle_paint.is_connected())
+        {
+            batch.idle_paint.run_once([] () { paint_frame_batch(); });
+        }
+    }
+
+    static void paint_frame_batch()
+    {
+        auto& outputs = get_frame_batch().outputs;
+        for (auto& out : outputs)
+        {
+            if (out && !out->paint_prepare())
+            {
+                out = nullptr;
+            }
+        }
+
+        const size_t nr_rendered = std::count_if(outputs.begin(), outputs.end(),
+            [] (impl *out) { return out != nullptr; });
+        if (nr_rendered > 1)
+        {
+            std::vector<std::function<void()>> jobs;
+            for (auto& out : outputs)
+            {
+                if (!out)
+                {
+                    continue;
+                }
+
+                if (auto job = out->prepare_speculative_pass())
+                {
+                    jobs.push_back(std::move(job));
+                }
+            }
+
+            scene::freeze_bounding_boxes();
+            worker_pool_t::get().run(jobs);
+            scene::thaw_bounding_boxes();
+        }
+
+        // Outputs may be destroyed while painting others, in which case
+        // their entry is reset by ~impl().
+        for (size_t i = 0; i < outputs.size(); i++)
+        {
+            if (outputs[i])
+            {
+                outputs[i]->paint_render();
+            }
+        }
+
+        outputs.clear();
+    }
+
     /**
      * Repaints the whole output, includes all effects and hooks
      */
     void paint()
     {
+        if (paint_prepare())
+        {
+            paint_render();
+        }
+    }
+
+    /**
+     * The first part of paint(): run the pre-render effects and try to scan
+     * out directly.
+     *
+     * @return Whether the output still needs to be rendered by paint_render().
+     */
+    bool paint_prepare()
+    {
+        profiler.start_frame(delay_manager->get_delay());
+
         /* Part 1: frame setup: query damage, etc. */
         effects->run_effects(OUTPUT_EFFECT_PRE);
         effects->run_effects(OUTPUT_EFFECT_DAMAGE);
+        profiler.mark(FRAME_STAGE_PRE_EFFECTS);
 
-        if (do_direct_scanout())
+        const bool scanout = do_direct_scanout();
+        profiler.mark(FRAME_STAGE_DIRECT_SCANOUT);
+        if (scanout)
         {
             // Yet another optimization: if we can directly scanout, we should
             // stop the rest of the repaint cycle.
-            return;
+            profiler.end_frame(frame_result_t::SCANOUT);
+            return false;
         }
 
+        return true;
+    }
+
+    /**
+     * The second part of paint(): render the scenegraph and effects and swap
+     * buffers.
+     */
+    void paint_render()
+    {
         bool needs_swap;
         if (!output_damage->make_current(needs_swap))
         {
+            speculative.reset();
             wlr_output_rollback(output->handle);
             delay_manager->skip_frame();
+            profiler.end_frame(frame_result_t::SKIPPED);
             return;
         }
 
@@ -941,8 +1585,10 @@ class wf::render_manager::impl
             /* Optimization: the output doesn't need a swap (so isn't damaged),
              * and no plugin wants custom redrawing - we can just skip the whole
              * repaint */
+            speculative.reset();
             wlr_output_rollback(output->handle);
             delay_manager->skip_frame();
+            profiler.end_frame(frame_result_t::SKIPPED);
             return;
         }
 
@@ -952,6 +1598,7 @@ class wf::render_manager::impl
         output_damage->accumulate_damage();
 
         update_bound_output();
+        profiler.mark(FRAME_STAGE_MAKE_CURRENT);
 
         /* Part 2: call the renderer, which sets swap_damage and
          * draws the scenegraph */
@@ -959,6 +1606,7 @@ class wf::render_manager::impl
 
         /* Part 3: overlay effects */
         effects->run_effects(OUTPUT_EFFECT_OVERLAY);
+        profiler.mark(FRAME_STAGE_OVERLAY_EFFECTS);
 
         if (postprocessing->post_effects.size())
         {
@@ -975,6 +1623,8 @@ class wf::render_manager::impl
             OpenGL::render_end();
         }
 
+        profiler.mark(FRAME_STAGE_POST_EFFECTS);
+
         /* Part 5: render sw cursors
          * We render software cursors after everything else
          * for consistency with hardware cursor planes */
@@ -985,11 +1635,16 @@ class wf::render_manager::impl
             swap_damage.to_pixman());
         wlr_renderer_end(wf::get_core().renderer);
         OpenGL::render_end();
+        profiler.mark(FRAME_STAGE_SW_CURSORS);
 
         /* Part 6: finalize frame: swap buffers, send frame_done, etc */
         OpenGL::unbind_output(output);
         output_damage->swap_buffers(swap_damage);
         swap_damage.clear();
+        profiler.mark(FRAME_STAGE_SWAP_BUFFERS);
+        profiler.end_frame(frame_result_t::RENDERED);
+        delay_manager->add_render_time(profiler.get_last_total());
+
         post_paint();
     }
 
@@ -1010,6 +1665,37 @@ class wf::render_manager::impl
 wf::region_t scene::run_render_pass(
     const render_pass_params_t& params, uint32_t flags)
 {
+    return run_render_pass_impl(params, flags, nullptr);
+}
+
+/**
+ * Same as scene::run_render_pass(), but also records the time needed for
+ * gathering and executing the render instructions in the given profiler.
+ */
+/**
+ * Check whether the instructions of a speculative pass can be used for a
+ * render pass with the given target and damage.
+ */
+static bool can_use_speculative_pass(const speculative_pass_t& speculative,
+    const wf::render_target_t& target, const wf::region_t& damage)
+{
+    const auto& spec = speculative.target;
+    const bool same_target = (spec.geometry == target.geometry) &&
+        (spec.viewport_width == target.viewport_width) &&
+        (spec.viewport_height == target.viewport_height) &&
+        (spec.scale == target.scale) && (spec.wl_transform == target.wl_transform) &&
+        (spec.transform == target.transform) && (spec.subbuffer == target.subbuffer);
+
+    return same_target && (damage ^ speculative.damage).empty();
+}
+
+static wf::region_t run_render_pass_impl(const scene::render_pass_params_t& params,
+    uint32_t flags, frame_profiler_t *profiler, speculative_pass_t *speculative)
+{
+    using namespace scene;
+    auto& gpu_profiler = gpu_profiler_t::get();
+    gpu_profiler.collect();
+
     auto accumulated_damage = params.damage;
 
     if (flags & RPASS_EMIT_SIGNALS)
@@ -1023,10 +1709,41 @@ wf::region_t scene::run_render_pass(
 
     // Gather instructions
     std::vector<wf::scene::render_instruction_t> instructions;
-    for (auto& inst : *params.instances)
+    if (speculative && can_use_speculative_pass(*speculative, params.target, accumulated_damage))
+    {
+        // Instances which can be scheduled in parallel only intersect and
+        // subtract from the damage, so gathering for the smaller damage would
+        // have given the same instructions, clipped to the damage.
+        for (auto& instr : speculative->instructions)
+        {
+            instr.damage &= accumulated_damage;
+            if (instr.damage.empty())
+            {
+                continue;
+            }
+
+            if (instr.target.fb == speculative->target.fb)
+            {
+                instr.target.fb  = params.target.fb;
+                instr.target.tex = params.target.tex;
+            }
+
+            instructions.push_back(std::move(instr));
+        }
+
+        accumulated_damage &= speculative->remaining_damage;
+    } else
+    {
+        for (auto& inst : *params.instances)
+        {
+            inst->schedule_instructions(instructions,
+                params.target, accumulated_damage);
+        }
+    }
+
+    if (profiler)
     {
-        inst->schedule_instructions(instructions,
-            params.target, accumulated_damage);
+        profiler->mark(FRAME_STAGE_GATHER_INSTRUCTIONS);
     }
 
     // Clear visible background areas
@@ -1042,16 +1759,33 @@ wf::region_t scene::run_render_pass(
         OpenGL::render_end();
     }
 
-    // Render instances
+    // Render instances. Textures drawn by simple instances like surfaces are
+    // batched and drawn together when the next instance starts rendering on
+    // its own, or at the end of the pass.
+    OpenGL::batch_begin();
     for (auto& instr : wf::reverse(instructions))
     {
+        const bool measured = gpu_profiler.begin_instruction(instr);
         instr.instance->render(instr.target, instr.damage, instr.data);
+        if (measured)
+        {
+            // Attribute the batched draws to this instruction
+            OpenGL::flush_batch();
+            gpu_profiler.end_instruction();
+        }
+
         if (params.reference_output)
         {
             instr.instance->presentation_feedback(params.reference_output);
         }
     }
 
+    OpenGL::batch_end();
+    if (profiler)
+    {
+        profiler->mark(FRAME_STAGE_RENDER_INSTANCES);
+    }
+
     if (flags & RPASS_EMIT_SIGNALS)
     {
         render_pass_end_signal end_ev;
@@ -1090,6 +1824,28 @@ void scene::compute_visibility_from_list(const std::vector<render_instance_uptr>
     region += offset;
 }
 
+float scene::get_render_scale_level(float shrink)
+{
+    // Going further than 1/16 saves hardly any fill rate, but loses a lot of detail.
+    static constexpr int MAX_LEVEL = 4;
+    if (!(shrink < 1.0f))
+    {
+        return 1.0f;
+    }
+
+    int level = std::floor(-std::log2(std::max(shrink, 1e-6f)));
+    level = std::clamp(level, 0, MAX_LEVEL);
+    return 1.0f / (1 << level);
+}
+
+bool scene::can_schedule_list_in_parallel(const std::vector<render_instance_uptr>& instances)
+{
+    return std::all_of(instances.begin(), instances.end(), [] (const render_instance_uptr& inst)
+    {
+        return inst->can_schedule_in_parallel();
+    });
+}
+
 render_manager::render_manager(output_t *o) :
     pimpl(new impl(o))
 {}
@@ -1169,6 +1925,16 @@ wf::render_target_t render_manager::get_target_framebuffer() const
 {
     return pimpl->postprocessing->get_target_framebuffer();
 }
+
+std::vector<frame_timings_t> render_manager::get_frame_timings() const
+{
+    return pimpl->profiler.get_history();
+}
+
+repaint_delay_stats_t render_manager::get_repaint_delay_stats() const
+{
+    return pimpl->delay_manager->get_stats();
+}
 } // namespace wf
 
 /* End render_manager */
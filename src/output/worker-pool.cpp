@@ -0,0 +1,91 @@
+#include "worker-pool.hpp"
+#include <algorithm>
+
+namespace wf
+{
+/* The main thread also runs jobs, and outputs are rarely more than 4 */
+static constexpr unsigned MAX_WORKERS = 3;
+
+worker_pool_t& worker_pool_t::get()
+{
+    static worker_pool_t pool;
+    return pool;
+}
+
+worker_pool_t::worker_pool_t()
+{
+    const unsigned hw = std::thread::hardware_concurrency();
+    const unsigned nr_workers = std::min(MAX_WORKERS, hw > 1 ? hw - 1 : 1);
+    for (unsigned i = 0; i < nr_workers; i++)
+    {
+        workers.emplace_back([=] () { worker_main(); });
+    }
+}
+
+worker_pool_t::~worker_pool_t()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        shutting_down = true;
+    }
+
+    work_available.notify_all();
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void worker_pool_t::run_pending(std::unique_lock<std::mutex>& lock)
+{
+    while (current_jobs && (next_job < current_jobs->size()))
+    {
+        auto& job = (*current_jobs)[next_job++];
+        lock.unlock();
+        job();
+        lock.lock();
+
+        if (--unfinished == 0)
+        {
+            work_done.notify_all();
+        }
+    }
+}
+
+void worker_pool_t::worker_main()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        work_available.wait(lock, [&] ()
+        {
+            return shutting_down || (current_jobs && (next_job < current_jobs->size()));
+        });
+
+        if (shutting_down)
+        {
+            return;
+        }
+
+        run_pending(lock);
+    }
+}
+
+void worker_pool_t::run(const std::vector<std::function<void()>>& jobs)
+{
+    if (jobs.empty())
+    {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    current_jobs = &jobs;
+    next_job     = 0;
+    unfinished   = jobs.size();
+    work_available.notify_all();
+
+    run_pending(lock);
+    work_done.wait(lock, [&] () { return unfinished == 0; });
+    current_jobs = nullptr;
+}
+}
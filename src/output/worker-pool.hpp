@@ -0,0 +1,46 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace wf
+{
+/**
+ * A small pool of worker threads for running CPU-only jobs in parallel.
+ *
+ * Jobs must not touch OpenGL, wlroots or the Wayland event loop, since these
+ * may only be used from the main thread.
+ */
+class worker_pool_t
+{
+  public:
+    static worker_pool_t& get();
+
+    /**
+     * Run all jobs and wait until they are finished. The calling thread also
+     * runs jobs while waiting.
+     */
+    void run(const std::vector<std::function<void()>>& jobs);
+
+    ~worker_pool_t();
+
+  private:
+    worker_pool_t();
+    void worker_main();
+    /* Run jobs from the current batch until none are left. Called with the lock held. */
+    void run_pending(std::unique_lock<std::mutex>& lock);
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable work_available;
+    std::condition_variable work_done;
+
+    const std::vector<std::function<void()>> *current_jobs = nullptr;
+    size_t next_job    = 0;
+    size_t unfinished  = 0;
+    bool shutting_down = false;
+};
+}
@@ -15,6 +15,7 @@
 #include <wayfire/scene-operations.hpp>
 
 #include "../view/view-impl.hpp"
+#include "../core/scene-priv.hpp"
 #include "wayfire/debug.hpp"
 #include "wayfire/geometry.hpp"
 #include "wayfire/option-wrapper.hpp"
@@ -162,7 +163,8 @@ static size_t find_index_in_parent(wf::scene::node_t *x, wf::scene::node_t *pare
     return it - children.begin();
 }
 
-class workspace_set_root_node_t : public wf::scene::floating_inner_node_t
+class workspace_set_root_node_t : public wf::scene::floating_inner_node_t,
+    public wf::scene::flat_instances_tag_t
 {
     uint64_t index;
 
@@ -1,5 +1,8 @@
 #include <wayfire/region.hpp>
 #include <wayfire/nonstd/wlroots-full.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
 
 /* Pixman helpers */
 wlr_box wlr_box_from_pixman_box(const pixman_box32_t& box)
@@ -20,45 +23,172 @@ pixman_box32_t pixman_box_from_wlr_box(const wlr_box& box)
     };
 }
 
-wf::region_t::region_t()
+static bool box_empty(const pixman_box32_t& box)
 {
-    pixman_region32_init(&_region);
+    return (box.x1 >= box.x2) || (box.y1 >= box.y2);
 }
 
-wf::region_t::region_t(pixman_region32_t *region) : wf::region_t()
+/* Invalid and empty boxes are all stored as {0, 0, 0, 0} */
+static pixman_box32_t normalized_box(const pixman_box32_t& box)
 {
-    pixman_region32_copy(this->to_pixman(), region);
+    return box_empty(box) ? pixman_box32_t{0, 0, 0, 0} : box;
 }
 
-wf::region_t::region_t(const wlr_box& box)
+static pixman_box32_t box_intersection(const pixman_box32_t& a, const pixman_box32_t& b)
 {
-    pixman_region32_init_rect(&_region, box.x, box.y, box.width, box.height);
+    return normalized_box({
+        std::max(a.x1, b.x1), std::max(a.y1, b.y1),
+        std::min(a.x2, b.x2), std::min(a.y2, b.y2),
+    });
 }
 
-wf::region_t::~region_t()
+static bool box_contains(const pixman_box32_t& a, const pixman_box32_t& b)
 {
-    pixman_region32_fini(&_region);
+    return box_empty(b) ||
+           ((a.x1 <= b.x1) && (a.y1 <= b.y1) && (a.x2 >= b.x2) && (a.y2 >= b.y2));
 }
 
-wf::region_t::region_t(const wf::region_t& other) : wf::region_t()
+struct wf::region_t::storage_t
+{
+    pixman_region32_t region;
+
+    storage_t()
+    {
+        pixman_region32_init(&region);
+    }
+
+    ~storage_t()
+    {
+        pixman_region32_fini(&region);
+    }
+
+    storage_t(const storage_t&) = delete;
+    storage_t& operator =(const storage_t&) = delete;
+};
+
+/**
+ * A read-only pixman region with the contents of a region_t, for operations
+ * which have no fast path. Regions with a single box are converted to a
+ * pixman region on the stack, which does not allocate memory.
+ */
+class wf::region_t::pixman_view_t
+{
+  public:
+    pixman_view_t(const wf::region_t& region)
+    {
+        if (region.storage)
+        {
+            // Keep the storage alive, in case the region is assigned to
+            // while the view is used.
+            storage = region.storage;
+            ptr     = &storage->region;
+        } else
+        {
+            const auto& box = region.box;
+            pixman_region32_init_rect(&local, box.x1, box.y1, box.x2 - box.x1, box.y2 - box.y1);
+            ptr = &local;
+        }
+    }
+
+    ~pixman_view_t()
+    {
+        if (ptr == &local)
+        {
+            pixman_region32_fini(&local);
+        }
+    }
+
+    pixman_view_t(const pixman_view_t&) = delete;
+    pixman_view_t& operator =(const pixman_view_t&) = delete;
+
+    pixman_region32_t *get() const
+    {
+        return ptr;
+    }
+
+  private:
+    std::shared_ptr<storage_t> storage;
+    pixman_region32_t local;
+    pixman_region32_t *ptr;
+};
+
+pixman_region32_t*wf::region_t::make_unique()
 {
-    pixman_region32_copy(this->to_pixman(), other.unconst());
+    if (!storage)
+    {
+        storage = std::make_shared<storage_t>();
+        pixman_region32_fini(&storage->region);
+        pixman_region32_init_rect(&storage->region, box.x1, box.y1, box.x2 - box.x1, box.y2 - box.y1);
+        box = {0, 0, 0, 0};
+    } else if (storage.use_count() > 1)
+    {
+        auto copy = std::make_shared<storage_t>();
+        pixman_region32_copy(&copy->region, &storage->region);
+        storage = std::move(copy);
+    }
+
+    return &storage->region;
 }
 
-wf::region_t::region_t(wf::region_t&& other) : wf::region_t()
+void wf::region_t::normalize()
 {
-    std::swap(this->_region, other._region);
+    if (!storage || (pixman_region32_n_rects(&storage->region) > 1))
+    {
+        return;
+    }
+
+    box = normalized_box(*pixman_region32_extents(&storage->region));
+    storage.reset();
 }
 
-wf::region_t& wf::region_t::operator =(const wf::region_t& other)
+template<class Op>
+void wf::region_t::apply(Op op)
 {
-    if (&other == this)
+    if (storage && (storage.use_count() == 1))
     {
-        return *this;
+        op(&storage->region, &storage->region);
+    } else
+    {
+        pixman_view_t src{*this};
+        storage = std::make_shared<storage_t>();
+        box     = {0, 0, 0, 0};
+        op(&storage->region, src.get());
     }
 
-    pixman_region32_copy(&_region, other.unconst());
+    normalize();
+}
+
+wf::region_t::region_t()
+{}
+
+wf::region_t::region_t(pixman_region32_t *region)
+{
+    pixman_region32_copy(make_unique(), region);
+    normalize();
+}
 
+wf::region_t::region_t(const wlr_box& box)
+{
+    this->box = normalized_box(pixman_box_from_wlr_box(box));
+}
+
+wf::region_t::~region_t()
+{}
+
+wf::region_t::region_t(const wf::region_t& other) :
+    box(other.box), storage(other.storage)
+{}
+
+wf::region_t::region_t(wf::region_t&& other) :
+    box(other.box), storage(std::move(other.storage))
+{
+    other.box = {0, 0, 0, 0};
+}
+
+wf::region_t& wf::region_t::operator =(const wf::region_t& other)
+{
+    this->box     = other.box;
+    this->storage = other.storage;
     return *this;
 }
 
@@ -69,36 +199,225 @@ wf::region_t& wf::region_t::operator =(wf::region_t&& other)
         return *this;
     }
 
-    std::swap(_region, other._region);
-
+    std::swap(box, other.box);
+    std::swap(storage, other.storage);
     return *this;
 }
 
 bool wf::region_t::empty() const
 {
-    return !pixman_region32_not_empty(this->unconst());
+    if (storage)
+    {
+        return !pixman_region32_not_empty(&storage->region);
+    }
+
+    return box_empty(box);
 }
 
 void wf::region_t::clear()
 {
-    pixman_region32_clear(&_region);
+    box = {0, 0, 0, 0};
+    storage.reset();
 }
 
 void wf::region_t::expand_edges(int amount)
 {
+    if (!storage && (amount >= 0))
+    {
+        if (!box_empty(box))
+        {
+            box = {box.x1 - amount, box.y1 - amount, box.x2 + amount, box.y2 + amount};
+        }
+
+        return;
+    }
+
     /* FIXME: make sure we don't throw pixman errors when amount is bigger
      * than a rectangle size */
-    wlr_region_expand(this->to_pixman(), this->to_pixman(), amount);
+    apply([&] (pixman_region32_t *dst, pixman_region32_t *src)
+    {
+        wlr_region_expand(dst, src, amount);
+    });
+}
+
+static int64_t box_area(const pixman_box32_t& box)
+{
+    return int64_t(box.x2 - box.x1) * (box.y2 - box.y1);
+}
+
+static pixman_box32_t box_union(const pixman_box32_t& a, const pixman_box32_t& b)
+{
+    return {
+        std::min(a.x1, b.x1), std::min(a.y1, b.y1),
+        std::max(a.x2, b.x2), std::max(a.y2, b.y2),
+    };
+}
+
+/**
+ * Merge boxes until at most @target remain.
+ *
+ * Each pass considers merging every box with the next few boxes in the list
+ * (pixman sorts rectangles top-to-bottom, so these are typically close), and
+ * greedily merges the pairs which add the fewest pixels. Each box takes part in
+ * at most one merge per pass.
+ */
+static void merge_boxes(std::vector<pixman_box32_t>& boxes, size_t target)
+{
+    constexpr size_t WINDOW = 4;
+    struct candidate_t
+    {
+        int64_t cost;
+        size_t i, j;
+    };
+
+    std::vector<candidate_t> candidates;
+    std::vector<bool> merged;
+    while (boxes.size() > target)
+    {
+        candidates.clear();
+        for (size_t i = 0; i < boxes.size(); i++)
+        {
+            for (size_t j = i + 1; j < std::min(boxes.size(), i + 1 + WINDOW); j++)
+            {
+                int64_t cost = box_area(box_union(boxes[i], boxes[j])) -
+                    box_area(boxes[i]) - box_area(boxes[j]);
+                candidates.push_back({cost, i, j});
+            }
+        }
+
+        std::sort(candidates.begin(), candidates.end(), [] (const auto& a, const auto& b)
+        {
+            return a.cost < b.cost;
+        });
+
+        merged.assign(boxes.size(), false);
+        size_t remaining = boxes.size();
+        std::vector<pixman_box32_t> next;
+        next.reserve(boxes.size());
+        for (auto& c : candidates)
+        {
+            if (remaining <= target)
+            {
+                break;
+            }
+
+            if (merged[c.i] || merged[c.j])
+            {
+                continue;
+            }
+
+            boxes[c.i] = box_union(boxes[c.i], boxes[c.j]);
+            merged[c.i] = merged[c.j] = true;
+            // Mark j as removed by making it empty
+            boxes[c.j] = {0, 0, 0, 0};
+            --remaining;
+        }
+
+        for (auto& box : boxes)
+        {
+            if (box_area(box) > 0)
+            {
+                next.push_back(box);
+            }
+        }
+
+        std::swap(boxes, next);
+    }
+}
+
+uint64_t wf::region_t::simplify(size_t max_rects)
+{
+    if ((max_rects == 0) || !storage)
+    {
+        return 0;
+    }
+
+    int n;
+    auto rects = pixman_region32_rectangles(&storage->region, &n);
+    if ((size_t)n <= max_rects)
+    {
+        return 0;
+    }
+
+    int64_t area_before = 0;
+    for (int i = 0; i < n; i++)
+    {
+        area_before += box_area(rects[i]);
+    }
+
+    std::vector<pixman_box32_t> boxes(rects, rects + n);
+    size_t target = max_rects;
+
+    wf::region_t result;
+    while (true)
+    {
+        merge_boxes(boxes, target);
+        pixman_region32_fini(result.to_pixman());
+        pixman_region32_init_rects(result.to_pixman(), boxes.data(), boxes.size());
+
+        // Merged boxes may overlap or be split in several bands by pixman, so
+        // the final region might still have too many rectangles.
+        if ((target == 1) || ((size_t)pixman_region32_n_rects(result.to_pixman()) <= max_rects))
+        {
+            break;
+        }
+
+        target = std::max(target / 2, (size_t)1);
+    }
+
+    result.normalize();
+    *this = std::move(result);
+
+    int64_t area_after = 0;
+    for (auto& box : *this)
+    {
+        area_after += box_area(box);
+    }
+
+    return std::max(area_after - area_before, (int64_t)0);
+}
+
+bool wf::region_t::operator ==(const wf::region_t& other) const
+{
+    if (!storage && !other.storage)
+    {
+        return (box.x1 == other.box.x1) && (box.y1 == other.box.y1) &&
+               (box.x2 == other.box.x2) && (box.y2 == other.box.y2);
+    }
+
+    if (storage == other.storage)
+    {
+        return true;
+    }
+
+    pixman_view_t a{*this}, b{other};
+    return pixman_region32_equal(a.get(), b.get());
+}
+
+bool wf::region_t::operator !=(const wf::region_t& other) const
+{
+    return !(*this == other);
 }
 
 pixman_box32_t wf::region_t::get_extents() const
 {
-    return *pixman_region32_extents(this->unconst());
+    if (storage)
+    {
+        return *pixman_region32_extents(&storage->region);
+    }
+
+    return box;
 }
 
 bool wf::region_t::contains_point(const wf::point_t& point) const
 {
-    return pixman_region32_contains_point(this->unconst(),
+    if (!storage)
+    {
+        return (box.x1 <= point.x) && (point.x < box.x2) &&
+               (box.y1 <= point.y) && (point.y < box.y2);
+    }
+
+    return pixman_region32_contains_point(&storage->region,
         point.x, point.y, NULL);
 }
 
@@ -122,169 +441,283 @@ bool wf::region_t::contains_pointf(const wf::pointf_t& point) const
 wf::region_t wf::region_t::operator +(const wf::point_t& vector) const
 {
     wf::region_t result{*this};
-    pixman_region32_translate(&result._region, vector.x, vector.y);
+    result += vector;
     return result;
 }
 
 wf::region_t& wf::region_t::operator +=(const wf::point_t& vector)
 {
-    pixman_region32_translate(&_region, vector.x, vector.y);
+    if (!storage)
+    {
+        if (!box_empty(box))
+        {
+            box = {box.x1 + vector.x, box.y1 + vector.y, box.x2 + vector.x, box.y2 + vector.y};
+        }
+
+        return *this;
+    }
+
+    apply([&] (pixman_region32_t *dst, pixman_region32_t *src)
+    {
+        if (dst != src)
+        {
+            pixman_region32_copy(dst, src);
+        }
+
+        pixman_region32_translate(dst, vector.x, vector.y);
+    });
     return *this;
 }
 
 wf::region_t wf::region_t::operator -(const wf::point_t& vector) const
 {
-    wf::region_t result{*this};
-    pixman_region32_translate(&result._region, -vector.x, -vector.y);
-    return result;
+    return *this + wf::point_t{-vector.x, -vector.y};
 }
 
 wf::region_t& wf::region_t::operator -=(const wf::point_t& vector)
 {
-    pixman_region32_translate(&_region, -vector.x, -vector.y);
-    return *this;
+    return *this += wf::point_t{-vector.x, -vector.y};
 }
 
 wf::region_t wf::region_t::operator *(float scale) const
 {
-    wf::region_t result;
-    wlr_region_scale(result.to_pixman(), this->unconst(), scale);
-
+    wf::region_t result{*this};
+    result *= scale;
     return result;
 }
 
 wf::region_t& wf::region_t::operator *=(float scale)
 {
-    wlr_region_scale(this->to_pixman(), this->to_pixman(), scale);
+    if (scale == 1.0)
+    {
+        return *this;
+    }
+
+    if (!storage)
+    {
+        // Same rounding as wlr_region_scale()
+        if (!box_empty(box))
+        {
+            box = normalized_box({
+                (int32_t)std::floor(box.x1 * scale), (int32_t)std::floor(box.y1 * scale),
+                (int32_t)std::ceil(box.x2 * scale), (int32_t)std::ceil(box.y2 * scale),
+            });
+        }
 
+        return *this;
+    }
+
+    apply([&] (pixman_region32_t *dst, pixman_region32_t *src)
+    {
+        wlr_region_scale(dst, src, scale);
+    });
     return *this;
 }
 
 /* Region intersection */
 wf::region_t wf::region_t::operator &(const wlr_box& box) const
 {
-    wf::region_t result;
-    pixman_region32_intersect_rect(result.to_pixman(), this->unconst(),
-        box.x, box.y, box.width, box.height);
-
+    wf::region_t result{*this};
+    result &= box;
     return result;
 }
 
 wf::region_t wf::region_t::operator &(const wf::region_t& other) const
 {
-    wf::region_t result;
-    pixman_region32_intersect(result.to_pixman(),
-        this->unconst(), other.unconst());
-
+    wf::region_t result{*this};
+    result &= other;
     return result;
 }
 
 wf::region_t& wf::region_t::operator &=(const wlr_box& box)
 {
-    pixman_region32_intersect_rect(this->to_pixman(), this->to_pixman(),
-        box.x, box.y, box.width, box.height);
+    if (!storage)
+    {
+        this->box = box_intersection(this->box, pixman_box_from_wlr_box(box));
+        return *this;
+    }
 
+    apply([&] (pixman_region32_t *dst, pixman_region32_t *src)
+    {
+        pixman_region32_intersect_rect(dst, src, box.x, box.y, box.width, box.height);
+    });
     return *this;
 }
 
 wf::region_t& wf::region_t::operator &=(const wf::region_t& other)
 {
-    pixman_region32_intersect(this->to_pixman(),
-        this->to_pixman(), other.unconst());
+    if (!other.storage)
+    {
+        return *this &= wlr_box_from_pixman_box(other.box);
+    }
+
+    if (!storage)
+    {
+        // Intersecting with a box has a fast path, so swap the operands
+        return *this = other & wlr_box_from_pixman_box(box);
+    }
 
+    pixman_view_t other_view{other};
+    apply([&] (pixman_region32_t *dst, pixman_region32_t *src)
+    {
+        pixman_region32_intersect(dst, src, other_view.get());
+    });
     return *this;
 }
 
 /* Region union */
 wf::region_t wf::region_t::operator |(const wlr_box& other) const
 {
-    wf::region_t result;
-    pixman_region32_union_rect(result.to_pixman(), this->unconst(),
-        other.x, other.y, other.width, other.height);
-
+    wf::region_t result{*this};
+    result |= other;
     return result;
 }
 
 wf::region_t wf::region_t::operator |(const wf::region_t& other) const
 {
-    wf::region_t result;
-    pixman_region32_union(result.to_pixman(), this->unconst(), other.unconst());
-
+    wf::region_t result{*this};
+    result |= other;
     return result;
 }
 
 wf::region_t& wf::region_t::operator |=(const wlr_box& other)
 {
-    pixman_region32_union_rect(this->to_pixman(), this->to_pixman(),
-        other.x, other.y, other.width, other.height);
+    const auto other_box = normalized_box(pixman_box_from_wlr_box(other));
+    if (box_empty(other_box))
+    {
+        return *this;
+    }
+
+    if (!storage)
+    {
+        if (box_contains(box, other_box))
+        {
+            return *this;
+        }
+
+        if (box_contains(other_box, box))
+        {
+            box = other_box;
+            return *this;
+        }
+    }
 
+    apply([&] (pixman_region32_t *dst, pixman_region32_t *src)
+    {
+        pixman_region32_union_rect(dst, src, other.x, other.y, other.width, other.height);
+    });
     return *this;
 }
 
 wf::region_t& wf::region_t::operator |=(const wf::region_t& other)
 {
-    pixman_region32_union(this->to_pixman(), this->to_pixman(), other.unconst());
+    if (!other.storage)
+    {
+        return *this |= wlr_box_from_pixman_box(other.box);
+    }
+
+    if (!storage && box_empty(box))
+    {
+        // Share the storage of the other region
+        return *this = other;
+    }
 
+    pixman_view_t other_view{other};
+    apply([&] (pixman_region32_t *dst, pixman_region32_t *src)
+    {
+        pixman_region32_union(dst, src, other_view.get());
+    });
     return *this;
 }
 
 /* Subtract the box/region from the current region */
 wf::region_t wf::region_t::operator ^(const wlr_box& box) const
 {
-    wf::region_t result;
-    wf::region_t sub{box};
-    pixman_region32_subtract(result.to_pixman(), this->unconst(), sub.to_pixman());
-
+    wf::region_t result{*this};
+    result ^= box;
     return result;
 }
 
 wf::region_t wf::region_t::operator ^(const wf::region_t& other) const
 {
-    wf::region_t result;
-    pixman_region32_subtract(result.to_pixman(),
-        this->unconst(), other.unconst());
-
+    wf::region_t result{*this};
+    result ^= other;
     return result;
 }
 
 wf::region_t& wf::region_t::operator ^=(const wlr_box& box)
 {
-    wf::region_t sub{box};
-    pixman_region32_subtract(this->to_pixman(),
-        this->to_pixman(), sub.to_pixman());
+    const auto sub = normalized_box(pixman_box_from_wlr_box(box));
+    if (!storage)
+    {
+        if (box_empty(box_intersection(this->box, sub)))
+        {
+            return *this;
+        }
+
+        if (box_contains(sub, this->box))
+        {
+            clear();
+            return *this;
+        }
+    } else if (box_empty(sub))
+    {
+        return *this;
+    }
 
+    wf::region_t sub_region{box};
+    pixman_view_t sub_view{sub_region};
+    apply([&] (pixman_region32_t *dst, pixman_region32_t *src)
+    {
+        pixman_region32_subtract(dst, src, sub_view.get());
+    });
     return *this;
 }
 
 wf::region_t& wf::region_t::operator ^=(const wf::region_t& other)
 {
-    pixman_region32_subtract(this->to_pixman(),
-        this->to_pixman(), other.unconst());
+    if (!other.storage)
+    {
+        return *this ^= wlr_box_from_pixman_box(other.box);
+    }
 
+    if (!storage && box_empty(box))
+    {
+        return *this;
+    }
+
+    pixman_view_t other_view{other};
+    apply([&] (pixman_region32_t *dst, pixman_region32_t *src)
+    {
+        pixman_region32_subtract(dst, src, other_view.get());
+    });
     return *this;
 }
 
 pixman_region32_t*wf::region_t::to_pixman()
 {
-    return &_region;
-}
-
-pixman_region32_t*wf::region_t::unconst() const
-{
-    return const_cast<pixman_region32_t*>(&_region);
+    return make_unique();
 }
 
 const pixman_box32_t*wf::region_t::begin() const
 {
-    int n;
+    if (!storage)
+    {
+        return &box;
+    }
 
-    return pixman_region32_rectangles(unconst(), &n);
+    int n;
+    return pixman_region32_rectangles(&storage->region, &n);
 }
 
 const pixman_box32_t*wf::region_t::end() const
 {
-    int n;
-    auto data = pixman_region32_rectangles(unconst(), &n);
+    if (!storage)
+    {
+        return box_empty(box) ? &box : &box + 1;
+    }
 
+    int n;
+    auto data = pixman_region32_rectangles(&storage->region, &n);
     return data + n;
 }
@@ -151,6 +151,7 @@ void wf::color_rect_view_t::move(int x, int y)
 
     this->geometry.x = x;
     this->geometry.y = y;
+    get_surface_root_node()->invalidate_bounding_box();
 
     damage();
     emit(&data);
@@ -164,6 +165,7 @@ void wf::color_rect_view_t::resize(int w, int h)
 
     this->geometry.width  = w;
     this->geometry.height = h;
+    get_surface_root_node()->invalidate_bounding_box();
 
     damage();
     emit(&data);
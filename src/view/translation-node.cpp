@@ -106,6 +106,11 @@ class translation_node_instance_t : public wf::scene::render_instance_t
     {
         compute_visibility_from_list(children, output, visible, self->get_offset());
     }
+
+    bool can_schedule_in_parallel() override
+    {
+        return can_schedule_list_in_parallel(children);
+    }
 };
 }
 }
@@ -130,4 +135,7 @@ wf::point_t wf::scene::translation_node_t::get_offset() const
 void wf::scene::translation_node_t::set_offset(wf::point_t offset)
 {
     this->offset = offset;
+    // The visibility of the surfaces below depends on the offset, so it has
+    // to be recomputed like for any other geometry change.
+    wf::scene::update(this->shared_from_this(), wf::scene::update_flag::GEOMETRY);
 }
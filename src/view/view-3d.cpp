@@ -175,7 +175,8 @@ class view_2d_render_instance_t :
     {
         // Untransformed bounding box
         auto bbox = self->get_children_bounding_box();
-        auto tex  = this->get_texture(target.scale);
+        const float shrink = std::max(std::abs(self->scale_x), std::abs(self->scale_y));
+        auto tex = this->get_texture(get_texture_scale(target, shrink));
 
         auto midpoint  = get_center(self->view->get_wm_geometry());
         auto center_at = glm::translate(glm::mat4(1.0),
@@ -390,7 +391,7 @@ class view_3d_render_instance_t :
                 });
 
         transform = target.transform * scale * translate * transform;
-        auto tex = get_texture(target.scale);
+        auto tex = get_texture(get_texture_scale(target));
 
         OpenGL::render_begin(target);
         for (auto& box : damage)
@@ -52,6 +52,13 @@ class view_interface_t::view_priv_impl
     int visibility_counter   = 1;
 
     wf::render_target_t offscreen_buffer;
+
+    /* State for persistent snapshots, see view_interface_t::set_persistent_snapshot() */
+    int persistent_snapshot_counter = 0;
+    std::vector<scene::render_instance_uptr> snapshot_instances;
+    wf::output_t *snapshot_output = nullptr;
+    wf::region_t snapshot_damage;
+    wf::signal::connection_t<scene::root_node_update_signal> on_snapshot_regen;
     wlr_box minimize_hint = {0, 0, 0, 0};
 
     scene::floating_inner_ptr root_node;
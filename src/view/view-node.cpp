@@ -359,6 +359,11 @@ class view_render_instance_t : public render_instance_t
 
         compute_visibility_from_list(children, output, visible, wf::origin(view->get_output_geometry()));
     }
+
+    bool can_schedule_in_parallel() override
+    {
+        return can_schedule_list_in_parallel(children);
+    }
 };
 
 void view_node_t::gen_render_instances(std::vector<render_instance_uptr> & instances,
@@ -19,6 +19,7 @@
 #include <glm/glm.hpp>
 #include "wayfire/signal-definitions.hpp"
 #include <wayfire/scene-operations.hpp>
+#include <wayfire/debug.hpp>
 
 static void reposition_relative_to_parent(wayfire_view view)
 {
@@ -714,6 +715,20 @@ wf::geometry_t wf::view_interface_t::get_untransformed_bounding_box()
     return get_surface_root_node()->get_bounding_box();
 }
 
+static void regen_snapshot_instances(wf::view_interface_t *view)
+{
+    auto& priv = view->priv;
+    priv->snapshot_instances.clear();
+    view->get_surface_root_node()->gen_render_instances(priv->snapshot_instances,
+        [&priv] (const wf::region_t& damage)
+    {
+        priv->snapshot_damage |= damage;
+    }, view->get_output());
+
+    priv->snapshot_output = view->get_output();
+    priv->snapshot_damage |= view->get_surface_root_node()->get_bounding_box();
+}
+
 const wf::render_target_t& wf::view_interface_t::take_snapshot()
 {
     if (!is_mapped())
@@ -727,25 +742,90 @@ const wf::render_target_t& wf::view_interface_t::take_snapshot()
     float scale = get_output()->handle->scale;
 
     OpenGL::render_begin();
-    offscreen_buffer.allocate(bbox.width * scale, bbox.height * scale);
+    bool reallocated = offscreen_buffer.allocate(bbox.width * scale, bbox.height * scale);
     OpenGL::render_end();
 
-    offscreen_buffer.geometry = root_node->get_bounding_box();
-    offscreen_buffer.scale    = scale;
+    const bool persistent = (priv->persistent_snapshot_counter > 0);
+    if (!persistent)
+    {
+        priv->snapshot_instances.clear();
+    }
+
+    if (priv->snapshot_instances.empty() || (priv->snapshot_output != get_output()))
+    {
+        regen_snapshot_instances(this);
+    }
 
-    std::vector<scene::render_instance_uptr> instances;
-    root_node->gen_render_instances(instances, [] (auto) {}, get_output());
+    // The old contents of the buffer are useless if it was reallocated or if the view contents moved.
+    if (!persistent || reallocated || (offscreen_buffer.geometry != bbox) ||
+        (offscreen_buffer.scale != scale))
+    {
+        priv->snapshot_damage |= bbox;
+    }
+
+    offscreen_buffer.geometry = bbox;
+    offscreen_buffer.scale    = scale;
 
     scene::render_pass_params_t params;
     params.background_color = {0, 0, 0, 0};
-    params.damage    = bbox;
+    params.damage    = priv->snapshot_damage & bbox;
     params.target    = offscreen_buffer;
-    params.instances = &instances;
+    params.instances = &priv->snapshot_instances;
+
+    if (!params.damage.empty())
+    {
+        scene::run_render_pass(params, scene::RPASS_CLEAR_BACKGROUND);
+    }
+
+    priv->snapshot_damage.clear();
+    if (!persistent)
+    {
+        priv->snapshot_instances.clear();
+    }
 
-    scene::run_render_pass(params, scene::RPASS_CLEAR_BACKGROUND);
     return offscreen_buffer;
 }
 
+void wf::view_interface_t::set_persistent_snapshot(bool persistent)
+{
+    priv->persistent_snapshot_counter += persistent ? 1 : -1;
+    wf::dassert(priv->persistent_snapshot_counter >= 0,
+        "set_persistent_snapshot(false) called more often than set_persistent_snapshot(true)!");
+    if (priv->persistent_snapshot_counter <= 0)
+    {
+        priv->on_snapshot_regen.disconnect();
+        priv->snapshot_instances.clear();
+        priv->snapshot_damage.clear();
+        return;
+    }
+
+    if (priv->on_snapshot_regen.is_connected())
+    {
+        return;
+    }
+
+    // Like workspace streams, regenerate the instances when the structure of the view's contents changes.
+    priv->on_snapshot_regen = [=] (scene::root_node_update_signal *ev)
+    {
+        if (!(ev->flags & (scene::update_flag::ENABLED | scene::update_flag::CHILDREN_LIST)))
+        {
+            return;
+        }
+
+        for (auto node = ev->changed_node.get(); node; node = node->parent())
+        {
+            if (node == get_surface_root_node().get())
+            {
+                // The instances are generated lazily on the next snapshot.
+                priv->snapshot_instances.clear();
+                return;
+            }
+        }
+    };
+
+    wf::get_core().scene()->connect(&priv->on_snapshot_regen);
+}
+
 wf::view_interface_t::view_interface_t()
 {
     this->priv = std::make_unique<wf::view_interface_t::view_priv_impl>();
@@ -832,6 +912,9 @@ void wf::view_interface_t::deinitialize()
     set_decoration(nullptr);
     this->_clear_data();
 
+    priv->on_snapshot_regen.disconnect();
+    priv->snapshot_instances.clear();
+
     OpenGL::render_begin();
     this->priv->offscreen_buffer.release();
     OpenGL::render_end();
@@ -31,12 +31,14 @@ wf::scene::surface_state_t& wf::scene::surface_state_t::operator =(surface_state
     current_buffer = other.current_buffer;
     texture = other.texture;
     accumulated_damage = other.accumulated_damage;
+    opaque_region = other.opaque_region;
     size = other.size;
     src_viewport = other.src_viewport;
 
     other.current_buffer = NULL;
     other.texture = NULL;
     other.accumulated_damage.clear();
+    other.opaque_region.clear();
     other.src_viewport.reset();
     return *this;
 }
@@ -71,6 +73,8 @@ void wf::scene::surface_state_t::merge_state(wlr_surface *surface)
         this->src_viewport.reset();
     }
 
+    this->opaque_region = wf::region_t{&surface->opaque_region};
+
     wf::region_t current_damage;
     wlr_surface_get_effective_damage(surface, current_damage.to_pixman());
     this->accumulated_damage |= current_damage;
@@ -129,9 +133,10 @@ wf::scene::wlr_surface_node_t::wlr_surface_node_t(wlr_surface *surface, bool aut
 void wf::scene::wlr_surface_node_t::apply_state(surface_state_t&& state)
 {
     const bool size_changed = current_state.size != state.size;
+    const bool opaque_changed = current_state.opaque_region != state.opaque_region;
     this->current_state = std::move(state);
     wf::scene::damage_node(this, current_state.accumulated_damage);
-    if (size_changed)
+    if (size_changed || opaque_changed)
     {
         scene::update(this->shared_from_this(), scene::update_flag::GEOMETRY);
     }
@@ -209,9 +214,15 @@ class wf::scene::wlr_surface_node_t::wlr_surface_render_instance_t : public rend
     wf::output_t *visible_on;
     damage_callback push_damage;
 
+    // The part of the surface which is not occluded by opaque surfaces above
+    // it, as computed by the last compute_visibility() call. Damage outside of
+    // this region is not visible and thus dropped.
+    std::optional<wf::region_t> visible_region;
+
     wf::signal::connection_t<node_damage_signal> on_surface_damage =
         [=] (node_damage_signal *data)
     {
+        wf::region_t damage = data->region;
         if (self->surface)
         {
             // Make sure to expand damage, because stretching the surface may cause additional damage.
@@ -219,11 +230,19 @@ class wf::scene::wlr_surface_node_t::wlr_surface_render_instance_t : public rend
             const float output_scale = visible_on ? visible_on->handle->scale : 1.0;
             if (scale != output_scale)
             {
-                data->region.expand_edges(std::ceil(std::abs(scale - output_scale)));
+                damage.expand_edges(std::ceil(std::abs(scale - output_scale)));
             }
         }
 
-        push_damage(data->region);
+        if (visible_region)
+        {
+            damage &= *visible_region;
+        }
+
+        if (!damage.empty())
+        {
+            push_damage(damage);
+        }
     };
 
   public:
@@ -270,11 +289,7 @@ class wf::scene::wlr_surface_node_t::wlr_surface_render_instance_t : public rend
                 .damage   = std::move(our_damage),
             });
 
-            if (self->surface)
-            {
-                pixman_region32_subtract(damage.to_pixman(), damage.to_pixman(),
-                    &self->surface->opaque_region);
-            }
+            damage ^= self->current_state.opaque_region;
         }
     }
 
@@ -288,24 +303,16 @@ class wf::scene::wlr_surface_node_t::wlr_surface_render_instance_t : public rend
         wf::geometry_t geometry = self->get_bounding_box();
         wf::texture_t texture{self->current_state.texture, self->current_state.src_viewport};
 
-        OpenGL::render_begin(target);
-        OpenGL::render_texture(texture, target, geometry, glm::vec4(1.f), OpenGL::RENDER_FLAG_CACHED);
+        uint32_t bits = 0;
         // use GL_NEAREST for integer scale.
         // GL_NEAREST makes scaled text blocky instead of blurry, which looks better
         // but only for integer scale.
-        if (target.scale - floor(target.scale) < 0.001)
+        if (target.get_effective_scale() - floor(target.get_effective_scale()) < 0.001)
         {
-            GL_CALL(glTexParameteri(texture.target, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+            bits |= OpenGL::TEXTURE_FILTER_NEAREST;
         }
 
-        for (const auto& rect : region)
-        {
-            target.logic_scissor(wlr_box_from_pixman_box(rect));
-            OpenGL::draw_cached();
-        }
-
-        OpenGL::clear_cached();
-        OpenGL::render_end();
+        OpenGL::batch_texture(texture, target, geometry, region, glm::vec4(1.f), bits);
     }
 
     void presentation_feedback(wf::output_t *output) override
@@ -363,14 +370,27 @@ class wf::scene::wlr_surface_node_t::wlr_surface_render_instance_t : public rend
         auto our_box = self->get_bounding_box();
         on_frame_done.disconnect();
 
-        if (!(visible & our_box).empty())
+        visible_region = visible & our_box;
+        if (!visible_region->empty())
         {
             // We are visible on the given output => send wl_surface.frame on output frame, so that clients
             // can draw the next frame.
             output->connect(&on_frame_done);
-            // TODO: compute actually visible region and disable damage reporting for that region.
+
+            // Surfaces below us are not visible through our opaque region.
+            visible ^= self->current_state.opaque_region;
         }
     }
+
+    node_t *get_node() const override
+    {
+        return self.get();
+    }
+
+    bool can_schedule_in_parallel() override
+    {
+        return true;
+    }
 };
 
 void wf::scene::wlr_surface_node_t::gen_render_instances(
@@ -3,6 +3,7 @@
 #include "wayfire/core.hpp"
 #include <wayfire/txn/transaction.hpp>
 #include <wayfire/txn/transaction-manager.hpp>
+#include <wayfire/txn/client-latency.hpp>
 #include <wayfire/signal-definitions.hpp>
 #include "../view-impl.hpp"
 #include "../xdg-shell.hpp"
@@ -10,6 +11,7 @@
 #include "wayfire/geometry.hpp"
 #include <wayfire/output-layout.hpp>
 #include <wayfire/workspace-set.hpp>
+#include <unordered_map>
 
 /**
  * When we get a request for setting CSD, the view might not have been
@@ -169,13 +171,22 @@ void wf::xdg_toplevel_view_t::resize(int w, int h)
     if (should_resize_client({w, h}, current_size))
     {
         this->last_size_request = {w, h};
-        last_configure_serial   = wlr_xdg_toplevel_set_size(xdg_toplevel, w, h);
+        track_configure(wlr_xdg_toplevel_set_size(xdg_toplevel, w, h));
+    }
+}
+
+void wf::xdg_toplevel_view_t::track_configure(uint32_t serial)
+{
+    last_configure_serial = serial;
+    if (configure_sent_time < 0)
+    {
+        configure_sent_time = wf::get_current_time_usec();
     }
 }
 
 void wf::xdg_toplevel_view_t::request_native_size()
 {
-    last_configure_serial = wlr_xdg_toplevel_set_size(xdg_toplevel, 0, 0);
+    track_configure(wlr_xdg_toplevel_set_size(xdg_toplevel, 0, 0));
 }
 
 void wf::xdg_toplevel_view_t::close()
@@ -223,8 +234,7 @@ bool wf::xdg_toplevel_view_t::is_focusable() const
 void wf::xdg_toplevel_view_t::set_tiled(uint32_t edges)
 {
     wlr_xdg_toplevel_set_tiled(xdg_toplevel, edges);
-    last_configure_serial = wlr_xdg_toplevel_set_maximized(xdg_toplevel,
-        (edges == wf::TILED_EDGES_ALL));
+    track_configure(wlr_xdg_toplevel_set_maximized(xdg_toplevel, (edges == wf::TILED_EDGES_ALL)));
 
     wf::view_interface_t::set_tiled(edges);
 }
@@ -232,13 +242,13 @@ void wf::xdg_toplevel_view_t::set_tiled(uint32_t edges)
 void wf::xdg_toplevel_view_t::set_fullscreen(bool fullscreen)
 {
     view_interface_t::set_fullscreen(fullscreen);
-    last_configure_serial = wlr_xdg_toplevel_set_fullscreen(xdg_toplevel, fullscreen);
+    track_configure(wlr_xdg_toplevel_set_fullscreen(xdg_toplevel, fullscreen));
 }
 
 void wf::xdg_toplevel_view_t::set_activated(bool active)
 {
     view_interface_t::set_activated(active);
-    last_configure_serial = wlr_xdg_toplevel_set_activated(xdg_toplevel, active);
+    track_configure(wlr_xdg_toplevel_set_activated(xdg_toplevel, active));
 }
 
 std::string wf::xdg_toplevel_view_t::get_app_id()
@@ -428,6 +438,13 @@ void wf::xdg_toplevel_view_t::commit()
     if (xdg_toplevel->base->current.configure_serial == this->last_configure_serial)
     {
         this->last_size_request = wf::dimensions(xdg_g);
+        if (configure_sent_time >= 0)
+        {
+            // The client caught up with all configures we have sent, measure how long it took.
+            wf::txn::record_client_latency(wl_resource_get_client(xdg_toplevel->resource),
+                wf::get_current_time_usec() - configure_sent_time);
+            configure_sent_time = -1;
+        }
     }
 
     scene::surface_state_t cur_state;
@@ -57,6 +57,9 @@ class xdg_toplevel_view_t : public wf::view_interface_t
     wf::dimensions_t last_size_request = {0, 0};
     wlr_xdg_toplevel *xdg_toplevel;
     uint32_t last_configure_serial;
+    // When the oldest configure which the client has not acknowledged yet was sent, or -1 if none.
+    int64_t configure_sent_time = -1;
+    void track_configure(uint32_t serial);
     bool should_resize_client(wf::dimensions_t old, wf::dimensions_t next);
     void update_size();
     void adjust_anchored_edge(wf::dimensions_t new_size);
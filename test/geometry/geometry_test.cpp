@@ -2,6 +2,8 @@
 #include <doctest/doctest.h>
 
 #include <wayfire/geometry.hpp>
+#include <wayfire/region.hpp>
+#include <iterator>
 
 TEST_CASE("Point addition")
 {
@@ -11,3 +13,94 @@ TEST_CASE("Point addition")
     using namespace wf;
     REQUIRE_EQ(a + b, wf::point_t{4, 6});
 }
+
+TEST_CASE("Region simplification")
+{
+    wf::region_t region;
+    for (int i = 0; i < 10; i++)
+    {
+        region |= wf::geometry_t{i * 20, 0, 10, 10};
+    }
+
+    wf::region_t original = region;
+    REQUIRE_EQ(pixman_region32_n_rects(region.to_pixman()), 10);
+
+    // Nothing to do
+    REQUIRE_EQ(region.simplify(0), 0);
+    REQUIRE_EQ(region.simplify(10), 0);
+    REQUIRE_EQ(pixman_region32_n_rects(region.to_pixman()), 10);
+
+    const uint64_t overdraw = region.simplify(3);
+    REQUIRE(pixman_region32_n_rects(region.to_pixman()) <= 3);
+    REQUIRE(overdraw > 0);
+    REQUIRE((original ^ region).empty());
+
+    // Merging everything results in the extents
+    region = original;
+    REQUIRE_EQ(region.simplify(1), 190 * 10 - 10 * 10 * 10);
+    REQUIRE_EQ(pixman_region32_n_rects(region.to_pixman()), 1);
+}
+
+static int count_rects(const wf::region_t& region)
+{
+    return std::distance(region.begin(), region.end());
+}
+
+TEST_CASE("Region single box operations")
+{
+    wf::region_t region{wf::geometry_t{0, 0, 100, 100}};
+    REQUIRE_EQ(count_rects(region), 1);
+
+    REQUIRE(region.contains_point({99, 99}));
+    REQUIRE(!region.contains_point({100, 0}));
+
+    auto moved = region + wf::point_t{10, 20};
+    REQUIRE_EQ(moved.get_extents().x1, 10);
+    REQUIRE_EQ(moved.get_extents().y2, 120);
+    REQUIRE_EQ(region.get_extents().x1, 0);
+
+    REQUIRE((region & wf::geometry_t{200, 200, 10, 10}).empty());
+    REQUIRE_EQ(count_rects(region & wf::geometry_t{200, 200, 10, 10}), 0);
+    REQUIRE((region ^ wf::geometry_t{-10, -10, 200, 200}).empty());
+
+    // Invalid boxes behave like empty ones
+    REQUIRE(wf::region_t{wf::geometry_t{0, 0, -5, 10}}.empty());
+    REQUIRE((region | wf::geometry_t{10, 10, -5, -5}) == region);
+
+    // Regions merge back to a single box
+    auto halves = wf::region_t{wf::geometry_t{0, 0, 50, 100}} | wf::geometry_t{50, 0, 50, 100};
+    REQUIRE_EQ(count_rects(halves), 1);
+    REQUIRE(halves == region);
+
+    auto hole = region ^ wf::geometry_t{25, 25, 50, 50};
+    REQUIRE_EQ(count_rects(hole), 4);
+    REQUIRE_EQ(count_rects(hole | wf::geometry_t{25, 25, 50, 50}), 1);
+    REQUIRE_EQ((region * 1.5).get_extents().x2, 150);
+}
+
+TEST_CASE("Region copies are independent")
+{
+    wf::region_t region;
+    for (int i = 0; i < 4; i++)
+    {
+        region |= wf::geometry_t{i * 20, 0, 10, 10};
+    }
+
+    wf::region_t copy = region;
+    REQUIRE(copy == region);
+
+    copy |= wf::geometry_t{0, 50, 10, 10};
+    REQUIRE_EQ(count_rects(copy), 5);
+    REQUIRE_EQ(count_rects(region), 4);
+
+    copy = region;
+    copy += wf::point_t{5, 5};
+    REQUIRE_EQ(region.get_extents().x1, 0);
+    REQUIRE_EQ(copy.get_extents().x1, 5);
+
+    // Writing through the pixman region does not change other copies
+    copy = region;
+    pixman_region32_clear(copy.to_pixman());
+    REQUIRE(copy.empty());
+    REQUIRE_EQ(count_rects(region), 4);
+}
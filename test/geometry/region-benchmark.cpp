@@ -0,0 +1,177 @@
+#include <wayfire/region.hpp>
+#include <wayfire/nonstd/wlroots-full.hpp>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <vector>
+
+/**
+ * The implementation of wf::region_t before it stored single boxes inline and
+ * shared the storage between copies. Only the operations used in the benchmark
+ * are implemented.
+ */
+class legacy_region_t
+{
+  public:
+    legacy_region_t()
+    {
+        pixman_region32_init(&region);
+    }
+
+    legacy_region_t(const wlr_box& box)
+    {
+        pixman_region32_init_rect(&region, box.x, box.y, box.width, box.height);
+    }
+
+    ~legacy_region_t()
+    {
+        pixman_region32_fini(&region);
+    }
+
+    legacy_region_t(const legacy_region_t& other) : legacy_region_t()
+    {
+        pixman_region32_copy(&region, other.unconst());
+    }
+
+    legacy_region_t& operator =(const legacy_region_t& other)
+    {
+        pixman_region32_copy(&region, other.unconst());
+        return *this;
+    }
+
+    bool empty() const
+    {
+        return !pixman_region32_not_empty(unconst());
+    }
+
+    legacy_region_t operator +(const wf::point_t& vector) const
+    {
+        legacy_region_t result{*this};
+        pixman_region32_translate(&result.region, vector.x, vector.y);
+        return result;
+    }
+
+    legacy_region_t operator *(float scale) const
+    {
+        legacy_region_t result;
+        wlr_region_scale(&result.region, unconst(), scale);
+        return result;
+    }
+
+    legacy_region_t operator &(const wlr_box& box) const
+    {
+        legacy_region_t result;
+        pixman_region32_intersect_rect(&result.region, unconst(), box.x, box.y, box.width, box.height);
+        return result;
+    }
+
+    legacy_region_t& operator |=(const wlr_box& box)
+    {
+        pixman_region32_union_rect(&region, &region, box.x, box.y, box.width, box.height);
+        return *this;
+    }
+
+    legacy_region_t& operator |=(const legacy_region_t& other)
+    {
+        pixman_region32_union(&region, &region, other.unconst());
+        return *this;
+    }
+
+  private:
+    pixman_region32_t region;
+    pixman_region32_t *unconst() const
+    {
+        return const_cast<pixman_region32_t*>(&region);
+    }
+};
+
+/**
+ * The damage path of a surface: the damage is clipped to the surface, offset
+ * to the parent's coordinate system, scaled to the output and passed by value
+ * through two levels of damage callbacks, like push_damage() of nested render
+ * instances.
+ *
+ * @return The time per damage event in nanoseconds.
+ */
+template<class Region>
+static double run_damage_path(const Region& damage, int iterations)
+{
+    int64_t sum = 0;
+    std::function<void(Region)> output_damage = [&] (Region region)
+    {
+        sum += !region.empty();
+    };
+    std::function<void(Region)> push_damage = [&] (Region region)
+    {
+        output_damage(region * 2.0f);
+    };
+
+    const wlr_box surface = {0, 0, 1920, 1080};
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        Region clipped = damage & surface;
+        push_damage(clipped + wf::point_t{i % 16, 0});
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    if (sum != iterations)
+    {
+        std::cout << "unexpected result" << std::endl;
+    }
+
+    return 1.0 * std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / iterations;
+}
+
+/**
+ * Accumulating damage copies, like a frame's damage being saved for each
+ * buffer age slot.
+ *
+ * @return The time per copy in nanoseconds.
+ */
+template<class Region>
+static double run_copies(const Region& damage, int iterations)
+{
+    std::vector<Region> history(4);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        history[i % history.size()] = damage;
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    if (history[0].empty())
+    {
+        std::cout << "unexpected result" << std::endl;
+    }
+
+    return 1.0 * std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / iterations;
+}
+
+template<class Region>
+static Region make_damage(int nr_boxes)
+{
+    Region damage;
+    for (int i = 0; i < nr_boxes; i++)
+    {
+        damage |= wlr_box{(i * 97) % 1800, (i * 61) % 1000, 40, 30};
+    }
+
+    return damage;
+}
+
+int main()
+{
+    const int iterations = 1'000'000;
+    for (int nr_boxes : {1, 4, 32})
+    {
+        auto legacy  = make_damage<legacy_region_t>(nr_boxes);
+        auto current = make_damage<wf::region_t>(nr_boxes);
+        std::cout << nr_boxes << " boxes: damage path legacy " << run_damage_path(legacy, iterations) <<
+            " ns, current " << run_damage_path(current, iterations) << " ns; copy legacy " <<
+            run_copies(legacy, iterations) << " ns, current " << run_copies(current, iterations) <<
+            " ns" << std::endl;
+    }
+
+    return 0;
+}
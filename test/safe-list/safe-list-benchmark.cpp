@@ -0,0 +1,81 @@
+#include <wayfire/nonstd/safe-list.hpp>
+#include <wayfire/signal-provider.hpp>
+#include <chrono>
+#include <iostream>
+#include <list>
+
+struct bench_signal
+{
+    int value;
+};
+
+using connection_ptr = wf::signal::connection_t<bench_signal>*;
+
+/**
+ * Iteration over the std::list<std::unique_ptr<T>> storage which safe_list_t
+ * used before it was backed by a vector.
+ */
+static void iterate_legacy(const std::list<std::unique_ptr<connection_ptr>>& list,
+    std::function<void(connection_ptr&)> func)
+{
+    auto it = list.begin();
+    for (int size = list.size(); size > 0; size--, it++)
+    {
+        if (*it)
+        {
+            func(**it);
+        }
+    }
+}
+
+template<class Iterate>
+static double measure(int iterations, Iterate iterate)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        iterate();
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() /
+           (1.0 * iterations);
+}
+
+int main()
+{
+    const int nr_connections = 10'000;
+    const int iterations     = 1'000;
+
+    int64_t sum = 0;
+    std::vector<std::unique_ptr<wf::signal::connection_t<bench_signal>>> connections;
+    wf::safe_list_t<connection_ptr> list;
+    std::list<std::unique_ptr<connection_ptr>> legacy;
+    for (int i = 0; i < nr_connections; i++)
+    {
+        connections.push_back(std::make_unique<wf::signal::connection_t<bench_signal>>(
+            [&] (bench_signal *ev) { sum += ev->value; }));
+        list.push_back(connections.back().get());
+        legacy.push_back(std::make_unique<connection_ptr>(connections.back().get()));
+    }
+
+    bench_signal ev{1};
+    auto call = [&] (connection_ptr& conn) { conn->emit(&ev); };
+
+    double legacy_us = measure(iterations, [&] { iterate_legacy(legacy, call); });
+    double list_us   = measure(iterations, [&] { list.for_each(call); });
+
+    // Erase every other connection, leaving tombstones behind
+    for (int i = 0; i < nr_connections; i += 2)
+    {
+        list.remove_all(connections[i].get());
+    }
+
+    double sparse_us = measure(iterations, [&] { list.for_each(call); });
+
+    std::cout << "Iterating " << nr_connections << " connections: std::list " << legacy_us <<
+        "us, safe_list_t " << list_us << "us, safe_list_t after erasing half " << sparse_us <<
+        "us" << std::endl;
+
+    return sum > 0 ? 0 : 1;
+}
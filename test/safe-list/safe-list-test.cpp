@@ -0,0 +1,141 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+#include <wayfire/nonstd/safe-list.hpp>
+
+static std::vector<int> collect(const wf::safe_list_t<int>& list)
+{
+    std::vector<int> result;
+    list.for_each([&] (int& x) { result.push_back(x); });
+    return result;
+}
+
+TEST_CASE("Basic operations")
+{
+    wf::safe_list_t<int> list;
+    REQUIRE(list.size() == 0);
+    REQUIRE_THROWS(list.back());
+
+    list.push_back(1);
+    list.push_back(2);
+    list.push_back(3);
+    REQUIRE(list.size() == 3);
+    REQUIRE(list.back() == 3);
+    REQUIRE(collect(list) == std::vector<int>{1, 2, 3});
+
+    list.remove_all(3);
+    REQUIRE(list.size() == 2);
+    REQUIRE(list.back() == 2);
+
+    std::vector<int> reversed;
+    list.for_each_reverse([&] (int& x) { reversed.push_back(x); });
+    REQUIRE(reversed == std::vector<int>{2, 1});
+
+    list.clear();
+    REQUIRE(list.size() == 0);
+}
+
+TEST_CASE("Insert at a position")
+{
+    using list_t = wf::safe_list_t<int>;
+    list_t list;
+    list.push_back(1);
+    list.push_back(3);
+
+    list.insert_at(2, [] (int& x) { return x == 3 ? list_t::INSERT_BEFORE : list_t::INSERT_NONE; });
+    list.insert_at(4, [] (int& x) { return x == 3 ? list_t::INSERT_AFTER : list_t::INSERT_NONE; });
+    list.insert_at(5, [] (int&) { return list_t::INSERT_NONE; });
+    REQUIRE(collect(list) == std::vector<int>{1, 2, 3, 4, 5});
+}
+
+TEST_CASE("Erase while iterating")
+{
+    wf::safe_list_t<int> list;
+    for (int i = 0; i < 10; i++)
+    {
+        list.push_back(i);
+    }
+
+    std::vector<int> visited;
+    list.for_each([&] (int& x)
+    {
+        visited.push_back(x);
+        // Remove the current and the next element
+        list.remove_if([&] (const int& y) { return y == x || y == x + 1; });
+    });
+
+    REQUIRE(visited == std::vector<int>{0, 2, 4, 6, 8});
+    REQUIRE(list.size() == 0);
+    REQUIRE(collect(list).empty());
+}
+
+TEST_CASE("Add while iterating")
+{
+    wf::safe_list_t<int> list;
+    list.push_back(1);
+    list.push_back(2);
+
+    int visited = 0;
+    list.for_each([&] (int& x)
+    {
+        ++visited;
+        list.push_back(x + 10);
+        // Elements added during iteration are visible to size() and back()
+        REQUIRE(list.back() == x + 10);
+    });
+
+    // Elements added during iteration are not visited
+    REQUIRE(visited == 2);
+    REQUIRE(list.size() == 4);
+    REQUIRE(collect(list) == std::vector<int>{1, 2, 11, 12});
+
+    // Elements added and removed during iteration are never inserted
+    list.for_each([&] (int& x)
+    {
+        if (x == 1)
+        {
+            list.push_back(100);
+            list.remove_all(100);
+        }
+    });
+    REQUIRE(collect(list) == std::vector<int>{1, 2, 11, 12});
+}
+
+TEST_CASE("Nested iteration")
+{
+    wf::safe_list_t<int> list;
+    for (int i = 0; i < 4; i++)
+    {
+        list.push_back(i);
+    }
+
+    int total = 0;
+    list.for_each([&] (int& x)
+    {
+        list.for_each([&] (int& y)
+        {
+            ++total;
+            if (y == 3)
+            {
+                list.remove_all(3);
+            }
+        });
+    });
+
+    // 4 elements on the first pass, 3 on the remaining ones
+    REQUIRE(total == 4 + 3 + 3);
+    REQUIRE(collect(list) == std::vector<int>{0, 1, 2});
+}
+
+TEST_CASE("Copy skips erased elements")
+{
+    wf::safe_list_t<int> list;
+    list.push_back(1);
+    list.push_back(2);
+    list.push_back(3);
+    list.remove_all(2);
+
+    wf::safe_list_t<int> copy = list;
+    REQUIRE(copy.size() == 2);
+    REQUIRE(collect(copy) == std::vector<int>{1, 3});
+}
@@ -0,0 +1,123 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+#include <wayfire/scene.hpp>
+#include <wayfire/core.hpp>
+#include <wayfire/region.hpp>
+#include <wayfire/unstable/translation-node.hpp>
+#include "../test-options.hpp"
+
+using namespace wf::scene;
+
+/** A leaf with a geometry which can be changed freely. */
+class leaf_node_t : public node_t
+{
+  public:
+    leaf_node_t(wf::geometry_t geometry) : node_t(false)
+    {
+        this->geometry = geometry;
+    }
+
+    wf::geometry_t get_bounding_box() override
+    {
+        return geometry;
+    }
+
+    wf::geometry_t geometry;
+};
+
+/** Compute the bounding box of @node without using any caches. */
+static wf::geometry_t recompute(node_t *node)
+{
+    if (auto leaf = dynamic_cast<leaf_node_t*>(node))
+    {
+        return leaf->geometry;
+    }
+
+    wf::geometry_t result = {0, 0, 0, 0};
+    if (!node->get_children().empty())
+    {
+        wf::region_t extents;
+        for (auto& ch : node->get_children())
+        {
+            extents |= recompute(ch.get());
+        }
+
+        result = wlr_box_from_pixman_box(extents.get_extents());
+    }
+
+    if (auto translation = dynamic_cast<translation_node_t*>(node))
+    {
+        result = result + translation->get_offset();
+    }
+
+    return result;
+}
+
+/** Check the (possibly cached) bounding boxes of all nodes in the subtree. */
+static void check_subtree(node_t *node)
+{
+    CAPTURE(node->stringify());
+    REQUIRE(node->get_bounding_box() == recompute(node));
+    for (auto& ch : node->get_children())
+    {
+        check_subtree(ch.get());
+    }
+}
+
+struct test_tree_t
+{
+    std::shared_ptr<floating_inner_node_t> root = std::make_shared<floating_inner_node_t>(false);
+    std::shared_ptr<floating_inner_node_t> inner = std::make_shared<floating_inner_node_t>(false);
+    std::shared_ptr<translation_node_t> translation = std::make_shared<translation_node_t>();
+    std::shared_ptr<leaf_node_t> a = std::make_shared<leaf_node_t>(wf::geometry_t{0, 0, 100, 100});
+    std::shared_ptr<leaf_node_t> b = std::make_shared<leaf_node_t>(wf::geometry_t{200, 50, 100, 100});
+    std::shared_ptr<leaf_node_t> c = std::make_shared<leaf_node_t>(wf::geometry_t{10, 10, 20, 20});
+
+    test_tree_t()
+    {
+        setup_scenegraph_options();
+        translation->set_children_list({c});
+        inner->set_children_list({b, translation});
+        root->set_children_list({a, inner});
+
+        // Fill the caches
+        check_subtree(root.get());
+    }
+};
+
+TEST_CASE("Cached bounding boxes follow geometry updates")
+{
+    test_tree_t tree;
+
+    tree.b->geometry = {300, 400, 50, 50};
+    wf::scene::update(tree.b, update_flag::GEOMETRY);
+    check_subtree(tree.root.get());
+
+    tree.c->geometry = {-50, -50, 10, 10};
+    wf::scene::update(tree.c, update_flag::GEOMETRY);
+    check_subtree(tree.root.get());
+}
+
+TEST_CASE("Cached bounding boxes follow translation offsets")
+{
+    test_tree_t tree;
+
+    tree.translation->set_offset({500, 600});
+    check_subtree(tree.root.get());
+
+    tree.translation->set_offset({-100, 0});
+    check_subtree(tree.root.get());
+}
+
+TEST_CASE("Cached bounding boxes follow changes of the children list")
+{
+    test_tree_t tree;
+
+    auto d = std::make_shared<leaf_node_t>(wf::geometry_t{1000, 1000, 10, 10});
+    tree.inner->set_children_list({tree.b, tree.translation, d});
+    check_subtree(tree.root.get());
+
+    tree.inner->set_children_list({tree.translation});
+    check_subtree(tree.root.get());
+}
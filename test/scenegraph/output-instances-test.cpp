@@ -0,0 +1,181 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+#include <wayfire/scene.hpp>
+#include <wayfire/scene-render.hpp>
+#include <wayfire/core.hpp>
+#include "../../src/core/scene-priv.hpp"
+#include "../test-options.hpp"
+
+using namespace wf::scene;
+
+/* The order in which the leaves were asked for direct scanout */
+static std::vector<int> scanout_order;
+
+/** A leaf which counts how often its render instances were generated. */
+class counting_node_t : public node_t
+{
+  public:
+    counting_node_t(int id) : node_t(false)
+    {
+        this->id = id;
+    }
+
+    wf::geometry_t get_bounding_box() override
+    {
+        return {id * 10, 0, 10, 10};
+    }
+
+    void gen_render_instances(std::vector<render_instance_uptr>& instances,
+        damage_callback push_damage, wf::output_t *output) override;
+
+    int id;
+    int generated = 0;
+};
+
+class counting_render_instance_t : public simple_render_instance_t<counting_node_t>
+{
+  public:
+    using simple_render_instance_t::simple_render_instance_t;
+
+    direct_scanout try_scanout(wf::output_t *output) override
+    {
+        scanout_order.push_back(self->id);
+        return direct_scanout::SKIP;
+    }
+};
+
+void counting_node_t::gen_render_instances(std::vector<render_instance_uptr>& instances,
+    damage_callback push_damage, wf::output_t *output)
+{
+    ++generated;
+    instances.push_back(std::make_unique<counting_render_instance_t>(this, push_damage, output));
+}
+
+/** Stands in for a workspace set. */
+class flat_node_t : public floating_inner_node_t, public flat_instances_tag_t
+{
+  public:
+    flat_node_t() : floating_inner_node_t(false)
+    {}
+
+    /**
+     * Change the list of children without emitting damage, which the output
+     * node could not translate without an actual output.
+     */
+    void set_children_quietly(std::vector<node_ptr> new_list)
+    {
+        this->children = std::move(new_list);
+    }
+};
+
+/** An output node without an actual output. */
+class test_output_node_t : public output_node_t
+{
+  public:
+    test_output_node_t() : output_node_t(nullptr)
+    {}
+
+    wf::geometry_t get_bounding_box() override
+    {
+        return node_t::get_bounding_box();
+    }
+};
+
+struct test_tree_t
+{
+    std::shared_ptr<test_output_node_t> output = std::make_shared<test_output_node_t>();
+    std::shared_ptr<flat_node_t> wset = std::make_shared<flat_node_t>();
+    std::vector<std::shared_ptr<counting_node_t>> views;
+
+    std::vector<render_instance_uptr> instances;
+
+    test_tree_t(int nr_views)
+    {
+        setup_scenegraph_options();
+        std::vector<node_ptr> children;
+        for (int i = 0; i < nr_views; i++)
+        {
+            views.push_back(std::make_shared<counting_node_t>(i));
+            children.push_back(views.back());
+        }
+
+        wset->set_children_list(children);
+        output->set_children_list({wset});
+        output->gen_render_instances(instances, [] (const wf::region_t&) {}, nullptr);
+        REQUIRE(instances.size() == 1);
+    }
+
+    std::vector<int> get_order()
+    {
+        scanout_order.clear();
+        instances.front()->try_scanout(nullptr);
+        return scanout_order;
+    }
+
+    std::vector<int> get_generated()
+    {
+        std::vector<int> result;
+        for (auto& view : views)
+        {
+            result.push_back(view->generated);
+        }
+
+        return result;
+    }
+};
+
+TEST_CASE("Restacking views does not regenerate their instances")
+{
+    test_tree_t tree{3};
+    REQUIRE(tree.get_order() == std::vector<int>{0, 1, 2});
+
+    tree.wset->set_children_quietly({tree.views[2], tree.views[0], tree.views[1]});
+    REQUIRE(update_output_render_instance(tree.instances.front().get(), tree.wset.get()));
+    REQUIRE(tree.get_order() == std::vector<int>{2, 0, 1});
+    REQUIRE(tree.get_generated() == std::vector<int>{1, 1, 1});
+}
+
+TEST_CASE("Only new and changed views get new instances")
+{
+    test_tree_t tree{2};
+
+    auto view = std::make_shared<counting_node_t>(2);
+    tree.views.push_back(view);
+    tree.wset->set_children_quietly({tree.views[0], tree.views[1], view});
+    update_output_render_instance(tree.instances.front().get(), tree.wset.get());
+    REQUIRE(tree.get_order() == std::vector<int>{0, 1, 2});
+    REQUIRE(tree.get_generated() == std::vector<int>{1, 1, 1});
+
+    update_output_render_instance(tree.instances.front().get(), tree.views[1].get());
+    REQUIRE(tree.get_order() == std::vector<int>{0, 1, 2});
+    REQUIRE(tree.get_generated() == std::vector<int>{1, 2, 1});
+}
+
+TEST_CASE("Disabled views have no instances")
+{
+    test_tree_t tree{3};
+
+    tree.views[1]->set_enabled(false);
+    update_output_render_instance(tree.instances.front().get(), tree.views[1].get());
+    REQUIRE(tree.get_order() == std::vector<int>{0, 2});
+
+    tree.views[1]->set_enabled(true);
+    update_output_render_instance(tree.instances.front().get(), tree.views[1].get());
+    REQUIRE(tree.get_order() == std::vector<int>{0, 1, 2});
+    REQUIRE(tree.get_generated() == std::vector<int>{1, 2, 1});
+}
+
+TEST_CASE("Disabling the workspace set removes all its views")
+{
+    test_tree_t tree{2};
+
+    tree.wset->set_enabled(false);
+    update_output_render_instance(tree.instances.front().get(), tree.wset.get());
+    REQUIRE(tree.get_order().empty());
+
+    tree.wset->set_enabled(true);
+    update_output_render_instance(tree.instances.front().get(), tree.wset.get());
+    REQUIRE(tree.get_order() == std::vector<int>{0, 1});
+    REQUIRE(tree.get_generated() == std::vector<int>{2, 2});
+}
@@ -0,0 +1,291 @@
+#include <wayfire/scene.hpp>
+#include <wayfire/scene-render.hpp>
+#include <wayfire/view.hpp>
+#include <wayfire/core.hpp>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <random>
+#include "../test-options.hpp"
+
+using namespace wf::scene;
+
+/* The size of the area where the leaves are placed, similar to a 4k output */
+static constexpr int CANVAS_WIDTH  = 3840;
+static constexpr int CANVAS_HEIGHT = 2160;
+
+/* Maximal number of children of each inner node */
+static constexpr int FANOUT = 10;
+
+/**
+ * A leaf with a fixed geometry, standing in for a view. Every other leaf is
+ * opaque, so that damage and visible regions get fragmented like with real
+ * views, but never become empty.
+ */
+class leaf_node_t : public node_t, public wf::view_node_tag_t
+{
+  public:
+    leaf_node_t(wf::geometry_t geometry, bool opaque) : node_t(false)
+    {
+        this->geometry = geometry;
+        this->opaque   = opaque;
+    }
+
+    std::optional<input_node_t> find_node_at(const wf::pointf_t& at) override
+    {
+        if (geometry & at)
+        {
+            return input_node_t{
+                .node = this,
+                .local_coords = {at.x - geometry.x, at.y - geometry.y},
+            };
+        }
+
+        return {};
+    }
+
+    wf::geometry_t get_bounding_box() override
+    {
+        return geometry;
+    }
+
+    wayfire_view get_view() const override
+    {
+        return nullptr;
+    }
+
+    void gen_render_instances(std::vector<render_instance_uptr>& instances,
+        damage_callback push_damage, wf::output_t *output) override;
+
+    wf::geometry_t geometry;
+    bool opaque;
+    wf::region_t visible;
+};
+
+class leaf_render_instance_t : public simple_render_instance_t<leaf_node_t>
+{
+  public:
+    using simple_render_instance_t::simple_render_instance_t;
+
+    void schedule_instructions(std::vector<render_instruction_t>& instructions,
+        const wf::render_target_t& target, wf::region_t& damage) override
+    {
+        auto our_damage = damage & self->geometry;
+        if (our_damage.empty())
+        {
+            return;
+        }
+
+        instructions.push_back(render_instruction_t{
+                    .instance = this,
+                    .target   = target,
+                    .damage   = std::move(our_damage),
+                });
+
+        if (self->opaque)
+        {
+            damage ^= self->geometry;
+        }
+    }
+
+    void compute_visibility(wf::output_t *output, wf::region_t& visible) override
+    {
+        self->visible = visible & self->geometry;
+        if (self->opaque)
+        {
+            visible ^= self->geometry;
+        }
+    }
+};
+
+void leaf_node_t::gen_render_instances(std::vector<render_instance_uptr>& instances,
+    damage_callback push_damage, wf::output_t *output)
+{
+    instances.push_back(std::make_unique<leaf_render_instance_t>(this, push_damage, output));
+}
+
+struct scene_tree_t
+{
+    std::shared_ptr<floating_inner_node_t> root;
+    std::vector<std::shared_ptr<leaf_node_t>> leaves;
+};
+
+/**
+ * Build a tree with @nr_leaves leaves, where each inner node has up to FANOUT
+ * children. This mimics the nesting of layers, outputs, workspace sets and
+ * views, and makes propagating updates to the root more expensive than with a
+ * flat list.
+ */
+static node_ptr build_subtree(scene_tree_t& tree, int nr_leaves, std::mt19937& rng)
+{
+    if (nr_leaves == 1)
+    {
+        std::uniform_int_distribution<int> width(100, 800), height(100, 600);
+        std::uniform_int_distribution<int> x(0, CANVAS_WIDTH - 100), y(0, CANVAS_HEIGHT - 100);
+        auto leaf = std::make_shared<leaf_node_t>(
+            wf::geometry_t{x(rng), y(rng), width(rng), height(rng)}, tree.leaves.size() % 2 == 0);
+        tree.leaves.push_back(leaf);
+        return leaf;
+    }
+
+    std::vector<node_ptr> children;
+    const int nr_children = std::min(nr_leaves, FANOUT);
+    for (int i = 0; i < nr_children; i++)
+    {
+        // Spread the leaves as evenly as possible among the children
+        const int count = nr_leaves / nr_children + (i < nr_leaves % nr_children ? 1 : 0);
+        children.push_back(build_subtree(tree, count, rng));
+    }
+
+    auto inner = std::make_shared<floating_inner_node_t>(false);
+    inner->set_children_list(children);
+    return inner;
+}
+
+static scene_tree_t build_tree(int nr_leaves)
+{
+    // Fixed seed, so that the results are comparable between runs
+    std::mt19937 rng{42};
+    scene_tree_t tree;
+    tree.root = std::make_shared<floating_inner_node_t>(false);
+    tree.root->set_children_list({build_subtree(tree, nr_leaves, rng)});
+    return tree;
+}
+
+/**
+ * @return Damage consisting of @nr_rects small scattered rectangles, like
+ *   several clients updating small parts of their surfaces.
+ */
+static wf::region_t fragmented_damage(int nr_rects, std::mt19937& rng)
+{
+    std::uniform_int_distribution<int> x(0, CANVAS_WIDTH - 64), y(0, CANVAS_HEIGHT - 64);
+    wf::region_t damage;
+    for (int i = 0; i < nr_rects; i++)
+    {
+        damage |= wf::geometry_t{x(rng), y(rng), 32, 32};
+    }
+
+    return damage;
+}
+
+/**
+ * Run @func @iterations times.
+ *
+ * @return The average time per iteration in microseconds.
+ */
+static double measure(int iterations, const std::function<void(int)>& func)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        func(i);
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    auto ns  = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    return ns / 1000.0 / iterations;
+}
+
+static std::shared_ptr<wf::config::option_t<bool>> input_spatial_index;
+
+static void run(int nr_leaves)
+{
+    auto tree = build_tree(nr_leaves);
+    // Scale the number of iterations so that each measurement takes roughly
+    // the same time regardless of the tree size.
+    const int iterations = std::max(10, 100'000 / nr_leaves);
+    int64_t sum = 0;
+
+    std::vector<render_instance_uptr> instances;
+    damage_callback push_damage = [&] (const wf::region_t&) { ++sum; };
+    double gen = measure(iterations, [&] (int)
+    {
+        instances.clear();
+        tree.root->gen_render_instances(instances, push_damage, nullptr);
+        sum += instances.size();
+    });
+
+    std::mt19937 rng{7};
+    std::vector<wf::region_t> damages;
+    for (int i = 0; i < 16; i++)
+    {
+        damages.push_back(fragmented_damage(64, rng));
+    }
+
+    wf::render_target_t target;
+    target.geometry = {0, 0, CANVAS_WIDTH, CANVAS_HEIGHT};
+    std::vector<render_instruction_t> instructions;
+    double schedule = measure(iterations, [&] (int i)
+    {
+        instructions.clear();
+        wf::region_t damage = damages[i % damages.size()];
+        for (auto& inst : instances)
+        {
+            inst->schedule_instructions(instructions, target, damage);
+        }
+
+        sum += instructions.size();
+    });
+
+    double visibility = measure(iterations, [&] (int)
+    {
+        wf::region_t visible{target.geometry};
+        for (auto& inst : instances)
+        {
+            inst->compute_visibility(nullptr, visible);
+        }
+
+        sum += visible.empty();
+    });
+
+    std::vector<wf::pointf_t> points;
+    std::uniform_real_distribution<double> px(0, CANVAS_WIDTH), py(0, CANVAS_HEIGHT);
+    for (int i = 0; i < 1024; i++)
+    {
+        points.push_back({px(rng), py(rng)});
+    }
+
+    auto find_at = [&] (int i)
+    {
+        sum += tree.root->find_node_at(points[i % points.size()]).has_value();
+    };
+
+    input_spatial_index->set_value(false);
+    double find_linear = measure(iterations * 10, find_at);
+    input_spatial_index->set_value(true);
+    double find_indexed = measure(iterations * 10, find_at);
+    input_spatial_index->set_value(false);
+
+    // Moving a view: update its geometry, then query the bounding box of the
+    // whole scene like damage tracking would.
+    std::uniform_int_distribution<size_t> pick(0, tree.leaves.size() - 1);
+    double updates = measure(iterations * 10, [&] (int i)
+    {
+        auto& leaf = tree.leaves[pick(rng)];
+        leaf->geometry.x = (leaf->geometry.x + 1) % (CANVAS_WIDTH - 100);
+        wf::scene::update(leaf, update_flag::GEOMETRY);
+        sum += tree.root->get_bounding_box().width;
+    });
+
+    instances.clear();
+    if (sum == 0)
+    {
+        std::cout << "unexpected result" << std::endl;
+    }
+
+    std::cout << nr_leaves << " nodes: gen_render_instances " << gen << " us, schedule_instructions " <<
+        schedule << " us, compute_visibility " << visibility << " us, find_node_at " << find_linear <<
+        " us (indexed " << find_indexed << " us), update " << updates << " us" << std::endl;
+}
+
+int main()
+{
+    setup_scenegraph_options();
+    input_spatial_index = register_core_option("input_spatial_index", false);
+    for (int nr_leaves : {10, 100, 1000, 10000})
+    {
+        run(nr_leaves);
+    }
+
+    return 0;
+}
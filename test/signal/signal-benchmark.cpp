@@ -0,0 +1,108 @@
+#include <wayfire/signal-provider.hpp>
+#include <wayfire/nonstd/safe-list.hpp>
+#include <chrono>
+#include <iostream>
+#include <typeindex>
+#include <unordered_map>
+
+/**
+ * The emission path of signal::provider_t before connections were stored in
+ * per-type slots. Only connect() and emit() are implemented, as disconnecting
+ * is not measured.
+ */
+class legacy_provider_t
+{
+  public:
+    template<class SignalType>
+    void connect(wf::signal::connection_t<SignalType> *callback)
+    {
+        typed_connections[std::type_index(typeid(SignalType))].push_back(callback);
+    }
+
+    template<class SignalType>
+    void emit(SignalType *data)
+    {
+        auto& conns = typed_connections[std::type_index(typeid(SignalType))];
+        conns.for_each([&] (wf::signal::connection_base_t *tc)
+        {
+            auto real_type = dynamic_cast<wf::signal::connection_t<SignalType>*>(tc);
+            assert(real_type);
+            real_type->emit(data);
+        });
+    }
+
+  private:
+    std::unordered_map<std::type_index, wf::safe_list_t<wf::signal::connection_base_t*>>
+    typed_connections;
+};
+
+struct damage_signal
+{
+    int x;
+};
+
+struct frame_signal
+{
+    int frame;
+};
+
+struct unused_signal
+{};
+
+template<class Provider>
+static double run(int nr_connections, int nr_emissions)
+{
+    Provider provider;
+    int64_t sum = 0;
+
+    std::vector<std::unique_ptr<wf::signal::connection_t<damage_signal>>> damage_conns;
+    std::vector<std::unique_ptr<wf::signal::connection_t<frame_signal>>> frame_conns;
+    wf::signal::connection_t<unused_signal> unused = [] (unused_signal*) {};
+    provider.connect(&unused);
+    for (int i = 0; i < nr_connections; i++)
+    {
+        damage_conns.push_back(std::make_unique<wf::signal::connection_t<damage_signal>>(
+            [&] (damage_signal *ev) { sum += ev->x; }));
+        frame_conns.push_back(std::make_unique<wf::signal::connection_t<frame_signal>>(
+            [&] (frame_signal *ev) { sum += ev->frame; }));
+        provider.connect(damage_conns.back().get());
+        provider.connect(frame_conns.back().get());
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < nr_emissions; i++)
+    {
+        damage_signal damage{i};
+        provider.emit(&damage);
+        frame_signal frame{i};
+        provider.emit(&frame);
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    if (sum == 0)
+    {
+        std::cout << "unexpected result" << std::endl;
+    }
+
+    // Disconnect before the provider is destroyed
+    damage_conns.clear();
+    frame_conns.clear();
+    unused.disconnect();
+
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    return 1.0 * ns / (2 * nr_emissions);
+}
+
+int main()
+{
+    const int nr_emissions = 1'000'000;
+    for (int nr_connections : {1, 4, 16, 64})
+    {
+        double legacy  = run<legacy_provider_t>(nr_connections, nr_emissions);
+        double current = run<wf::signal::provider_t>(nr_connections, nr_emissions);
+        std::cout << nr_connections << " connections: legacy " << legacy << " ns/emit, current " <<
+            current << " ns/emit" << std::endl;
+    }
+
+    return 0;
+}
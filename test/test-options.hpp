@@ -0,0 +1,45 @@
+#pragma once
+
+#include <wayfire/core.hpp>
+#include <wayfire/scene.hpp>
+#include <wayfire/config/section.hpp>
+#include <wayfire/config/option.hpp>
+
+/**
+ * Register an option in the core section of the config. Tests and benchmarks
+ * have no config file, but core reads some of its options from it.
+ *
+ * If the option is already registered, it is returned with its current value.
+ */
+template<class Type>
+std::shared_ptr<wf::config::option_t<Type>> register_core_option(const std::string& name, Type value)
+{
+    if (auto existing = wf::get_core().config.get_option("core/" + name))
+    {
+        return std::dynamic_pointer_cast<wf::config::option_t<Type>>(existing);
+    }
+
+    auto section = std::make_shared<wf::config::section_t>("core");
+    auto option  = std::make_shared<wf::config::option_t<Type>>(name, value);
+    section->register_new_option(option);
+    wf::get_core().config.merge_section(section);
+    return option;
+}
+
+/**
+ * Register the options of the scenegraph, with the spatial input index
+ * disabled and the bounding box cache enabled. The options are loaded by the
+ * root node, so one is created, which is otherwise not used.
+ */
+inline void setup_scenegraph_options()
+{
+    static std::shared_ptr<wf::scene::root_node_t> options_root;
+    if (options_root)
+    {
+        return;
+    }
+
+    register_core_option("input_spatial_index", false);
+    register_core_option("bounding_box_cache", true);
+    options_root = std::make_shared<wf::scene::root_node_t>();
+}
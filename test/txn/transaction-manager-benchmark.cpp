@@ -0,0 +1,237 @@
+#include <wayfire/txn/transaction.hpp>
+#include <wayland-server-core.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "transaction-test-object.hpp"
+#include "../../src/core/txn/transaction-manager-impl.hpp"
+
+static bool legacy_transactions_intersect(const wf::txn::transaction_uptr& a,
+    const wf::txn::transaction_uptr& b)
+{
+    const auto& obj_a = a->get_objects();
+    const auto& obj_b = b->get_objects();
+
+    return std::any_of(obj_a.begin(), obj_a.end(), [&] (const wf::txn::transaction_object_sptr& x)
+    {
+        return std::find(obj_b.begin(), obj_b.end(), x) != obj_b.end();
+    });
+}
+
+/**
+ * The scheduling of transaction_manager_t::impl before it kept an index of the
+ * objects of pending and committed transactions.
+ */
+struct legacy_manager_t
+{
+    void schedule_transaction(wf::txn::transaction_uptr tx)
+    {
+        coalesce_transactions(tx);
+        remove_conflicts(tx);
+        pending.push_back(std::move(tx));
+        consider_commit();
+    }
+
+    void coalesce_transactions(const wf::txn::transaction_uptr& tx)
+    {
+        while (true)
+        {
+            const size_t start_size = tx->get_objects().size();
+            for (auto& existing : pending)
+            {
+                if (legacy_transactions_intersect(existing, tx))
+                {
+                    for (auto& obj : existing->get_objects())
+                    {
+                        tx->add_object(obj);
+                    }
+                }
+            }
+
+            if (start_size == tx->get_objects().size())
+            {
+                break;
+            }
+        }
+    }
+
+    void remove_conflicts(const wf::txn::transaction_uptr& tx)
+    {
+        auto it = std::remove_if(pending.begin(), pending.end(), [&] (const wf::txn::transaction_uptr& existing)
+        {
+            return legacy_transactions_intersect(existing, tx);
+        });
+        pending.erase(it, pending.end());
+    }
+
+    void consider_commit()
+    {
+        for (size_t idx = 0; idx < pending.size();)
+        {
+            if (can_commit_transaction(pending[idx]))
+            {
+                auto tx = std::move(pending[idx]);
+                pending.erase(pending.begin() + idx);
+                do_commit(std::move(tx));
+            } else
+            {
+                ++idx;
+            }
+        }
+    }
+
+    bool can_commit_transaction(const wf::txn::transaction_uptr& tx)
+    {
+        return std::none_of(committed.begin(), committed.end(), [&] (const wf::txn::transaction_uptr& comm)
+        {
+            return legacy_transactions_intersect(tx, comm);
+        });
+    }
+
+    void do_commit(wf::txn::transaction_uptr tx)
+    {
+        tx->connect(&on_tx_apply);
+        committed.push_back(std::move(tx));
+        committed.back()->commit();
+    }
+
+    std::vector<wf::txn::transaction_uptr> done;
+    std::vector<wf::txn::transaction_uptr> committed;
+    std::vector<wf::txn::transaction_uptr> pending;
+
+    wf::signal::connection_t<wf::txn::transaction_applied_signal> on_tx_apply =
+        [&] (wf::txn::transaction_applied_signal *ev)
+    {
+        auto it = std::find_if(committed.begin(), committed.end(), [&] (auto& existing)
+        {
+            return existing.get() == ev->self;
+        });
+
+        done.push_back(std::move(*it));
+        committed.erase(it);
+        consider_commit();
+    };
+};
+
+static wf::txn::transaction_uptr new_tx()
+{
+    return std::make_unique<wf::txn::transaction_t>(0, [] (auto, auto) {});
+}
+
+/**
+ * Simulate a tiling re-layout of @nr_views views while each view still waits
+ * for the client to ack its previous configure: every view gets a pending
+ * transaction of its own, then a transaction which moves all views together,
+ * then all clients become ready.
+ *
+ * @return The time needed in microseconds.
+ */
+template<class Manager>
+static double run_relayout(int nr_views)
+{
+    Manager mgr;
+    std::vector<std::shared_ptr<txn_test_object_t>> views;
+    for (int i = 0; i < nr_views; i++)
+    {
+        views.push_back(std::make_shared<txn_test_object_t>(false));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < 2; round++)
+    {
+        for (auto& view : views)
+        {
+            auto tx = new_tx();
+            tx->add_object(view);
+            mgr.schedule_transaction(std::move(tx));
+        }
+    }
+
+    auto tx = new_tx();
+    for (auto& view : views)
+    {
+        tx->add_object(view);
+    }
+
+    mgr.schedule_transaction(std::move(tx));
+    for (int round = 0; round < 2; round++)
+    {
+        for (auto& view : views)
+        {
+            view->emit_ready();
+        }
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    if (!mgr.committed.empty() || !mgr.pending.empty())
+    {
+        std::cout << "unexpected result" << std::endl;
+    }
+
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / 1000.0;
+}
+
+/**
+ * Simulate an output being unplugged while its @nr_views views wait for the
+ * clients: the views are moved in pairs, in overlapping transactions, so that
+ * every new transaction needs to be merged with the previous pending one.
+ *
+ * @return The time needed in microseconds.
+ */
+template<class Manager>
+static double run_chained(int nr_views)
+{
+    Manager mgr;
+    std::vector<std::shared_ptr<txn_test_object_t>> views;
+    for (int i = 0; i < nr_views; i++)
+    {
+        views.push_back(std::make_shared<txn_test_object_t>(false));
+        auto tx = new_tx();
+        tx->add_object(views.back());
+        mgr.schedule_transaction(std::move(tx));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i + 1 < nr_views; i++)
+    {
+        auto tx = new_tx();
+        tx->add_object(views[i]);
+        tx->add_object(views[i + 1]);
+        mgr.schedule_transaction(std::move(tx));
+    }
+
+    for (int round = 0; round < 2; round++)
+    {
+        for (auto& view : views)
+        {
+            view->emit_ready();
+        }
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    if (!mgr.committed.empty() || !mgr.pending.empty())
+    {
+        std::cout << "unexpected result" << std::endl;
+    }
+
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / 1000.0;
+}
+
+int main()
+{
+    // Signals use safe_list_t, which needs wl_idle_call
+    wf::wl_idle_call::loop = wl_event_loop_create();
+
+    for (int nr_views : {10, 50, 200, 1000})
+    {
+        std::cout << nr_views << " views: relayout legacy " << run_relayout<legacy_manager_t>(nr_views) <<
+            " us, current " << run_relayout<wf::txn::transaction_manager_t::impl>(nr_views) << " us" <<
+            std::endl;
+        std::cout << nr_views << " views: chained legacy " << run_chained<legacy_manager_t>(nr_views) <<
+            " us, current " << run_chained<wf::txn::transaction_manager_t::impl>(nr_views) << " us" <<
+            std::endl;
+    }
+
+    return 0;
+}
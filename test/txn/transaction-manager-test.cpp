@@ -9,7 +9,10 @@
 
 #include "transaction-test-object.hpp"
 #include <wayfire/txn/transaction.hpp>
+#include <wayfire/txn/client-latency.hpp>
+#include <wayfire/core.hpp>
 #include "../../src/core/txn/transaction-manager-impl.hpp"
+#include "../test-options.hpp"
 
 static wf::txn::transaction_uptr new_tx()
 {
@@ -290,3 +293,99 @@ TEST_CASE("Concurrent committed")
     REQUIRE(mgr.pending.size() == 0);
     REQUIRE(mgr.done.size() == 2);
 }
+
+/**
+ * There is no config file in the test, so register core/slow_client_threshold with a threshold of 50ms.
+ */
+static void setup_slow_client_threshold()
+{
+    register_core_option("slow_client_threshold", 50);
+}
+
+struct slow_clients_test_t
+{
+    wl_display *display = wl_display_create();
+    wl_client *fast     = create_test_client(display);
+    wl_client *slow     = create_test_client(display);
+
+    slow_clients_test_t()
+    {
+        setup_wayfire_debugging_state();
+        setup_slow_client_threshold();
+        for (int i = 0; i < 8; i++)
+        {
+            wf::txn::record_client_latency(fast, 5'000);
+            wf::txn::record_client_latency(slow, 200'000);
+        }
+
+        REQUIRE(*wf::txn::get_client_timeout(fast) < 50);
+        REQUIRE(*wf::txn::get_client_timeout(slow) > 50);
+    }
+
+    ~slow_clients_test_t()
+    {
+        wl_client_destroy(fast);
+        wl_client_destroy(slow);
+        wl_display_destroy(display);
+    }
+};
+
+TEST_CASE("Objects of slow clients are split into a transaction with the same timeout")
+{
+    slow_clients_test_t clients;
+    wf::txn::transaction_manager_t::impl mgr;
+
+    auto fast_obj  = std::make_shared<txn_test_object_t>(false, clients.fast);
+    auto slow_obj1 = std::make_shared<txn_test_object_t>(false, clients.slow);
+    auto slow_obj2 = std::make_shared<txn_test_object_t>(false, clients.slow);
+    auto core_obj  = std::make_shared<txn_test_object_t>(false);
+
+    std::vector<uint64_t> timeouts;
+    auto tx = std::make_unique<wf::txn::transaction_t>(1234, [&] (uint64_t timeout, auto)
+    {
+        timeouts.push_back(timeout);
+    });
+    tx->add_object(fast_obj);
+    tx->add_object(slow_obj1);
+    tx->add_object(slow_obj2);
+    tx->add_object(core_obj);
+
+    mgr.schedule_transaction(std::move(tx));
+    REQUIRE(mgr.committed.size() == 2);
+    REQUIRE(mgr.pending.size() == 0);
+    REQUIRE(timeouts == std::vector<uint64_t>{1234, 1234});
+    REQUIRE(mgr.committed[0]->get_objects() == std::vector<wf::txn::transaction_object_sptr>{fast_obj,
+        core_obj});
+    REQUIRE(mgr.committed[1]->get_objects() == std::vector<wf::txn::transaction_object_sptr>{slow_obj1,
+        slow_obj2});
+
+    // The other objects do not wait for the slow client
+    fast_obj->emit_ready();
+    core_obj->emit_ready();
+    REQUIRE(fast_obj->number_applied == 1);
+    REQUIRE(core_obj->number_applied == 1);
+    REQUIRE(slow_obj1->number_applied == 0);
+    REQUIRE(mgr.committed.size() == 1);
+
+    slow_obj1->emit_ready();
+    slow_obj2->emit_ready();
+    REQUIRE(slow_obj1->number_applied == 1);
+    REQUIRE(slow_obj2->number_applied == 1);
+    REQUIRE(mgr.committed.size() == 0);
+}
+
+TEST_CASE("Transactions with only slow clients are not split")
+{
+    slow_clients_test_t clients;
+    wf::txn::transaction_manager_t::impl mgr;
+
+    auto slow_obj1 = std::make_shared<txn_test_object_t>(false, clients.slow);
+    auto slow_obj2 = std::make_shared<txn_test_object_t>(false, clients.slow);
+    auto tx = new_tx();
+    tx->add_object(slow_obj1);
+    tx->add_object(slow_obj2);
+
+    mgr.schedule_transaction(std::move(tx));
+    REQUIRE(mgr.committed.size() == 1);
+    REQUIRE(mgr.committed[0]->get_objects().size() == 2);
+}
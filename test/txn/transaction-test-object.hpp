@@ -1,6 +1,8 @@
 #pragma once
 #include <wayfire/txn/transaction-object.hpp>
 #include <wayfire/debug.hpp>
+#include <wayland-server-core.h>
+#include <sys/socket.h>
 #include <iostream>
 
 class txn_test_object_t : public wf::txn::transaction_object_t
@@ -11,10 +13,17 @@ class txn_test_object_t : public wf::txn::transaction_object_t
     std::function<void()> apply_callback;
 
     bool autoready;
+    wl_client *client;
 
-    txn_test_object_t(bool autocommit)
+    txn_test_object_t(bool autocommit, wl_client *client = nullptr)
     {
         this->autoready = autocommit;
+        this->client    = client;
+    }
+
+    wl_client *get_client() const override
+    {
+        return client;
     }
 
     void commit() override
@@ -43,6 +52,21 @@ class txn_test_object_t : public wf::txn::transaction_object_t
     }
 };
 
+/**
+ * Create a client connected to @display over a socket pair. Transactions only use clients as keys, so the
+ * client never has to send anything.
+ */
+inline wl_client *create_test_client(wl_display *display)
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0)
+    {
+        return nullptr;
+    }
+
+    return wl_client_create(display, fds[0]);
+}
+
 inline void setup_wayfire_debugging_state()
 {
     wf::log::initialize_logging(std::cout, wf::log::LOG_LEVEL_DEBUG, wf::log::LOG_COLOR_MODE_ON);
@@ -8,6 +8,7 @@
 
 #include "transaction-test-object.hpp"
 #include <wayfire/txn/transaction.hpp>
+#include <wayfire/txn/client-latency.hpp>
 
 static void run_transaction_test(bool timeout, bool autoready)
 {
@@ -99,3 +100,47 @@ TEST_CASE("Transaction is applied immediately if all objects are ready")
 {
     run_transaction_test(false, true);
 }
+
+TEST_CASE("Adaptive timeout waits for the slowest known client")
+{
+    setup_wayfire_debugging_state();
+    auto display = wl_display_create();
+    auto fast    = create_test_client(display);
+    auto slow    = create_test_client(display);
+    auto unknown = create_test_client(display);
+    REQUIRE((fast && slow && unknown));
+
+    for (int i = 0; i < 8; i++)
+    {
+        wf::txn::record_client_latency(fast, 5'000);
+        wf::txn::record_client_latency(slow, 80'000);
+    }
+
+    // Too few samples for an estimate
+    wf::txn::record_client_latency(unknown, 1'000);
+
+    const uint64_t fast_timeout = *wf::txn::get_client_timeout(fast);
+    const uint64_t slow_timeout = *wf::txn::get_client_timeout(slow);
+    REQUIRE(fast_timeout < slow_timeout);
+    REQUIRE(!wf::txn::get_client_timeout(unknown));
+
+    auto fast_obj    = std::make_shared<txn_test_object_t>(false, fast);
+    auto slow_obj    = std::make_shared<txn_test_object_t>(false, slow);
+    auto unknown_obj = std::make_shared<txn_test_object_t>(false, unknown);
+    auto core_obj    = std::make_shared<txn_test_object_t>(false);
+
+    REQUIRE(wf::txn::get_adaptive_timeout({}, 1000) == 1000);
+    REQUIRE(wf::txn::get_adaptive_timeout({fast_obj}, 1000) == fast_timeout);
+    REQUIRE(wf::txn::get_adaptive_timeout({fast_obj, slow_obj}, 1000) == slow_timeout);
+    REQUIRE(wf::txn::get_adaptive_timeout({fast_obj, slow_obj}, slow_timeout - 1) == slow_timeout - 1);
+    REQUIRE(wf::txn::get_adaptive_timeout({fast_obj, unknown_obj}, 1000) == 1000);
+    REQUIRE(wf::txn::get_adaptive_timeout({fast_obj, core_obj}, 1000) == 1000);
+
+    // The statistics are dropped together with the client
+    wl_client_destroy(fast);
+    REQUIRE(!wf::txn::get_client_latency(fast_obj->client));
+
+    wl_client_destroy(slow);
+    wl_client_destroy(unknown);
+    wl_display_destroy(display);
+}
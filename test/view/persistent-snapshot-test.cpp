@@ -0,0 +1,111 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+#include <wayfire/view.hpp>
+#include <wayfire/scene.hpp>
+#include <wayfire/core.hpp>
+#include "../../src/core/core-impl.hpp"
+#include "../../src/view/view-impl.hpp"
+#include "../test-options.hpp"
+
+using namespace wf::scene;
+
+/** Installs a scenegraph root in core, which is normally done by core's init(). */
+struct core_scene_access_t : public wf::compositor_core_impl_t
+{
+    static void set_scene(std::shared_ptr<root_node_t> root)
+    {
+        wf::get_core_impl().*(&core_scene_access_t::scene_root) = root;
+    }
+};
+
+static void setup_scene()
+{
+    if (wf::get_core().scene())
+    {
+        return;
+    }
+
+    setup_scenegraph_options();
+    core_scene_access_t::set_scene(std::make_shared<root_node_t>());
+}
+
+/** A view without any surfaces, which is never mapped. */
+class test_view_t : public wf::view_interface_t
+{
+  public:
+    test_view_t()
+    {
+        set_surface_root_node(std::make_shared<floating_inner_node_t>(false));
+    }
+
+    void move(int x, int y) override
+    {}
+
+    wf::geometry_t get_output_geometry() override
+    {
+        return {0, 0, 100, 100};
+    }
+
+    wlr_surface *get_keyboard_focus_surface() override
+    {
+        return nullptr;
+    }
+};
+
+/** Emit a scenegraph update as if @node was changed in the scenegraph. */
+static void emit_update(node_ptr node, uint32_t flags)
+{
+    root_node_update_signal data;
+    data.flags = flags;
+    data.changed_node = node;
+    wf::get_core().scene()->emit(&data);
+}
+
+TEST_CASE("Persistent snapshots are reference counted")
+{
+    setup_scene();
+    auto view = std::make_unique<test_view_t>();
+    auto& priv = view->priv;
+
+    view->set_persistent_snapshot(true);
+    view->set_persistent_snapshot(true);
+    REQUIRE(priv->persistent_snapshot_counter == 2);
+    REQUIRE(priv->on_snapshot_regen.is_connected());
+
+    priv->snapshot_damage |= wf::geometry_t{0, 0, 10, 10};
+    view->set_persistent_snapshot(false);
+    REQUIRE(priv->persistent_snapshot_counter == 1);
+    REQUIRE(priv->on_snapshot_regen.is_connected());
+    REQUIRE(!priv->snapshot_damage.empty());
+
+    view->set_persistent_snapshot(false);
+    REQUIRE(priv->persistent_snapshot_counter == 0);
+    REQUIRE(!priv->on_snapshot_regen.is_connected());
+    REQUIRE(priv->snapshot_damage.empty());
+}
+
+TEST_CASE("Persistent snapshot instances are dropped when the view contents change")
+{
+    setup_scene();
+    auto view = std::make_unique<test_view_t>();
+    auto& priv = view->priv;
+
+    auto child = std::make_shared<floating_inner_node_t>(false);
+    view->get_surface_root_node()->set_children_list({child});
+    view->set_persistent_snapshot(true);
+
+    // Stand-in for the instances generated by take_snapshot()
+    priv->snapshot_instances.push_back(nullptr);
+
+    emit_update(child, update_flag::GEOMETRY);
+    REQUIRE(priv->snapshot_instances.size() == 1);
+
+    emit_update(std::make_shared<floating_inner_node_t>(false), update_flag::CHILDREN_LIST);
+    REQUIRE(priv->snapshot_instances.size() == 1);
+
+    emit_update(child, update_flag::CHILDREN_LIST);
+    REQUIRE(priv->snapshot_instances.empty());
+
+    view->set_persistent_snapshot(false);
+}